@@ -41,6 +41,8 @@
 
 // Services
 #include "src/service/FPPDiscovery.h"
+#include "src/network/UdpRxTask.hpp"
+#include "src/service/FseqRecorder.hpp"
 
 #ifdef ARDUINO_ARCH_ESP8266
 #include <Hash.h>
@@ -146,6 +148,10 @@ void setup()
     OutputMgr.Begin ();
     // DEBUG_V ("");
 
+    // start the receive pipeline before any of the UDP inputs can listen
+    UdpRxTask.Begin ();
+    // DEBUG_V ("");
+
     // connect the input processing to the output processing.
     InputMgr.Begin (OutputMgr.GetBufferAddress (), OutputMgr.GetBufferUsedSize ());
     // DEBUG_V ("");
@@ -407,6 +413,12 @@ void loop()
     // Process input data
     InputMgr.Process ();
 
+    // Capture the input to the SD card when recording
+    FseqRecorder.Poll ();
+
+    // SD card housekeeping
+    FileMgr.Poll ();
+
     // Render output
     OutputMgr.Render();
 
@@ -24,6 +24,7 @@ const char CN_ActiveHigh               [] = "ActiveHigh";
 const char CN_ActiveLow                [] = "ActiveLow";
 const char CN_advancedView             [] = "advancedView";
 const char CN_allleds                  [] = "allleds";
+const char CN_alpha                    [] = "alpha";
 const char CN_ap_fallback              [] = "ap_fallback";
 const char CN_ap_timeout               [] = "ap_timeout";
 const char CN_ap_reboot                [] = "ap_reboot";
@@ -41,6 +42,7 @@ const char CN_clock_pin                [] = "clock_pin";
 const char CN_cmd                      [] = "cmd";
 const char CN_color                    [] = "color";
 const char CN_color_order              [] = "color_order";
+const char CN_compositor               [] = "compositor";
 const char CN_Configuration_File_colon [] = "Configuration File: ";
 const char CN_config                   [] = "config";
 const char CN_connected                [] = "connected";
@@ -78,6 +80,10 @@ const char CN_file                     [] = "file";
 const char CN_filename                 [] = "filename";
 const char CN_files                    [] = "files";
 const char CN_Frequency                [] = "Frequency";
+const char CN_fseq_cache_kb            [] = "fseq_cache_kb";
+const char CN_fseq_count               [] = "fseq_count";
+const char CN_fseq_extract             [] = "fseq_extract";
+const char CN_fseq_start               [] = "fseq_start";
 const char CN_fseqfilename             [] = "fseqfilename";
 const char CN_g                        [] = "g";
 const char CN_gamma                    [] = "gamma";
@@ -101,8 +107,12 @@ const char CN_ip                       [] = "ip";
 const char CN_input                    [] = "input";
 const char CN_input_config             [] = "input_config";
 const char CN_last_clientIP            [] = "last_clientIP";
+const char CN_loss_action              [] = "loss_action";
+const char CN_loss_fade                [] = "loss_fade";
+const char CN_loss_timeout             [] = "loss_timeout";
 const char CN_lwt                      [] = "lwt";
 const char CN_mac                      [] = "mac";
+const char CN_merge                    [] = "merge";
 const char CN_Max                      [] = "Max";
 const char CN_Min                      [] = "Min";
 const char CN_minussigns               [] = "-----";
@@ -133,6 +143,7 @@ const char CN_plussigns                [] = "+++++";
 const char CN_polarity                 [] = "polarity";
 const char CN_port                     [] = "port";
 const char CN_prependnullcount         [] = "prependnullcount";
+const char CN_priority                 [] = "priority";
 const char CN_pwm                      [] = "pwm";
 const char CN_r                        [] = "r";
 const char CN_remote                   [] = "remote";
@@ -140,20 +151,26 @@ const char CN_rev                      [] = "rev";
 const char CN_reverse                  [] = "reverse";
 const char CN_rssi                     [] = "rssi";
 const char CN_sca                      [] = "sca";
+const char CN_sd_bus                   [] = "sd_bus";
+const char CN_sd_spi_mhz               [] = "sd_spi_mhz";
 const char CN_seconds_elapsed          [] = "seconds_elapsed";
 const char CN_seconds_played           [] = "seconds_played";
 const char CN_seconds_remaining        [] = "seconds_remaining";
 const char CN_sequence_filename        [] = "sequence_filename";
 const char CN_slashset                 [] = "/set";
 const char CN_slashstatus              [] = "/status";
+const char CN_sources                  [] = "sources";
 const char CN_speed                    [] = "speed";
 const char CN_ssid                     [] = "ssid";
 const char CN_sta_timeout              [] = "sta_timeout";
 const char CN_stars                    [] = "***";
+const char CN_stale                    [] = "stale";
 const char CN_state                    [] = "state";
 const char CN_status                   [] = "status";
 const char CN_status_name              [] = "status_name";
 const char CN_subnet                   [] = "subnet";
+const char CN_sync_address             [] = "sync_address";
+const char CN_sync_packets             [] = "sync_packets";
 const char CN_SyncOffset               [] = "SyncOffset";
 const char CN_system                   [] = "system";
 const char CN_textSLASHplain           [] = "text/plain";
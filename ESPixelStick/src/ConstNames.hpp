@@ -26,6 +26,7 @@ extern const char CN_ActiveHigh[];
 extern const char CN_ActiveLow[];
 extern const char CN_advancedView[];
 extern const char CN_allleds [];
+extern const char CN_alpha[];
 extern const char CN_ap_fallback [];
 extern const char CN_ap_timeout [];
 extern const char CN_ap_reboot [];
@@ -43,6 +44,7 @@ extern const char CN_clock_pin[];
 extern const char CN_cmd[];
 extern const char CN_color[];
 extern const char CN_color_order[];
+extern const char CN_compositor[];
 extern const char CN_Configuration_File_colon [];
 extern const char CN_config[];
 extern const char CN_connected[];
@@ -80,6 +82,10 @@ extern const char CN_file[];
 extern const char CN_filename[];
 extern const char CN_files[];
 extern const char CN_Frequency[];
+extern const char CN_fseq_cache_kb[];
+extern const char CN_fseq_count[];
+extern const char CN_fseq_extract[];
+extern const char CN_fseq_start[];
 extern const char CN_fseqfilename[];
 extern const char CN_gateway[];
 extern const char CN_g[];
@@ -103,8 +109,12 @@ extern const char CN_ip[];
 extern const char CN_input[];
 extern const char CN_input_config[];
 extern const char CN_last_clientIP[];
+extern const char CN_loss_action[];
+extern const char CN_loss_fade[];
+extern const char CN_loss_timeout[];
 extern const char CN_lwt[];
 extern const char CN_mac[];
+extern const char CN_merge[];
 extern const char CN_Max[];
 extern const char CN_Min[];
 extern const char CN_minussigns[];
@@ -135,6 +145,7 @@ extern const char CN_playFseq[];
 extern const char CN_playlist [];
 extern const char CN_plussigns [];
 extern const char CN_prependnullcount [];
+extern const char CN_priority[];
 extern const char CN_pwm [];
 extern const char CN_remote [];
 extern const char CN_r[];
@@ -142,20 +153,26 @@ extern const char CN_rev[];
 extern const char CN_reverse[];
 extern const char CN_rssi[];
 extern const char CN_sca[];
+extern const char CN_sd_bus[];
+extern const char CN_sd_spi_mhz[];
 extern const char CN_seconds_elapsed[];
 extern const char CN_seconds_played[];
 extern const char CN_seconds_remaining[];
 extern const char CN_sequence_filename[];
 extern const char CN_slashset[];
 extern const char CN_slashstatus[];
+extern const char CN_sources[];
 extern const char CN_speed[];
 extern const char CN_ssid [];
 extern const char CN_sta_timeout [];
 extern const char CN_stars[];
+extern const char CN_stale[];
 extern const char CN_state[];
 extern const char CN_status [];
 extern const char CN_status_name[];
 extern const char CN_subnet[];
+extern const char CN_sync_address[];
+extern const char CN_sync_packets[];
 extern const char CN_SyncOffset[];
 extern const char CN_system[];
 extern const char CN_textSLASHplain[];
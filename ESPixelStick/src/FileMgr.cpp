@@ -21,21 +21,28 @@
 #include <Int64String.h>
 
 #include "FileMgr.hpp"
+#include "output/OutputMgr.hpp"
+#include "service/FseqCache.hpp"
+#include "service/FseqIndex.hpp"
 #include <StreamUtils.h>
 
-#define HTML_TRANSFER_BLOCK_SIZE    563
 #ifdef ARDUINO_ARCH_ESP32
-#   define NumBlocksToBuffer        21
-#else
-#   define NumBlocksToBuffer         9
-#endif
+//----------------------------------------------------------------------------
+static void FileUploadWriterTask (void * pvParameters)
+{
+    c_FileMgr * pFileMgr = reinterpret_cast <c_FileMgr*> (pvParameters);
+
+    pFileMgr->RunUploadWriter ();
+    vTaskDelete (NULL);
 
-static const uint32_t FileUploadBufferSize = HTML_TRANSFER_BLOCK_SIZE * NumBlocksToBuffer;
+} // FileUploadWriterTask
+#endif // def ARDUINO_ARCH_ESP32
 
 //-----------------------------------------------------------------------------
 ///< Start up the driver and put it into a safe mode
 c_FileMgr::c_FileMgr ()
 {
+    memset ((void*)UploadBlocks, 0x00, sizeof (UploadBlocks));
 } // c_FileMgr
 
 //-----------------------------------------------------------------------------
@@ -89,6 +96,24 @@ bool c_FileMgr::SetConfig (JsonObject & json)
         ConfigChanged |= setFromJSON (mosi_pin, JsonDeviceConfig, CN_mosi_pin);
         ConfigChanged |= setFromJSON (clk_pin,  JsonDeviceConfig, CN_clock_pin);
         ConfigChanged |= setFromJSON (cs_pin,   JsonDeviceConfig, CN_cs_pin);
+        ConfigChanged |= setFromJSON (sd_bus,     JsonDeviceConfig, CN_sd_bus);
+        ConfigChanged |= setFromJSON (sd_spi_mhz, JsonDeviceConfig, CN_sd_spi_mhz);
+
+        if ((SD_BUS_SPI != sd_bus) && (SD_BUS_MMC_1_BIT != sd_bus) && (SD_BUS_MMC_4_BIT != sd_bus))
+        {
+            logcon (String (F ("* Invalid SD bus. Using SPI.")));
+            sd_bus = SD_BUS_SPI;
+        }
+        sd_spi_mhz = max (uint8_t (1), min (sd_spi_mhz, uint8_t (SD_CARD_MAX_SPI_MHZ)));
+
+        setFromJSON (FseqExtractEnabled, JsonDeviceConfig, CN_fseq_extract);
+        setFromJSON (FseqExtractStart,   JsonDeviceConfig, CN_fseq_start);
+        setFromJSON (FseqExtractCount,   JsonDeviceConfig, CN_fseq_count);
+        FseqExtractStart = max (FseqExtractStart, uint32_t (1));
+
+        uint32_t FseqCacheKB = FseqCache.GetBudget ();
+        setFromJSON (FseqCacheKB, JsonDeviceConfig, CN_fseq_cache_kb);
+        FseqCache.SetBudget (FseqCacheKB);
     }
     else
     {
@@ -117,6 +142,13 @@ void c_FileMgr::GetConfig (JsonObject& json)
     json[CN_mosi_pin]  = mosi_pin;
     json[CN_clock_pin] = clk_pin;
     json[CN_cs_pin]    = cs_pin;
+    json[CN_sd_bus]     = sd_bus;
+    json[CN_sd_spi_mhz] = sd_spi_mhz;
+
+    json[CN_fseq_extract] = FseqExtractEnabled;
+    json[CN_fseq_start]   = FseqExtractStart;
+    json[CN_fseq_count]   = FseqExtractCount;
+    json[CN_fseq_cache_kb] = FseqCache.GetBudget ();
 
     // DEBUG_END;
 
@@ -134,32 +166,364 @@ void c_FileMgr::SetSpiIoPins ()
 
     if (SdCardInstalled)
     {
-        SD.end ();
+        EndSdCard ();
+    }
+
+    SdCardInstalled = false;
+    SdIoErrors      = 0;
+    FseqCache.FilesChanged ();
+
+    // SD_MMC first. If the card is not there, try SPI on the same slot
+    if (SD_BUS_SPI != sd_bus)
+    {
+        SdCardInstalled = BeginSdMmc ();
     }
 
+    if (!SdCardInstalled)
+    {
+        SdCardInstalled = ProbeSdSpi (sd_spi_mhz);
+    }
+
+    if (!SdCardInstalled)
+    {
+        logcon (String (F ("No SD card installed")));
+        SdCardInstalled = BeginFlashSequences ();
+    }
+
+    if (SdCardInstalled)
+    {
+        DescribeSdCardToUser ();
+    }
+
+    FseqIndex.Reload ();
+
+    // DEBUG_END;
+
+} // SetSpiIoPins
+
+//-----------------------------------------------------------------------------
+bool c_FileMgr::BeginSdMmc ()
+{
+    // DEBUG_START;
+
+    bool Response = false;
 
 #ifdef ARDUINO_ARCH_ESP32
-    SPI.begin (clk_pin, miso_pin, mosi_pin, cs_pin);
+    do // once
+    {
+        bool OneBitMode = (SD_BUS_MMC_1_BIT == sd_bus);
+
+        if (!SD_MMC.begin ("/sdcard", OneBitMode))
+        {
+            logcon (String (F ("SD_MMC card did not respond. Trying SPI.")));
+            break;
+        }
+
+        if (CARD_NONE == SD_MMC.cardType ())
+        {
+            SD_MMC.end ();
+            logcon (String (F ("No card in the SD_MMC slot. Trying SPI.")));
+            break;
+        }
+
+        SdFileSystem = &SD_MMC;
+        ActiveSdBus  = sd_bus;
+        ActiveSpiMHz = 0;
+
+        logcon (String (F ("SD card is on the ")) + String (sd_bus) + F (" bit SD_MMC bus"));
+        Response = true;
+
+    } while (false);
+#else
+    logcon (String (F ("SD_MMC is not available on this platform. Using SPI.")));
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+    return Response;
+
+} // BeginSdMmc
+
+//-----------------------------------------------------------------------------
+bool c_FileMgr::BeginSdSpi (uint32_t SpeedMHz)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        SdFileSystem = &SD;
+        SPI.begin (clk_pin, miso_pin, mosi_pin, cs_pin);
 #ifdef USE_MISO_PULLUP
-    pinMode (miso_pin, INPUT_PULLUP); // on some hardware MISO is missing required pull-up resistor, use internal pull-up.
+        pinMode (miso_pin, INPUT_PULLUP); // on some hardware MISO is missing required pull-up resistor, use internal pull-up.
 #endif // def USE_MISO_PULLUP
-    if (!SD.begin (cs_pin))
+        if (!SD.begin (cs_pin, SPI, SpeedMHz * 1000000))
 #else
-    if (!SD.begin (SD_CARD_CS_PIN, SD_CARD_CLK_MHZ))
+        SdFileSystem = &SDFS;
+        if (!SD.begin (SD_CARD_CS_PIN, SD_SCK_MHZ (SpeedMHz)))
 #endif
+        {
+            break;
+        }
+
+        // the card can answer at a clock it cannot move data at
+        if (!SdRootIsReadable ())
+        {
+            SD.end ();
+            break;
+        }
+
+        ActiveSdBus  = SD_BUS_SPI;
+        ActiveSpiMHz = SpeedMHz;
+        Response     = true;
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // BeginSdSpi
+
+//-----------------------------------------------------------------------------
+/*
+    Try the configured clock. If that fails, see whether there is a card at
+    all at the minimum clock before stepping down through the speeds in
+    between. A missing card costs two attempts, not one per speed.
+*/
+bool c_FileMgr::ProbeSdSpi (uint32_t MaxSpeedMHz)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
     {
-        logcon (String (F ("No SD card installed")));
-        SdCardInstalled = false;
+        if (BeginSdSpi (MaxSpeedMHz))
+        {
+            Response = true;
+            break;
+        }
+
+        if ((MaxSpeedMHz <= SD_CARD_MIN_SPI_MHZ) || !BeginSdSpi (SD_CARD_MIN_SPI_MHZ))
+        {
+            // nobody home
+            break;
+        }
+
+        SD.end ();
+
+        for (uint32_t SpeedMHz = NextSlowerSpiMHz (MaxSpeedMHz);
+             SpeedMHz > SD_CARD_MIN_SPI_MHZ;
+             SpeedMHz = NextSlowerSpiMHz (SpeedMHz))
+        {
+            if (BeginSdSpi (SpeedMHz))
+            {
+                Response = true;
+                break;
+            }
+        }
+
+        if (!Response)
+        {
+            Response = BeginSdSpi (SD_CARD_MIN_SPI_MHZ);
+        }
+
+    } while (false);
+
+    if (Response)
+    {
+        logcon (String (F ("SD card is on SPI at ")) + String (ActiveSpiMHz) + F (" MHz"));
+    }
+
+    // DEBUG_END;
+
+    return Response;
+
+} // ProbeSdSpi
+
+//-----------------------------------------------------------------------------
+uint32_t c_FileMgr::NextSlowerSpiMHz (uint32_t SpeedMHz)
+{
+    // the clocks the SPI hardware can make from 80 MHz, fastest first
+    static const uint8_t SpiSpeedsMHz[] = { 80, 40, 26, 20, 16, 13, 10, 8, 4, 2, 1 };
+
+    uint32_t Response = 0;
+
+    for (uint8_t CurrentSpeedMHz : SpiSpeedsMHz)
+    {
+        if (CurrentSpeedMHz < SpeedMHz)
+        {
+            Response = CurrentSpeedMHz;
+            break;
+        }
+    }
+
+    return Response;
+
+} // NextSlowerSpiMHz
+
+//-----------------------------------------------------------------------------
+/*
+    Without a card, sequences are kept in a directory in the flash file
+    system. Everything that goes through the SD file calls (upload, list,
+    play, record) then works the same, just with less room.
+*/
+bool c_FileMgr::BeginFlashSequences ()
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
+    {
+        if (!LittleFS.exists (FLASH_SEQUENCE_DIR) && !LittleFS.mkdir (FLASH_SEQUENCE_DIR))
+        {
+            logcon (String (F ("ERROR: Could not create '" FLASH_SEQUENCE_DIR "' in flash. Sequence play is not available")));
+            break;
+        }
+
+        SdFileSystem     = &LittleFS;
+        SequencesOnFlash = true;
+        Response         = true;
+
+        logcon (String (F ("Sequences are stored in flash. ")) + int64String (FlashFreeBytes () / 1024) + F ("KB free"));
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // BeginFlashSequences
+
+//-----------------------------------------------------------------------------
+uint64_t c_FileMgr::FlashFreeBytes ()
+{
+#ifdef ARDUINO_ARCH_ESP32
+    return uint64_t (LittleFS.totalBytes ()) - uint64_t (LittleFS.usedBytes ());
+#else
+    FSInfo Info;
+    LittleFS.info (Info);
+    return uint64_t (Info.totalBytes) - uint64_t (Info.usedBytes);
+#endif // def ARDUINO_ARCH_ESP32
+
+} // FlashFreeBytes
+
+//-----------------------------------------------------------------------------
+String c_FileMgr::SdPath (const String & FileName)
+{
+    String Response = SequencesOnFlash ? String (F (FLASH_SEQUENCE_DIR)) : String ();
+
+    if (0 == FileName.length ())
+    {
+        // the directory itself
+        return (0 == Response.length ()) ? String ("/") : Response;
+    }
+
+    if (!FileName.startsWith ("/"))
+    {
+        Response += "/";
+    }
+
+    return Response + FileName;
+
+} // SdPath
+
+//-----------------------------------------------------------------------------
+void c_FileMgr::EndSdCard ()
+{
+    // DEBUG_START;
+
+    if (SequencesOnFlash)
+    {
+        // flash stays mounted for the config files
+        SequencesOnFlash = false;
+    }
+#ifdef ARDUINO_ARCH_ESP32
+    else if (SD_BUS_SPI != ActiveSdBus)
+    {
+        SD_MMC.end ();
     }
     else
+#endif // def ARDUINO_ARCH_ESP32
     {
-        SdCardInstalled = true;
-        DescribeSdCardToUser ();
+        SD.end ();
     }
 
+    ActiveSdBus  = SD_BUS_SPI;
+    ActiveSpiMHz = 0;
+
+    // back to the SPI file system until the next mount picks one
+#ifdef ARDUINO_ARCH_ESP32
+    SdFileSystem = &SD;
+#else
+    SdFileSystem = &SDFS;
+#endif // def ARDUINO_ARCH_ESP32
+
     // DEBUG_END;
 
-} // SetSpiIoPins
+} // EndSdCard
+
+//-----------------------------------------------------------------------------
+bool c_FileMgr::SdRootIsReadable ()
+{
+    // DEBUG_START;
+
+    File root = SD.open ("/");
+    bool Response = root && root.isDirectory ();
+    if (root)
+    {
+        root.close ();
+    }
+
+    // DEBUG_END;
+
+    return Response;
+
+} // SdRootIsReadable
+
+//-----------------------------------------------------------------------------
+uint64_t c_FileMgr::SdCardSize ()
+{
+    if (SequencesOnFlash)
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        return LittleFS.totalBytes ();
+#else
+        FSInfo Info;
+        LittleFS.info (Info);
+        return Info.totalBytes;
+#endif // def ARDUINO_ARCH_ESP32
+    }
+
+#ifdef ARDUINO_ARCH_ESP32
+    return (SD_BUS_SPI != ActiveSdBus) ? SD_MMC.cardSize () : SD.cardSize ();
+#else
+    return SD.size64 ();
+#endif // def ARDUINO_ARCH_ESP32
+
+} // SdCardSize
+
+//-----------------------------------------------------------------------------
+bool c_FileMgr::SdFilesAreOpen ()
+{
+    bool Response = false;
+
+    for (auto & currentFileListEntry : FileList)
+    {
+        if (0 != currentFileListEntry.handle)
+        {
+            Response = true;
+            break;
+        }
+    }
+
+    return Response;
+
+} // SdFilesAreOpen
 
 //-----------------------------------------------------------------------------
 void c_FileMgr::DeleteConfigFile (const String& FileName)
@@ -551,17 +915,15 @@ c_FileMgr::FileId c_FileMgr::CreateSdFileHandle ()
 void c_FileMgr::DeleteSdFile (const String & FileName)
 {
     // DEBUG_START;
-    String FileNamePrefix;
-    if (!FileName.startsWith ("/"))
-    {
-        FileNamePrefix = "/";
-    }
+    String FullFileName = SdPath (FileName);
+    FseqCache.FilesChanged ();
+    FseqIndex.Forget (FileName);
     // DEBUG_V ();
 
-    if (SD.exists (FileNamePrefix+FileName))
+    if (SdFileSystem->exists (FullFileName))
     {
         // DEBUG_V (String ("Deleting '") + FileName + "'");
-        SD.remove (FileNamePrefix+FileName);
+        SdFileSystem->remove (FullFileName);
     }
 
     // DEBUG_END;
@@ -573,14 +935,15 @@ void c_FileMgr::DescribeSdCardToUser ()
 {
     // DEBUG_START;
 
-#ifdef ARDUINO_ARCH_ESP32
-    uint64_t cardSize = SD.cardSize () / (1024 * 1024);
-#else
-    uint64_t cardSize = SD.size64 () / (1024 * 1024);
-#endif // def ARDUINO_ARCH_ESP32
-
-    logcon (String (F ("SD Card Size: ")) + int64String (cardSize) + "MB");
-    File root = SD.open ("/");
+    if (SequencesOnFlash)
+    {
+        logcon (String (F ("Sequence space in flash: ")) + int64String (SdCardSize () / 1024) + "KB");
+    }
+    else
+    {
+        logcon (String (F ("SD Card Size: ")) + int64String (SdCardSize () / (1024 * 1024)) + "MB");
+    }
+    File root = SdFileSystem->open (SdPath (String ()), CN_r);
 
     printDirectory (root, 0);
 
@@ -610,14 +973,10 @@ void c_FileMgr::GetListOfSdFiles (String & Response)
             break;
         }
 
-#ifdef ARDUINO_ARCH_ESP32
-        ResponseJsonDoc[F ("totalBytes")] = SD.cardSize ();
-#else
-        ResponseJsonDoc[F ("totalBytes")] = SD.size64 ();
-#endif
+        ResponseJsonDoc[F ("totalBytes")] = SdCardSize ();
         uint64_t usedBytes = 0;
 
-        File dir = SDFS.open ("/", CN_r);
+        File dir = SdFileSystem->open (SdPath (String ()), CN_r);
 
         while (true)
         {
@@ -632,12 +991,13 @@ void c_FileMgr::GetListOfSdFiles (String & Response)
             usedBytes += entry.size ();
 
             String EntryName = String (entry.name ());
-            EntryName = EntryName.substring ((('/' == EntryName[0]) ? 1 : 0));
+            EntryName = EntryName.substring (EntryName.lastIndexOf ('/') + 1);
             // DEBUG_V ("EntryName: " + EntryName);
             // DEBUG_V ("EntryName.length(): " + String(EntryName.length ()));
 
             if ((0 != EntryName.length ()) &&
                 (EntryName != String (F ("System Volume Information"))) &&
+                !FseqIndex.IsIndexFile (EntryName) &&
                 (0 != entry.size ())
                )
             {
@@ -749,18 +1109,21 @@ bool c_FileMgr::OpenSdFile (const String & FileName, FileMode Mode, FileId & Fil
 
         // DEBUG_V ();
 
-        String FileNamePrefix;
-        if (!FileName.startsWith ("/"))
+        String FullFileName = SdPath (FileName);
+
+        // DEBUG_V (String("FileName: '") + FullFileName + "'");
+
+        if (FileMode::FileRead != Mode)
         {
-            FileNamePrefix = "/";
+            // a cached copy may be about to go out of date
+            FseqCache.FilesChanged ();
+            FseqIndex.Forget (FileName);
         }
 
-        // DEBUG_V (String("FileName: '") + FileNamePrefix + FileName + "'");
-
         if (FileMode::FileRead == Mode)
         {
             // DEBUG_V (String("Read FIle"));
-            if (false == SDFS.exists (FileNamePrefix + FileName))
+            if (false == SdFileSystem->exists (FullFileName))
             {
                 logcon (String (F ("ERROR: Cannot open '")) + FileName + F ("' for reading. File does not exist."));
                 break;
@@ -774,7 +1137,7 @@ bool c_FileMgr::OpenSdFile (const String & FileName, FileMode Mode, FileId & Fil
         int FileListIndex;
         if (-1 != (FileListIndex = FileListFindSdFileHandle (FileHandle)))
         {
-            FileList[FileListIndex].info = SDFS.open (FileNamePrefix + FileName, ReadWrite);
+            FileList[FileListIndex].info = SdFileSystem->open (FullFileName, ReadWrite);
 
             // DEBUG_V ();
             if (FileMode::FileWrite == Mode)
@@ -918,8 +1281,17 @@ size_t c_FileMgr::ReadSdFile (const FileId& FileHandle, byte* FileData, size_t N
     int FileListIndex;
     if (-1 != (FileListIndex = FileListFindSdFileHandle (FileHandle)))
     {
-        ReadBufferingStream bufferedFileRead{ FileList[FileListIndex].info, 128 };
+        File & CurrentFile = FileList[FileListIndex].info;
+        size_t BytesInFile = CurrentFile.size () - min (CurrentFile.size (), CurrentFile.position ());
+
+        ReadBufferingStream bufferedFileRead{ CurrentFile, 128 };
         response = bufferedFileRead.readBytes (((char*)FileData), NumBytesToRead);
+
+        if (response < min (NumBytesToRead, BytesInFile))
+        {
+            // the data is there but the card did not deliver it
+            ++SdIoErrors;
+        }
     }
     else
     {
@@ -958,8 +1330,20 @@ size_t c_FileMgr::WriteSdFile (const FileId& FileHandle, byte* FileData, size_t
     // DEBUG_V (String("Bytes to write: ") + String(NumBytesToWrite));
     if (-1 != (FileListIndex = FileListFindSdFileHandle (FileHandle)))
     {
-        WriteBufferingStream bufferedFileWrite{ FileList[FileListIndex].info, 128 };
-        response = bufferedFileWrite.write (FileData, NumBytesToWrite);
+        if (SequencesOnFlash && ((NumBytesToWrite + FLASH_SEQUENCE_RESERVE) > FlashFreeBytes ()))
+        {
+            // do not let a sequence take the room the config files need
+        }
+        else
+        {
+            WriteBufferingStream bufferedFileWrite{ FileList[FileListIndex].info, 128 };
+            response = bufferedFileWrite.write (FileData, NumBytesToWrite);
+
+            if ((response != NumBytesToWrite) && !SequencesOnFlash)
+            {
+                ++SdIoErrors;
+            }
+        }
     }
     else
     {
@@ -1007,6 +1391,24 @@ size_t c_FileMgr::GetSdFileSize (const FileId& FileHandle)
 
 } // GetSdFileSize
 
+//-----------------------------------------------------------------------------
+time_t c_FileMgr::GetSdFileTime (const FileId& FileHandle)
+{
+    time_t response = 0;
+    int FileListIndex;
+    if (-1 != (FileListIndex = FileListFindSdFileHandle (FileHandle)))
+    {
+        response = FileList[FileListIndex].info.getLastWrite ();
+    }
+    else
+    {
+        logcon (String (F ("GetSdFileTime::ERROR::Invalid File Handle: ")) + String (FileHandle));
+    }
+
+    return response;
+
+} // GetSdFileTime
+
 //-----------------------------------------------------------------------------
 void c_FileMgr::handleFileUpload (const String & filename,
     size_t index,
@@ -1026,67 +1428,352 @@ void c_FileMgr::handleFileUpload (const String & filename,
 
     if ((0 != len) && (0 != fsUploadFileName.length ()))
     {
-        if (nullptr == FileUploadBuffer)
+        if (UploadExtractor.IsActive ())
         {
-            // Write data
-            // DEBUG_V ("UploadWrite: " + String (len) + String (" bytes"));
-            WriteSdFile (fsUploadFile, data, len);
-            // LOG_PORT.print (String ("Writting bytes: ") + String (index) + '\r');
-            // LOG_PORT.print (".");
+            UploadExtractor.Write (data, len);
         }
         else
         {
-            // is there space in the buffer for this chunk?
-            if (((len + FileUploadBufferOffset) >= FileUploadBufferSize) &&
-                (0 != FileUploadBufferOffset))
+            WriteUploadData (data, len);
+        }
+    }
+
+    if ((true == final) && (0 != fsUploadFileName.length ()))
+    {
+        UploadExtractor.End ();
+
+        // save the last bits
+        StopUploadWriter (!UploadAborted);
+
+        if (UploadAborted)
+        {
+            logcon (String (F ("ERROR: Upload of '")) + fsUploadFileName + String (F ("' was aborted. The partial file will be deleted.")));
+        }
+        else if (UploadWriteError && SequencesOnFlash)
+        {
+            logcon (String (F ("ERROR: Not enough room in flash for '")) + fsUploadFileName + String (F ("'")));
+        }
+        else if (UploadWriteError)
+        {
+            logcon (String (F ("ERROR: SD write failed while uploading '")) + fsUploadFileName + String (F ("'")));
+        }
+
+        uint32_t uploadTime = (uint32_t)(millis() - fsUploadStartTime) / 1000;
+        logcon (String (F ("Upload File: '")) + fsUploadFileName +
+                String (F ("' Done (")) + String (uploadTime) + String (F ("s). Waited for the SD card ")) +
+                String (UploadWaitCount) + String (F (" times")));
+
+        CloseSdFile (fsUploadFile);
+        if (UploadAborted)
+        {
+            // do not leave a partial file behind
+            DeleteSdFile (fsUploadFileName);
+        }
+        fsUploadFileName = "";
+        FseqIndex.Rescan ();
+    }
+
+    // DEBUG_END;
+} // handleFileUpload
+
+//-----------------------------------------------------------------------------
+/*
+    Copy upload data into the active block. Full blocks are handed to the
+    writer. If the writer still owns the block we need next, wait for it.
+*/
+void c_FileMgr::WriteUploadData (uint8_t * data, size_t len)
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        if (UploadAborted)
+        {
+            // the rest of the file is dropped
+            break;
+        }
+
+        if (nullptr == UploadBlocks[0].Data)
+        {
+            // no buffers. Write data
+            // DEBUG_V ("UploadWrite: " + String (len) + String (" bytes"));
+            if (len != WriteSdFile (fsUploadFile, data, len))
             {
-                // write out the buffer
-                WriteSdFile (fsUploadFile, FileUploadBuffer, FileUploadBufferOffset);
-                FileUploadBufferOffset = 0;
+                UploadWriteError = true;
             }
+            break;
+        }
+
+        while (len)
+        {
+            UploadBlock_t & Block = UploadBlocks[ActiveUploadBlock];
 
-            // will this chunk fit in the buffer
-            if (len < FileUploadBufferSize)
+            if (Block.Full)
             {
-                memcpy (&FileUploadBuffer[FileUploadBufferOffset], data, len);
-                FileUploadBufferOffset += len;
+                // every block is waiting for the SD card
+                ++UploadWaitCount;
+                if (!WaitForUploadBlock (ActiveUploadBlock))
+                {
+                    logcon (String (F ("ERROR: The SD card stopped accepting data. Aborting the upload of '")) + fsUploadFileName + String (F ("'")));
+                    UploadWriteError = true;
+                    UploadAborted    = true;
+                    break;
+                }
             }
-            else
+
+            size_t BytesToCopy = min (len, size_t (FILE_UPLOAD_BLOCK_SIZE - Block.Used));
+            memcpy (&Block.Data[Block.Used], data, BytesToCopy);
+            Block.Used += BytesToCopy;
+            data       += BytesToCopy;
+            len        -= BytesToCopy;
+
+            if (FILE_UPLOAD_BLOCK_SIZE == Block.Used)
             {
-                // chunk is bigger than our buffer
-                WriteSdFile (fsUploadFile, data, len);
+                QueueUploadBlock ();
             }
         }
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // WriteUploadData
+
+//-----------------------------------------------------------------------------
+bool c_FileMgr::StartUploadWriter ()
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
+    {
+        bool AllocFailed = false;
+        for (UploadBlock_t & Block : UploadBlocks)
+        {
+            Block.Used = 0;
+            Block.Full = false;
+            Block.Data = (uint8_t *)malloc (FILE_UPLOAD_BLOCK_SIZE);
+            AllocFailed |= (nullptr == Block.Data);
+        }
+
+        if (AllocFailed)
+        {
+            logcon (String (F ("WARNING: Not enough memory for the upload buffers. Writing straight to the SD card.")));
+            FreeUploadBlocks ();
+            break;
+        }
+
+        ActiveUploadBlock      = 0;
+        NextUploadBlockToWrite = 0;
+
+#ifdef ARDUINO_ARCH_ESP32
+        if (NULL == UploadBlockFreed)
+        {
+            UploadBlockFreed = xSemaphoreCreateBinary ();
+        }
+
+        if (NULL == UploadWriterDone)
+        {
+            UploadWriterDone = xSemaphoreCreateBinary ();
+        }
+
+        if ((NULL == UploadBlockFreed) || (NULL == UploadWriterDone))
+        {
+            logcon (String (F ("WARNING: Could not create the upload semaphore. Writing straight to the SD card.")));
+            FreeUploadBlocks ();
+            break;
+        }
+
+        // forget a notice left over from the last upload
+        xSemaphoreTake (UploadBlockFreed, 0);
+        UploadWriterExit = false;
+
+        xTaskCreate (FileUploadWriterTask, "UploadTask", FILE_UPLOAD_TASK_STACK, this, ESP_TASK_PRIO_MIN + 3, &UploadWriterTaskHandle);
+        if (NULL == UploadWriterTaskHandle)
+        {
+            logcon (String (F ("WARNING: Could not start the upload writer task. Writing straight to the SD card.")));
+            FreeUploadBlocks ();
+            break;
+        }
+#endif // def ARDUINO_ARCH_ESP32
+
+        Response = true;
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // StartUploadWriter
+
+//-----------------------------------------------------------------------------
+/*
+    Hand over the partial block (unless the upload is being dropped), wait
+    for the writer to finish and release the buffers.
+*/
+void c_FileMgr::StopUploadWriter (bool SaveData)
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        if (nullptr == UploadBlocks[0].Data)
+        {
+            break;
+        }
+
+        // a block with data in it is never owned by the writer
+        if (SaveData && (0 != UploadBlocks[ActiveUploadBlock].Used))
+        {
+            QueueUploadBlock ();
+        }
+
+#ifdef ARDUINO_ARCH_ESP32
+        // wait for the writer to drain
+        for (uint32_t BlockIndex = 0; BlockIndex < FILE_UPLOAD_NUM_BLOCKS; ++BlockIndex)
+        {
+            if (!WaitForUploadBlock (BlockIndex))
+            {
+                logcon (String (F ("ERROR: The SD card did not finish writing '")) + fsUploadFileName + String (F ("'")));
+                UploadWriteError = true;
+                UploadAborted    = true;
+                break;
+            }
+        }
+
+        // The writer may still be inside an SD write using a block. Ask it
+        // to end and wait until it is done before the blocks are freed.
+        UploadWriterExit = true;
+        xTaskNotifyGive (UploadWriterTaskHandle);
+        xSemaphoreTake (UploadWriterDone, portMAX_DELAY);
+        UploadWriterTaskHandle = NULL;
+#endif // def ARDUINO_ARCH_ESP32
+
+        FreeUploadBlocks ();
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // StopUploadWriter
+
+//-----------------------------------------------------------------------------
+void c_FileMgr::QueueUploadBlock ()
+{
+    // DEBUG_START;
+
+    UploadBlocks[ActiveUploadBlock].Full = true;
+    ActiveUploadBlock = (ActiveUploadBlock + 1) % FILE_UPLOAD_NUM_BLOCKS;
+
+#ifdef ARDUINO_ARCH_ESP32
+    xTaskNotifyGive (UploadWriterTaskHandle);
+#else
+    // no writer task
+    WriteFullUploadBlocks ();
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // QueueUploadBlock
+
+//-----------------------------------------------------------------------------
+/*
+    Sleep until the writer gives the block back. Returns false if it did not
+    free a block within FILE_UPLOAD_WAIT_MS. Without a writer task blocks
+    are written as soon as they fill, so there is never anything to wait for.
+*/
+bool c_FileMgr::WaitForUploadBlock (uint32_t BlockIndex)
+{
+    // DEBUG_START;
+
+    bool Response = true;
+
+#ifdef ARDUINO_ARCH_ESP32
+    while (UploadBlocks[BlockIndex].Full)
+    {
+        if (pdTRUE != xSemaphoreTake (UploadBlockFreed, pdMS_TO_TICKS (FILE_UPLOAD_WAIT_MS)))
+        {
+            Response = false;
+            break;
+        }
     }
+#endif // def ARDUINO_ARCH_ESP32
 
-    if ((true == final) && (0 != fsUploadFileName.length ()))
+    // DEBUG_END;
+
+    return Response;
+
+} // WaitForUploadBlock
+
+#ifdef ARDUINO_ARCH_ESP32
+//-----------------------------------------------------------------------------
+void c_FileMgr::RunUploadWriter ()
+{
+    // DEBUG_START;
+
+    while (!UploadWriterExit)
     {
-        // save the last bits
-        if (FileUploadBufferOffset)
+        // sleep until the upload hands over a full block or StopUploadWriter () ends it
+        ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+        WriteFullUploadBlocks ();
+    }
+
+    // StopUploadWriter () may now free the blocks
+    xSemaphoreGive (UploadWriterDone);
+
+    // DEBUG_END;
+
+} // RunUploadWriter
+#endif // def ARDUINO_ARCH_ESP32
+
+//-----------------------------------------------------------------------------
+void c_FileMgr::WriteFullUploadBlocks ()
+{
+    // DEBUG_START;
+
+    while (!UploadWriterExit && UploadBlocks[NextUploadBlockToWrite].Full)
+    {
+        UploadBlock_t & Block = UploadBlocks[NextUploadBlockToWrite];
+        if (Block.Used != WriteSdFile (fsUploadFile, Block.Data, Block.Used))
         {
-            WriteSdFile (fsUploadFile, FileUploadBuffer, FileUploadBufferOffset);
-            FileUploadBufferOffset = 0;
+            UploadWriteError = true;
         }
 
-        uint32_t uploadTime = (uint32_t)(millis() - fsUploadStartTime) / 1000;
-        logcon (String (F ("Upload File: '")) + fsUploadFileName +
-                String (F ("' Done (")) + String (uploadTime) + String (F ("s)")));
+        // give the block back to the upload
+        Block.Used = 0;
+        Block.Full = false;
+        NextUploadBlockToWrite = (NextUploadBlockToWrite + 1) % FILE_UPLOAD_NUM_BLOCKS;
 
-        CloseSdFile (fsUploadFile);
-        fsUploadFileName = "";
+#ifdef ARDUINO_ARCH_ESP32
+        xSemaphoreGive (UploadBlockFreed);
+#endif // def ARDUINO_ARCH_ESP32
+    }
+
+    // DEBUG_END;
 
-        if (nullptr != FileUploadBuffer)
+} // WriteFullUploadBlocks
+
+//-----------------------------------------------------------------------------
+void c_FileMgr::FreeUploadBlocks ()
+{
+    // DEBUG_START;
+
+    for (UploadBlock_t & Block : UploadBlocks)
+    {
+        if (nullptr != Block.Data)
         {
-            // DEBUG_V (String (" Free Upload Buffer. Heap: ") + String (ESP.getFreeHeap ()));
-            free (FileUploadBuffer);
-            FileUploadBuffer = nullptr;
-            FileUploadBufferOffset = 0;
-            // DEBUG_V (String ("Freed Upload Buffer. Heap: ") + String (ESP.getFreeHeap ()));
+            free (Block.Data);
+            Block.Data = nullptr;
         }
+        Block.Used = 0;
+        Block.Full = false;
     }
 
     // DEBUG_END;
-} // handleFileUpload
+
+} // FreeUploadBlocks
 
 //-----------------------------------------------------------------------------
 void c_FileMgr::handleFileUploadNewFile (const String & filename)
@@ -1102,6 +1789,7 @@ void c_FileMgr::handleFileUploadNewFile (const String & filename)
     if (0 != fsUploadFileName.length ())
     {
         logcon (String (F ("Aborting Previous File Upload For: '")) + fsUploadFileName + String (F ("'")));
+        StopUploadWriter (false);
         FileMgr.CloseSdFile (fsUploadFile);
         fsUploadFileName = "";
     }
@@ -1116,30 +1804,67 @@ void c_FileMgr::handleFileUploadNewFile (const String & filename)
     // Open the file for writing
     FileMgr.OpenSdFile (fsUploadFileName, FileMode::FileWrite, fsUploadFile);
 
-    if (nullptr == FileUploadBuffer)
+    UploadWriteError = false;
+    UploadAborted    = false;
+    UploadWaitCount  = 0;
+    StartUploadWriter ();
+
+    UploadExtractor.Abort ();
+    String LowerCaseName = filename;
+    LowerCaseName.toLowerCase ();
+    if (FseqExtractEnabled && LowerCaseName.endsWith (String (F (".fseq"))))
     {
-        FileUploadBuffer = (byte*)malloc (FileUploadBufferSize);
-        if (nullptr != FileUploadBuffer)
-        {
-            // DEBUG_V ("Allocated file upload buffer");
-        }
-        else
-        {
-            // DEBUG_V ("Failed to Allocate file upload buffer");
-        }
+        uint32_t NumChannels = (0 != FseqExtractCount) ? FseqExtractCount : OutputMgr.GetBufferUsedSize ();
+        UploadExtractor.Begin (FseqExtractStart - 1, NumChannels,
+            [this](uint8_t * Data, size_t Length) { WriteUploadData (Data, Length); });
     }
 
-    FileUploadBufferOffset = 0;
-
     // DEBUG_END;
 
 } // handleFileUploadNewFile
 
 //-----------------------------------------------------------------------------
+/*
+    Step the SPI clock down when the card keeps failing. The card is
+    remounted, so wait until nothing is open.
+*/
 void c_FileMgr::Poll ()
 {
     // DEBUG_START;
 
+    do // once
+    {
+        if ((SdIoErrors < SD_CARD_MAX_IO_ERRORS) || !SdCardInstalled || SequencesOnFlash || (SD_BUS_SPI != ActiveSdBus))
+        {
+            break;
+        }
+
+        if (SdFilesAreOpen ())
+        {
+            break;
+        }
+
+        uint32_t SlowerSpeedMHz = NextSlowerSpiMHz (ActiveSpiMHz);
+        SdIoErrors = 0;
+
+        if (0 == SlowerSpeedMHz)
+        {
+            // already as slow as it goes
+            break;
+        }
+
+        logcon (String (F ("SD card errors at ")) + String (ActiveSpiMHz) + F (" MHz. Slowing the SPI clock to ") + String (SlowerSpeedMHz) + F (" MHz"));
+
+        EndSdCard ();
+        SdCardInstalled = BeginSdSpi (SlowerSpeedMHz);
+        if (!SdCardInstalled)
+        {
+            logcon (String (F ("ERROR: SD card did not come back")));
+        }
+
+    } while (false);
+
+    FseqIndex.Poll ();
 
     // DEBUG_END;
 
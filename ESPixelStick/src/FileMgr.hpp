@@ -22,12 +22,21 @@
 #include <FS.h>
 #include <LittleFS.h>
 #include <SD.h>
+#ifdef ARDUINO_ARCH_ESP32
+#   include <SD_MMC.h>
+#endif // def ARDUINO_ARCH_ESP32
 #include <map>
+#include "service/FseqExtractor.hpp"
 
 #ifdef ARDUINO_ARCH_ESP32
-#	define SDFS SD
+// SD over SPI or SD_MMC. Whichever mounted.
+#	define SDFS (FileMgr.GetSdFileSystem ())
 #endif
 
+// Where sequences go in flash when there is no SD card
+#define FLASH_SEQUENCE_DIR          "/fseq"
+#define FLASH_SEQUENCE_RESERVE      (32 * 1024)     ///< Flash left free for the config files
+
 class c_FileMgr
 {
 public:
@@ -61,7 +70,10 @@ public:
     bool   ReadConfigFile   (const String & FileName, byte * FileData, size_t maxlen);
     bool   LoadConfigFile   (const String & FileName, DeserializationHandler Handler);
 
-    bool   SdCardIsInstalled () { return SdCardInstalled; }
+    bool   SdCardIsInstalled () { return SdCardInstalled; }      ///< true when sequences can be stored. Card or flash
+    bool   SequencesAreOnFlash () { return SequencesOnFlash; }
+    fs::FS & GetSdFileSystem () { return *SdFileSystem; }
+    String SdPath           (const String & FileName);
     FileId CreateSdFileHandle ();
     void   DeleteSdFile     (const String & FileName);
     void   SaveSdFile       (const String & FileName,   String & FileData);
@@ -76,8 +88,13 @@ public:
     void   CloseSdFile      (const FileId & FileHandle);
     void   GetListOfSdFiles (String & Response);
     size_t GetSdFileSize    (const FileId & FileHandle);
+    time_t GetSdFileTime    (const FileId & FileHandle);
     void   GetDriverName (String& Name) { Name = "FileMgr"; }
 
+#ifdef ARDUINO_ARCH_ESP32
+    void   RunUploadWriter  ();                     ///< Body of the upload writer task
+#endif // def ARDUINO_ARCH_ESP32
+
     // Configuration file params
 #if defined ARDUINO_ARCH_ESP8266
 #   // define CONFIG_MAX_SIZE (3*1024)    ///< Sanity limit for config file
@@ -87,11 +104,46 @@ public:
 private:
     void   SetSpiIoPins ();
 
-#   define SD_CARD_CLK_MHZ     SD_SCK_MHZ(50)  // 50 MHz SPI clock
+    /// The SPI clock starts at sd_spi_mhz and steps down until the card
+    /// answers and its root directory can be read. Repeated read or write
+    /// errors step it down again once no files are open.
+#ifdef ARDUINO_ARCH_ESP32
+#   define SD_CARD_DEFAULT_SPI_MHZ  20
+#else
+#   define SD_CARD_DEFAULT_SPI_MHZ  50
+#endif // def ARDUINO_ARCH_ESP32
+#   define SD_CARD_MAX_SPI_MHZ      80
+#   define SD_CARD_MIN_SPI_MHZ      4      // Every card works at this speed
+#   define SD_CARD_MAX_IO_ERRORS    5
+
+#define SD_BUS_SPI                  0
+#define SD_BUS_MMC_1_BIT            1
+#define SD_BUS_MMC_4_BIT            4
+#ifndef SD_CARD_DEFAULT_BUS
+#   define SD_CARD_DEFAULT_BUS      SD_BUS_SPI
+#endif // ndef SD_CARD_DEFAULT_BUS
+
+    bool     BeginSdMmc ();
+    bool     BeginSdSpi (uint32_t SpeedMHz);
+    bool     ProbeSdSpi (uint32_t MaxSpeedMHz);
+    void     EndSdCard ();
+    bool     SdRootIsReadable ();
+    bool     BeginFlashSequences ();
+    uint64_t SdCardSize ();
+    uint64_t FlashFreeBytes ();
+    bool     SdFilesAreOpen ();
+    uint32_t NextSlowerSpiMHz (uint32_t SpeedMHz);
 
     void listDir (fs::FS& fs, String dirname, uint8_t levels);
     void DescribeSdCardToUser ();
     void handleFileUploadNewFile (const String & filename);
+    void WriteUploadData (uint8_t * data, size_t len);
+    bool StartUploadWriter ();
+    void StopUploadWriter (bool SaveData);
+    void QueueUploadBlock ();
+    bool WaitForUploadBlock (uint32_t BlockIndex);
+    void FreeUploadBlocks ();
+    void WriteFullUploadBlocks ();
     void printDirectory (File dir, int numTabs);
 
     bool     SdCardInstalled = false;
@@ -99,6 +151,17 @@ private:
     uint8_t  mosi_pin = SD_CARD_MOSI_PIN;
     uint8_t  clk_pin  = SD_CARD_CLK_PIN;
     uint8_t  cs_pin   = SD_CARD_CS_PIN;
+    uint8_t  sd_bus      = SD_CARD_DEFAULT_BUS;         ///< SD_BUS_SPI or the number of SD_MMC data lines
+    uint8_t  sd_spi_mhz  = SD_CARD_DEFAULT_SPI_MHZ;     ///< Fastest SPI clock to try
+    uint8_t  ActiveSdBus = SD_BUS_SPI;
+    uint32_t ActiveSpiMHz = 0;
+    volatile uint32_t SdIoErrors = 0;                   ///< Short reads and writes since the card was mounted
+    bool     SequencesOnFlash = false;                  ///< No card. The "SD" files live in FLASH_SEQUENCE_DIR
+#ifdef ARDUINO_ARCH_ESP32
+    fs::FS * SdFileSystem = &SD;
+#else
+    fs::FS * SdFileSystem = &SDFS;
+#endif // def ARDUINO_ARCH_ESP32
     FileId   fsUploadFile;
     String   fsUploadFileName;
     bool     fsUploadFileSavedIsEnabled = false;
@@ -116,8 +179,47 @@ private:
     int FileListFindSdFileHandle (FileId HandleToFind);
     void InitSdFileList ();
 
-    byte   * FileUploadBuffer = nullptr;
-    uint32_t FileUploadBufferOffset = 0;
+    /// Uploads are gathered into whole sector blocks. On the ESP32 a writer
+    /// task writes full blocks while the network fills the next one. When
+    /// every block is waiting for the SD card the upload callback sleeps
+    /// until the writer frees one, which holds off the sender. If the card
+    /// does not free a block in time the upload is aborted.
+#define FILE_UPLOAD_SECTOR_SIZE     512
+#ifdef ARDUINO_ARCH_ESP32
+#   define FILE_UPLOAD_NUM_BLOCKS   3
+#   define FILE_UPLOAD_BLOCK_SIZE   (8 * FILE_UPLOAD_SECTOR_SIZE)
+#   define FILE_UPLOAD_TASK_STACK   4096
+#   define FILE_UPLOAD_WAIT_MS      2000    // longest wait for the writer to free a block
+#else
+#   define FILE_UPLOAD_NUM_BLOCKS   1
+#   define FILE_UPLOAD_BLOCK_SIZE   (10 * FILE_UPLOAD_SECTOR_SIZE)
+#endif // def ARDUINO_ARCH_ESP32
+
+    typedef struct
+    {
+        uint8_t         * Data;
+        uint32_t          Used;
+        volatile bool     Full;     ///< Owned by the writer until it is cleared
+    } UploadBlock_t;
+
+    UploadBlock_t UploadBlocks[FILE_UPLOAD_NUM_BLOCKS];
+    uint32_t      ActiveUploadBlock      = 0;   ///< Block the upload is filling
+    uint32_t      NextUploadBlockToWrite = 0;   ///< Block the writer takes next
+    volatile bool UploadWriteError       = false;
+    volatile bool UploadWriterExit       = false; ///< Tells the writer to stop taking blocks
+    bool          UploadAborted          = false; ///< The writer stopped freeing blocks. Drop the rest
+    uint32_t      UploadWaitCount        = 0;   ///< Times the upload had to wait for the SD card
+#ifdef ARDUINO_ARCH_ESP32
+    TaskHandle_t      UploadWriterTaskHandle = NULL;
+    SemaphoreHandle_t UploadBlockFreed       = NULL; ///< Given by the writer each time it frees a block
+    SemaphoreHandle_t UploadWriterDone       = NULL; ///< Given by the writer just before it ends
+#endif // def ARDUINO_ARCH_ESP32
+
+    /// Optionally keep only our channels of an uploaded sequence
+    c_FseqExtractor UploadExtractor;
+    bool     FseqExtractEnabled = false;
+    uint32_t FseqExtractStart   = 1;    ///< First channel kept. 1 based
+    uint32_t FseqExtractCount   = 0;    ///< Channels kept. 0 = what the outputs use
 
 protected:
 
@@ -36,3 +36,5 @@
 #define SD_CARD_MOSI_PIN        gpio_num_t::GPIO_NUM_15
 #define SD_CARD_CLK_PIN         gpio_num_t::GPIO_NUM_14
 #define SD_CARD_CS_PIN          gpio_num_t::GPIO_NUM_13
+// The card slot is on the SD_MMC pins. 1 bit mode leaves GPIO 4 (flash LED) and 12 alone
+#define SD_CARD_DEFAULT_BUS     SD_BUS_MMC_1_BIT
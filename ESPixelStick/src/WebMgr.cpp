@@ -23,6 +23,9 @@
 #include "input/InputMgr.hpp"
 #include "service/FPPDiscovery.h"
 #include "network/NetworkMgr.hpp"
+#include "network/UdpRxTask.hpp"
+#include "service/LatencyTracker.hpp"
+#include "service/FseqRecorder.hpp"
 
 #include "WebMgr.hpp"
 #include "FileMgr.hpp"
@@ -141,6 +144,50 @@ void c_WebMgr::init ()
             request->send (200, CN_textSLASHplain, String (ESP.getFreeHeap ()).c_str());
         });
 
+    // Packet arrival to output start latency. "/latency?reset" clears the histogram
+    webServer.on ("/latency", HTTP_GET, [](AsyncWebServerRequest* request)
+        {
+            DynamicJsonDocument LatencyDoc (4096);
+            JsonObject LatencyJson = LatencyDoc.to<JsonObject> ();
+            LatencyTracker.GetHistogram (LatencyJson);
+
+            String Response;
+            serializeJson (LatencyDoc, Response);
+            request->send (200, "text/json", Response);
+
+            if (request->hasParam ("reset"))
+            {
+                LatencyTracker.Reset ();
+            }
+        });
+
+    // Record the live input to the SD card. "/record?file=name.fseq&step=25" starts, "/record?stop" stops.
+    // The request is carried out by the next loop () so the status reply may not show it yet.
+    webServer.on ("/record", HTTP_GET, [](AsyncWebServerRequest* request)
+        {
+            if (request->hasParam ("stop"))
+            {
+                FseqRecorder.RequestStop ();
+            }
+            else if (request->hasParam ("file"))
+            {
+                uint32_t StepTimeMS = 25;
+                if (request->hasParam ("step"))
+                {
+                    StepTimeMS = request->getParam ("step")->value ().toInt ();
+                }
+                FseqRecorder.RequestStart (request->getParam ("file")->value (), StepTimeMS);
+            }
+
+            DynamicJsonDocument RecordDoc (512);
+            JsonObject RecordJson = RecordDoc.to<JsonObject> ();
+            FseqRecorder.GetStatus (RecordJson);
+
+            String Response;
+            serializeJson (RecordDoc, Response);
+            request->send (200, "text/json", Response);
+        });
+
     // JSON Config Handler
 //TODO: This is only being used by FPP to get the hostname.  Will submit PR to change FPP and remove this
 //      https://github.com/FalconChristmas/fpp/blob/ae10a0b6fb1e32d1982c2296afac9af92e4da908/src/NetworkController.cpp#L248
@@ -244,7 +291,7 @@ void c_WebMgr::init ()
         String filename = request->url ().substring (String ("/download").length ());
         // DEBUG_V (String ("filename: ") + String (filename));
 
-        AsyncWebServerResponse* response = new AsyncFileResponse (SDFS, filename, "application/octet-stream", true);
+        AsyncWebServerResponse* response = new AsyncFileResponse (FileMgr.GetSdFileSystem (), FileMgr.SdPath (filename), "application/octet-stream", true);
         request->send (response);
 
         // DEBUG_V ("Send File Done");
@@ -644,6 +691,7 @@ void c_WebMgr::ProcessXJRequest (AsyncWebSocketClient* client)
     system[F ("freeheap")] = ESP.getFreeHeap ();
     system[F ("uptime")] = millis ();
     system[F ("SDinstalled")] = FileMgr.SdCardIsInstalled ();
+    system[F ("SDonflash")]   = FileMgr.SequencesAreOnFlash ();
 
     // DEBUG_V ("");
 
@@ -654,6 +702,15 @@ void c_WebMgr::ProcessXJRequest (AsyncWebSocketClient* client)
     FPPDiscovery.GetStatus (system);
     // DEBUG_V ("");
 
+    UdpRxTask.GetStatus (system);
+    // DEBUG_V ("");
+
+    LatencyTracker.GetStatus (system);
+    // DEBUG_V ("");
+
+    FseqRecorder.GetStatus (system);
+    // DEBUG_V ("");
+
     // Ask Input Stats
     InputMgr.GetStatus (status);
     // DEBUG_V ("");
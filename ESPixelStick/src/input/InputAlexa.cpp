@@ -31,7 +31,7 @@ c_InputAlexa::c_InputAlexa (
     c_InputMgr::e_InputChannelIds NewInputChannelId,
     c_InputMgr::e_InputType       NewChannelType,
     uint8_t                     * BufferStart,
-    uint16_t                      BufferSize) :
+    uint32_t                      BufferSize) :
     c_InputCommon (NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 
 {
@@ -117,7 +117,7 @@ void c_InputAlexa::Process ()
 } // process
 
 //-----------------------------------------------------------------------------
-void c_InputAlexa::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputAlexa::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
@@ -29,7 +29,7 @@ class c_InputAlexa : public c_InputCommon
           c_InputMgr::e_InputChannelIds NewInputChannelId,
           c_InputMgr::e_InputType       NewChannelType,
           uint8_t                     * BufferStart,
-          uint16_t                      BufferSize);
+          uint32_t                      BufferSize);
       
       ~c_InputAlexa ();
 
@@ -40,7 +40,7 @@ class c_InputAlexa : public c_InputCommon
       void GetStatus (JsonObject& jsonStatus);
       void Process ();                         ///< Call from loop(),  renders Input data
       void GetDriverName (String& sDriverName) { sDriverName = "Alexa"; } ///< get the name for the instantiated driver
-      void SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize);
+      void SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize);
 
 private:
 
@@ -1,5 +1,5 @@
 /*
-* ArtnetInput.cpp - Code to wrap ESPAsyncArtnet for input
+* ArtnetInput.cpp - Code to receive Art-Net directly from AsyncUDP for input
 *
 * Project: ESPixelStick - An ESP8266 / ESP32 and Artnet based pixel driver
 * Copyright (c) 2021 Shelby Merrick
@@ -19,18 +19,32 @@
 
 #include "InputArtnet.hpp"
 #include "../network/NetworkMgr.hpp"
+#include "../service/LatencyTracker.hpp"
+
+static const uint8_t ARTNET_ID[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0x00 };
+
+//-----------------------------------------------------------------------------
+static void ArtnetRxHandler (void * Context, UdpRxPacket_t & Packet)
+{
+    reinterpret_cast <c_InputArtnet*> (Context)->ProcessReceivedUdpPacket (Packet);
+} // ArtnetRxHandler
 
 //-----------------------------------------------------------------------------
 c_InputArtnet::c_InputArtnet (c_InputMgr::e_InputChannelIds NewInputChannelId,
                               c_InputMgr::e_InputType       NewChannelType,
                               uint8_t                     * BufferStart,
-                              uint16_t                      BufferSize) :
+                              uint32_t                      BufferSize) :
     c_InputCommon(NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 
 {
     // DEBUG_START;
     // DEBUG_V ("BufferSize: " + String (BufferSize));
-    memset ((void*)UniverseArray, 0x00, sizeof (UniverseArray));
+
+    PendingBuffer     = BufferStart;
+    PendingBufferSize = BufferSize;
+
+    udp = new AsyncUDP ();
+
     // DEBUG_END;
 } // c_InputArtnet
 
@@ -39,6 +53,31 @@ c_InputArtnet::~c_InputArtnet()
 {
     // DEBUG_START;
 
+    if (nullptr != udp)
+    {
+        // stop the callbacks before this object goes away
+        udp->close ();
+        delete udp;
+        udp = nullptr;
+    }
+
+    // drop anything still waiting in the receive queue for us
+    UdpRxTask.Purge (this);
+
+    SyncActive = false;
+    if (nullptr != SyncBuffer)
+    {
+        free (SyncBuffer);
+        SyncBuffer = nullptr;
+    }
+
+    UniverseArraySize = 0;
+    if (nullptr != UniverseArray)
+    {
+        free (UniverseArray);
+        UniverseArray = nullptr;
+    }
+
     // DEBUG_END;
 
 } // ~c_InputArtnet
@@ -76,6 +115,7 @@ void c_InputArtnet::GetConfig (JsonObject & jsonConfig)
     jsonConfig[CN_universe]       = startUniverse;
     jsonConfig[CN_universe_limit] = ChannelsPerUniverse;
     jsonConfig[CN_universe_start] = FirstUniverseChannelOffset;
+    UniverseLoss.GetConfig (jsonConfig);
 
     // DEBUG_END;
 
@@ -96,16 +136,32 @@ void c_InputArtnet::GetStatus (JsonObject & jsonStatus)
     ArtnetStatus[CN_num_packets]      = num_packets;
     ArtnetStatus[CN_packet_errors] = packet_errors;
     ArtnetStatus[CN_last_clientIP] = LastRemoteIP.toString ();
+    ArtnetStatus[CN_sync_packets]  = sync_packets;
+    ArtnetStatus[F ("sync")]         = SyncActive;
+    ArtnetStatus[F ("poll_packets")] = poll_packets;
 
     JsonArray ArtnetUniverseStatus = ArtnetStatus.createNestedArray (CN_channels);
+    uint32_t StaleUniverses = 0;
 
-    for (auto & CurrentUniverse : UniverseArray)
+    // the table can be swapped by the main loop while the web server runs this
+    UdpRxTask.Lock ();
+    for (uint32_t UniverseIndex = 0; UniverseIndex < UniverseArraySize; ++UniverseIndex)
     {
+        Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
         JsonObject ArtnetCurrentUniverseStatus = ArtnetUniverseStatus.createNestedObject ();
 
         ArtnetCurrentUniverseStatus[CN_errors] = CurrentUniverse.SequenceErrorCounter;
         ArtnetCurrentUniverseStatus[CN_num_packets] = CurrentUniverse.num_packets;
+        ArtnetCurrentUniverseStatus[CN_stale] = UniverseLoss.IsStale (CurrentUniverse.Loss);
+        ArtnetCurrentUniverseStatus[F ("losses")] = CurrentUniverse.Loss.Losses;
+        if (UniverseLoss.IsStale (CurrentUniverse.Loss))
+        {
+            ++StaleUniverses;
+        }
     }
+    UdpRxTask.Unlock ();
+
+    ArtnetStatus[CN_stale] = StaleUniverses;
 
     // DEBUG_END;
 
@@ -115,10 +171,52 @@ void c_InputArtnet::GetStatus (JsonObject & jsonStatus)
 void c_InputArtnet::Process ()
 {
     // DEBUG_START;
-    if ((nullptr != pArtnet) && (NetworkMgr.IsConnected ()))
+
+    // hold, fade or blank the universes that have gone quiet. The receive
+    // task updates the same entries.
+    uint32_t now = millis ();
+    UdpRxTask.Lock ();
+    for (uint32_t UniverseIndex = 0; UniverseIndex < UniverseArraySize; ++UniverseIndex)
     {
-        // DEBUG_V ("");
-        pArtnet->read ();
+        Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
+        uint32_t Offset   = CurrentUniverse.Destination - InputDataBuffer;
+        uint8_t * BackData = ((nullptr != SyncBuffer) && ((Offset + CurrentUniverse.BytesToCopy) <= SyncBufferSize)) ? &SyncBuffer[Offset] : nullptr;
+        UniverseLoss.Poll (CurrentUniverse.Loss, CurrentUniverse.Destination, BackData, CurrentUniverse.BytesToCopy, now);
+    }
+    UdpRxTask.Unlock ();
+
+    if (SyncActive && ((now - LastSyncTime) > ARTNET_SYNC_TIMEOUT_MS))
+    {
+        logcon (String (F ("Lost ArtSync. Reverting to unsynchronized output.")));
+        UdpRxTask.Lock ();
+        SyncRequested = false;
+        StopSync ();
+        UdpRxTask.Unlock ();
+    }
+
+    if (SyncRequested && (nullptr == SyncBuffer) && !SyncBufferAllocFailed && (0 != InputDataBufferSize))
+    {
+        uint8_t * NewSyncBuffer = (uint8_t *)malloc (InputDataBufferSize);
+        if (nullptr == NewSyncBuffer)
+        {
+            logcon (String (F ("ERROR: Could not allocate the ArtSync buffer. Synchronization is disabled.")));
+            SyncBufferAllocFailed = true;
+        }
+        else
+        {
+            // the receive task starts using it as soon as the pointer is set
+            UdpRxTask.Lock ();
+            memcpy (NewSyncBuffer, InputDataBuffer, InputDataBufferSize);
+            SyncBufferSize = InputDataBufferSize;
+            SyncBuffer     = NewSyncBuffer;
+            UdpRxTask.Unlock ();
+        }
+    }
+
+    if (PollReplyPending)
+    {
+        PollReplyPending = false;
+        SendPollReply (PollReplyAddress);
     }
 
     // DEBUG_END;
@@ -126,56 +224,285 @@ void c_InputArtnet::Process ()
 } // process
 
 //-----------------------------------------------------------------------------
-void c_InputArtnet::onDmxFrame (uint16_t  CurrentUniverseId,
-                                uint16_t  length,
-                                uint8_t   SequenceNumber,
-                                uint8_t * data,
-                                IPAddress remoteIP)
+/*
+    Stop holding data for an ArtSync and push out whatever was waiting in
+    the back buffer. Call with the receive task locked out.
+*/
+void c_InputArtnet::StopSync ()
 {
     // DEBUG_START;
 
-    if ((startUniverse <= CurrentUniverseId) && (LastUniverse >= CurrentUniverseId))
+    if (SyncActive)
     {
-        LastRemoteIP = remoteIP;
+        SyncActive = false;
+        memcpy (InputDataBuffer, SyncBuffer, min (SyncBufferSize, InputDataBufferSize));
+    }
 
-        // Universe offset and sequence tracking
-        Universe_t& CurrentUniverse = UniverseArray[CurrentUniverseId - startUniverse];
+    // DEBUG_END;
+
+} // StopSync
+
+//-----------------------------------------------------------------------------
+/*
+    Called from the UDP receive task. DMX and sync are handled here.
+    Poll replies are deferred to Process ().
+*/
+void c_InputArtnet::ProcessReceivedUdpPacket (UdpRxPacket_t & Packet)
+{
+    // DEBUG_START;
 
-        // Do we need to update a sequnce error?
-        if (SequenceNumber != CurrentUniverse.SequenceNumber)
+    do // once
+    {
+        uint16_t OpCode = DecodeArtnetOpCode (Packet.data, Packet.length);
+        if (ARTNET_OP_NONE == OpCode)
         {
-            CurrentUniverse.SequenceErrorCounter++;
-            CurrentUniverse.SequenceNumber = SequenceNumber;
+            // DEBUG_V ("Not an Art-Net packet");
             ++packet_errors;
+            break;
+        }
+
+        switch (OpCode)
+        {
+            case ARTNET_OP_DMX:
+            {
+                ArtDmxFrame_t Frame;
+                if (!DecodeArtDmx (Packet.data, Packet.length, Frame))
+                {
+                    ++packet_errors;
+                    break;
+                }
+                ProcessIncomingArtDmx (Frame, Packet.remoteIP, Packet.arrivalUS);
+                break;
+            }
+
+            case ARTNET_OP_SYNC:
+            {
+                if (Packet.length >= ARTNET_SYNC_PACKET_SIZE)
+                {
+                    ProcessIncomingArtSync (Packet.remoteIP, Packet.arrivalUS);
+                }
+                break;
+            }
+
+            case ARTNET_OP_POLL:
+            {
+                ++poll_packets;
+                PollReplyAddress = Packet.remoteIP;
+                PollReplyPending = true;
+                break;
+            }
+
+            default:
+            {
+                // DEBUG_V (String ("Unsupported OpCode: ") + String (OpCode, HEX));
+                break;
+            }
+        }
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // ProcessReceivedUdpPacket
+
+//-----------------------------------------------------------------------------
+void c_InputArtnet::ProcessIncomingArtDmx (ArtDmxFrame_t & Frame, IPAddress RemoteIP, uint32_t ArrivalUS)
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        uint16_t CurrentUniverseId = Frame.universe;
+        uint32_t UniverseIndex = uint32_t (CurrentUniverseId) - uint32_t (startUniverse);
+        if ((startUniverse > CurrentUniverseId) || (UniverseIndex >= UniverseArraySize))
+        {
+            // DEBUG_V ("Not interested in this universe");
+            break;
+        }
+
+        LastRemoteIP = RemoteIP;
+
+        // Universe offset and sequence tracking
+        Universe_t& CurrentUniverse = UniverseArray[UniverseIndex];
+
+        // A sequence of zero means the sender is not using sequence numbers
+        if (0 != Frame.sequence)
+        {
+            // Do we need to update a sequnce error?
+            if ((0 != CurrentUniverse.SequenceNumber) && (Frame.sequence != CurrentUniverse.SequenceNumber))
+            {
+                CurrentUniverse.SequenceErrorCounter++;
+                ++packet_errors;
+            }
+
+            // sequence runs 1 - 255 and then wraps back to 1
+            CurrentUniverse.SequenceNumber = (0xff == Frame.sequence) ? 1 : Frame.sequence + 1;
         }
 
-        ++CurrentUniverse.SequenceNumber;
         ++CurrentUniverse.num_packets;
         ++num_packets;
 
-        // DEBUG_V (String ("data[0]: ") + String (data[0], HEX));
+        // DEBUG_V (String ("data[0]: ") + String (Frame.slots[0], HEX));
 
-        lastData = data[0];
+        lastData = (0 != Frame.numSlots) ? Frame.slots[0] : 0;
 
-        memcpy (CurrentUniverse.Destination,
-                &data[CurrentUniverse.SourceDataOffset],
-                min (CurrentUniverse.BytesToCopy, length));
+        // data from the sync source waits in the back buffer for the next ArtSync
+        uint8_t * Destination = CurrentUniverse.Destination;
+        if (SyncActive)
+        {
+            Destination = &SyncBuffer[CurrentUniverse.Destination - InputDataBuffer];
+        }
+
+        CopySlots (Destination, Frame.slots, Frame.numSlots, CurrentUniverse.SourceDataOffset, CurrentUniverse.BytesToCopy);
+
+        if (!SyncActive)
+        {
+            LatencyTracker.DataArrived (ArrivalUS);
+        }
 
+        UniverseLoss.DataArrived (CurrentUniverse.Loss, millis ());
         InputMgr.RestartBlankTimer (GetInputChannelId ());
-    }
-    else
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // ProcessIncomingArtDmx
+
+//-----------------------------------------------------------------------------
+/*
+    The sender has finished sending a frame. Latch the back buffer into the
+    input buffer. ArtSync from anyone other than the DMX source is ignored.
+*/
+void c_InputArtnet::ProcessIncomingArtSync (IPAddress RemoteIP, uint32_t ArrivalUS)
+{
+    // DEBUG_START;
+
+    do // once
     {
-        // DEBUG_V ("Not interested in this universe");
+        if (RemoteIP != LastRemoteIP)
+        {
+            // DEBUG_V ("ArtSync is not from the DMX source");
+            break;
+        }
+
+        ++sync_packets;
+        SyncRequested = true;
+        LastSyncTime = millis ();
+
+        if (nullptr == SyncBuffer)
+        {
+            // Process () has not allocated the back buffer yet
+            break;
+        }
+
+        uint32_t BytesToLatch = min (SyncBufferSize, InputDataBufferSize);
+        if (SyncActive)
+        {
+            memcpy (InputDataBuffer, SyncBuffer, BytesToLatch);
+            LatencyTracker.DataArrived (ArrivalUS);
+
+            // the whole frame is in. Compose it now.
+            InputMgr.FrameComplete (GetInputChannelId ());
+        }
+        else
+        {
+            // first sync. Start holding from what is currently being output
+            memcpy (SyncBuffer, InputDataBuffer, BytesToLatch);
+            SyncActive = true;
+            logcon (String (F ("Synchronizing on ArtSync from ")) + RemoteIP.toString ());
+        }
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // ProcessIncomingArtSync
+
+//-----------------------------------------------------------------------------
+/*
+    Describe the node to the console. Each reply can carry up to four ports
+    that share the same Net and Sub-Net, so larger configurations are sent
+    as several replies with increasing BindIndex.
+*/
+void c_InputArtnet::SendPollReply (IPAddress Address)
+{
+    // DEBUG_START;
+
+    ArtPollReply_packet_t Reply;
+    memset ((void*)&Reply, 0x00, sizeof (Reply));
+
+    memcpy (Reply.header.id, ARTNET_ID, sizeof (Reply.header.id));
+    Reply.header.OpCode = ARTNET_OP_POLL_REPLY;
+
+    IPAddress LocalIp = NetworkMgr.GetlocalIP ();
+    for (uint32_t index = 0; index < sizeof (Reply.IpAddress); ++index)
+    {
+        Reply.IpAddress[index] = LocalIp[index];
+        Reply.BindIp[index]    = LocalIp[index];
     }
+
+    Reply.Port      = ARTNET_PORT;
+    Reply.OemHi     = 0x00;
+    Reply.OemLo     = 0xff;     // OemUnknown
+    Reply.Status1   = 0xd0;     // indicators normal, addresses set from the UI
+    Reply.Status2   = 0x08;     // 15 bit port addresses
+    WiFi.macAddress (Reply.Mac);
+
+    strncpy (Reply.ShortName, config.id.c_str (), sizeof (Reply.ShortName) - 1);
+    strncpy (Reply.LongName, (String (CN_ESPixelStick) + F (" v") + VERSION).c_str (), sizeof (Reply.LongName) - 1);
+    snprintf (Reply.NodeReport, sizeof (Reply.NodeReport), "#0001 [%04u] OK", unsigned (poll_packets % 10000));
+
+    uint32_t UniverseIndex = 0;
+    uint8_t  BindIndex     = 1;
+    do
+    {
+        Reply.BindIndex  = BindIndex++;
+        Reply.NumPortsLo = 0;
+        memset (Reply.PortTypes,  0x00, sizeof (Reply.PortTypes));
+        memset (Reply.GoodOutput, 0x00, sizeof (Reply.GoodOutput));
+        memset (Reply.SwOut,      0x00, sizeof (Reply.SwOut));
+
+        while ((UniverseIndex < UniverseArraySize) && (Reply.NumPortsLo < ARTNET_PORTS_PER_REPLY))
+        {
+            uint16_t UniverseId = startUniverse + UniverseIndex;
+            uint8_t  NetSwitch  = (UniverseId >> 8) & 0x7f;
+            uint8_t  SubSwitch  = (UniverseId >> 4) & 0x0f;
+
+            if (0 == Reply.NumPortsLo)
+            {
+                Reply.NetSwitch = NetSwitch;
+                Reply.SubSwitch = SubSwitch;
+            }
+            else if ((NetSwitch != Reply.NetSwitch) || (SubSwitch != Reply.SubSwitch))
+            {
+                // needs a new reply
+                break;
+            }
+
+            uint8_t Port = Reply.NumPortsLo++;
+            Reply.PortTypes[Port]  = 0x80;  // output from Art-Net, DMX512
+            Reply.GoodOutput[Port] = (0 != UniverseArray[UniverseIndex].num_packets) ? 0x80 : 0x00;
+            Reply.SwOut[Port]      = UniverseId & 0x0f;
+            ++UniverseIndex;
+        }
+
+        udp->writeTo ((const uint8_t*)&Reply, sizeof (Reply), Address, ARTNET_PORT);
+
+    } while (UniverseIndex < UniverseArraySize);
+
     // DEBUG_END;
-}
+
+} // SendPollReply
 //-----------------------------------------------------------------------------
-void c_InputArtnet::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputArtnet::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
-    InputDataBuffer = BufferStart;
-    InputDataBufferSize = BufferSize;
+    // the receive task keeps using the old buffer until the new universe
+    // table is swapped in
+    PendingBuffer     = BufferStart;
+    PendingBufferSize = BufferSize;
 
     if (HasBeenInitialized)
     {
@@ -184,7 +511,7 @@ void c_InputArtnet::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
         Begin ();
     }
 
-    SetBufferTranslation ();
+    validateConfiguration ();
 
     // DEBUG_END;
 
@@ -195,24 +522,40 @@ void c_InputArtnet::SetBufferTranslation ()
 {
     // DEBUG_START;
 
-    // for each possible universe, set the start and size
+    // build the new table while the receive task keeps using the old one.
+    // Size it so that a universe id maps directly to its entry
+    uint32_t NumUniverses = (LastUniverse >= startUniverse) ? (uint32_t (LastUniverse) - uint32_t (startUniverse) + 1) : 0;
+    Universe_t * NewUniverseArray = nullptr;
+    if (0 != NumUniverses)
+    {
+        NewUniverseArray = (Universe_t *)malloc (NumUniverses * sizeof (Universe_t));
+        if (nullptr == NewUniverseArray)
+        {
+            logcon (String (F ("ERROR: Could not allocate memory for ")) + String (NumUniverses) + F (" universes."));
+            NumUniverses = 0;
+        }
+        else
+        {
+            memset ((void*)NewUniverseArray, 0x00, NumUniverses * sizeof (Universe_t));
+        }
+    }
 
-    uint16_t InputOffset = FirstUniverseChannelOffset - 1;
-    uint16_t DestinationOffset = 0;
-    uint16_t BytesLeftToMap = InputDataBufferSize;
+    uint32_t InputOffset = FirstUniverseChannelOffset - 1;
+    uint32_t DestinationOffset = 0;
+    uint32_t BytesLeftToMap = PendingBufferSize;
 
     // set up the bytes for the First Universe
-    uint16_t BytesInUniverse = ChannelsPerUniverse - InputOffset;
+    uint32_t BytesInUniverse = ChannelsPerUniverse - InputOffset;
     // DEBUG_V (String ("ChannelsPerUniverse: ") + String (uint32_t (ChannelsPerUniverse), HEX));
 
-    for (auto& CurrentUniverse : UniverseArray)
+    for (uint32_t UniverseIndex = 0; UniverseIndex < NumUniverses; ++UniverseIndex)
     {
-        uint16_t BytesInThisUniverse = min (BytesInUniverse, BytesLeftToMap);
-        CurrentUniverse.Destination = &InputDataBuffer[DestinationOffset];
+        Universe_t & CurrentUniverse = NewUniverseArray[UniverseIndex];
+        uint32_t BytesInThisUniverse = min (BytesInUniverse, BytesLeftToMap);
+        CurrentUniverse.Destination = &PendingBuffer[DestinationOffset];
         CurrentUniverse.BytesToCopy = BytesInThisUniverse;
         CurrentUniverse.SourceDataOffset = InputOffset;
-        // CurrentUniverse.SequenceErrorCounter = 0;
-        // CurrentUniverse.SequenceNumber = 0;
+        UniverseLoss.Reset (CurrentUniverse.Loss);
 
         // DEBUG_V (String ("        Destination: ") + String (uint32_t (CurrentUniverse.Destination), HEX));
         // DEBUG_V (String ("        BytesToCopy: ") + String (CurrentUniverse.BytesToCopy, HEX));
@@ -224,6 +567,47 @@ void c_InputArtnet::SetBufferTranslation ()
         InputOffset = 0;
     }
 
+    // swap the tables while no handler is running
+    UdpRxTask.Lock ();
+
+    if (NumUniverses == UniverseArraySize)
+    {
+        // same universes. Keep the counters
+        for (uint32_t UniverseIndex = 0; UniverseIndex < NumUniverses; ++UniverseIndex)
+        {
+            NewUniverseArray[UniverseIndex].SequenceErrorCounter = UniverseArray[UniverseIndex].SequenceErrorCounter;
+            NewUniverseArray[UniverseIndex].SequenceNumber       = UniverseArray[UniverseIndex].SequenceNumber;
+            NewUniverseArray[UniverseIndex].num_packets          = UniverseArray[UniverseIndex].num_packets;
+        }
+    }
+
+    Universe_t * OldUniverseArray = UniverseArray;
+    UniverseArray     = NewUniverseArray;
+    UniverseArraySize = NumUniverses;
+
+    // the new table points into the new buffer
+    InputDataBuffer     = PendingBuffer;
+    InputDataBufferSize = PendingBufferSize;
+
+    // the back buffer has to follow the input buffer. Process () will rebuild it.
+    uint8_t * OldSyncBuffer = SyncBuffer;
+    SyncBuffer            = nullptr;
+    SyncBufferSize        = 0;
+    SyncActive            = false;
+    SyncBufferAllocFailed = false;
+
+    UdpRxTask.Unlock ();
+
+    if (nullptr != OldUniverseArray)
+    {
+        free (OldUniverseArray);
+    }
+
+    if (nullptr != OldSyncBuffer)
+    {
+        free (OldSyncBuffer);
+    }
+
     if (0 != BytesLeftToMap)
     {
         logcon (String (F ("ERROR: Universe configuration is too small to fill output buffer. Outputs have been truncated.")));
@@ -241,6 +625,7 @@ bool c_InputArtnet::SetConfig (ArduinoJson::JsonObject& jsonConfig)
     setFromJSON (startUniverse,              jsonConfig, CN_universe);
     setFromJSON (ChannelsPerUniverse,        jsonConfig, CN_universe_limit);
     setFromJSON (FirstUniverseChannelOffset, jsonConfig, CN_universe_start);
+    UniverseLoss.SetConfig (jsonConfig);
 
     validateConfiguration ();
 
@@ -251,42 +636,6 @@ bool c_InputArtnet::SetConfig (ArduinoJson::JsonObject& jsonConfig)
     return true;
 } // SetConfig
 
-static c_InputArtnet * fMe = nullptr;
-
-//-----------------------------------------------------------------------------
-// Subscribe to "n" universes, starting at "universe"
-void c_InputArtnet::SetUpArtnet ()
-{
-    // DEBUG_START;
-
-    if (nullptr == pArtnet)
-    {
-        // DEBUG_V ("");
-        pArtnet = new Artnet ();
-        pArtnet->begin ();
-
-        byte broadcast[] = { 10, 0, 1, 255 };
-        pArtnet->setBroadcast (broadcast);
-        logcon (String (F ("Subscribed to broadcast")));
-
-        // DEBUG_V ("");
-
-        fMe = this; // hate this
-        pArtnet->setArtDmxCallback ([](uint16_t UniverseId, uint16_t length, uint8_t sequence, uint8_t* data, IPAddress remoteIP)
-            {
-                // logcon ("fMe");
-                fMe->onDmxFrame (UniverseId, length, sequence, data, remoteIP);
-            });
-    }
-    // DEBUG_V ("");
-
-    logcon (String (F ("Listening for ")) + InputDataBufferSize +
-        F (" channels from Universe ") + startUniverse +
-        F (" to ") + LastUniverse);
-    // DEBUG_END;
-
-} // SubscribeToBroadcastDomain
-
 //-----------------------------------------------------------------------------
 void c_InputArtnet::validateConfiguration ()
 {
@@ -328,7 +677,7 @@ void c_InputArtnet::validateConfiguration ()
 
     // Find the last universe we should listen for
      // DEBUG_V ("");
-    uint16_t span = FirstUniverseChannelOffset + InputDataBufferSize - 1;
+    uint32_t span = FirstUniverseChannelOffset + PendingBufferSize - 1;
     if (span % ChannelsPerUniverse)
     {
         LastUniverse = startUniverse + span / ChannelsPerUniverse;
@@ -343,7 +692,6 @@ void c_InputArtnet::validateConfiguration ()
     SetBufferTranslation ();
 
     // DEBUG_V ("");
-    // pArtnet->stats.num_packets = 0;
 
     // DEBUG_END;
 
@@ -366,10 +714,26 @@ void c_InputArtnet::NetworkStateChanged (bool IsConnected, bool ReBootAllowed)
 {
     // DEBUG_START;
 
-    if (IsConnected)
+    do // once
     {
-        SetUpArtnet ();
-    }
+        if (!IsConnected || (nullptr == udp))
+        {
+            break;
+        }
+
+        if (!udp->listen (ARTNET_PORT))
+        {
+            logcon (String (F ("ERROR: Could not listen on port ")) + String (ARTNET_PORT));
+            break;
+        }
+
+        udp->onPacket ([this] (AsyncUDPPacket & Packet) { UdpRxTask.Enqueue (&ArtnetRxHandler, this, Packet); });
+
+        logcon (String (F ("Listening for ")) + InputDataBufferSize +
+            F (" channels from Universe ") + startUniverse +
+            F (" to ") + LastUniverse);
+
+    } while (false);
 
     // DEBUG_END;
 
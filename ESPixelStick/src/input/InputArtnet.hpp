@@ -1,6 +1,6 @@
 #pragma once
 /*
-* ArtnetInput.h - Code to wrap ESPAsyncArtnet for input
+* ArtnetInput.h - Code to receive Art-Net directly from AsyncUDP for input
 *
 * Project: ESPixelStick - An ESP8266 / ESP32 and Artnet based pixel driver
 * Copyright (c) 2021 Shelby Merrick
@@ -19,55 +19,144 @@
 */
 
 #include "InputCommon.hpp"
-#include <Artnet.h>
+#include "../network/UdpRxTask.hpp"
+#include "InputPacketDecode.hpp"
+#include "UniverseLoss.hpp"
+
+#ifdef ESP32
+#   include <WiFi.h>
+#   include <AsyncUDP.h>
+#elif defined (ESP8266)
+#   include <ESPAsyncUDP.h>
+#   include <ESP8266WiFi.h>
+#else
+#   error Platform not supported
+#endif
 
 class c_InputArtnet : public c_InputCommon 
 {
   private:
     static const uint16_t   UNIVERSE_MAX = 512;
     static const char       ConfigFileName[];
-    static const uint8_t    MAX_NUM_UNIVERSES = 10;
 
-    Artnet * pArtnet = nullptr;
+#define ARTNET_PORT                 6454
+#define ARTNET_PROTOCOL_VERSION     14
+#define ARTNET_OP_POLL              0x2000
+#define ARTNET_OP_POLL_REPLY        0x2100
+#define ARTNET_OP_DMX               0x5000
+#define ARTNET_OP_SYNC              0x5200
+#define ARTNET_SYNC_TIMEOUT_MS      4000
+#define ARTNET_PORTS_PER_REPLY      4
+
+    // All Art-Net multi byte fields are little endian unless noted otherwise
+    typedef struct __attribute__ ((packed))
+    {
+        uint8_t  id[8];
+        uint16_t OpCode;
+    } ArtNet_header_t;
+
+    typedef struct __attribute__ ((packed))
+    {
+        ArtNet_header_t header;
+        uint8_t  IpAddress[4];
+        uint16_t Port;
+        uint8_t  VersInfoH;
+        uint8_t  VersInfoL;
+        uint8_t  NetSwitch;
+        uint8_t  SubSwitch;
+        uint8_t  OemHi;
+        uint8_t  OemLo;
+        uint8_t  UbeaVersion;
+        uint8_t  Status1;
+        uint8_t  EstaManLo;
+        uint8_t  EstaManHi;
+        char     ShortName[18];
+        char     LongName[64];
+        char     NodeReport[64];
+        uint8_t  NumPortsHi;
+        uint8_t  NumPortsLo;
+        uint8_t  PortTypes[ARTNET_PORTS_PER_REPLY];
+        uint8_t  GoodInput[ARTNET_PORTS_PER_REPLY];
+        uint8_t  GoodOutput[ARTNET_PORTS_PER_REPLY];
+        uint8_t  SwIn[ARTNET_PORTS_PER_REPLY];
+        uint8_t  SwOut[ARTNET_PORTS_PER_REPLY];
+        uint8_t  SwVideo;
+        uint8_t  SwMacro;
+        uint8_t  SwRemote;
+        uint8_t  Spare[3];
+        uint8_t  Style;
+        uint8_t  Mac[6];
+        uint8_t  BindIp[4];
+        uint8_t  BindIndex;
+        uint8_t  Status2;
+        uint8_t  Filler[26];
+    } ArtPollReply_packet_t;
+
+    AsyncUDP  * udp = nullptr;  ///< Socket used for DMX, sync and poll traffic
 
     /// JSON configuration parameters
     uint16_t    startUniverse              = 1;    ///< Universe to listen for
     uint16_t    LastUniverse               = 1;       ///< Last Universe to listen for
-    uint16_t    ChannelsPerUniverse        = 512;  ///< Universe boundary limit
-    uint16_t    FirstUniverseChannelOffset = 1;    ///< Channel to start listening at - 1 based
+    uint32_t    ChannelsPerUniverse        = 512;  ///< Universe boundary limit
+    uint32_t    FirstUniverseChannelOffset = 1;    ///< Channel to start listening at - 1 based
     IPAddress   LastRemoteIP;
+    c_UniverseLoss UniverseLoss;               ///< What to do when a universe goes quiet
     uint32_t    num_packets = 0;
     uint32_t    packet_errors = 0;
+    uint32_t    sync_packets = 0;
+    uint32_t    poll_packets = 0;
+
+    /// Poll replies are built and sent from Process ()
+    bool        PollReplyPending = false;
+    IPAddress   PollReplyAddress;
+
+    /// ArtSync. Once a sync has been seen, DMX from the same sender is held
+    /// in SyncBuffer and latched into the input buffer by the next ArtSync.
+    uint8_t   * SyncBuffer            = nullptr; ///< Back buffer. Same layout as InputDataBuffer
+    uint32_t    SyncBufferSize        = 0;
+    bool        SyncBufferAllocFailed = false;
+    bool        SyncRequested         = false;   ///< An ArtSync has been seen. Need a back buffer
+    bool        SyncActive            = false;   ///< Holding DMX for the next ArtSync
+    uint32_t    LastSyncTime          = 0;       ///< millis () of the last ArtSync
 
     uint8_t     lastData = 255;
 
     /// from sketch globals
-    uint16_t    channel_count = 0;       ///< Number of channels. Derived from output module configuration.
+    uint32_t    channel_count = 0;       ///< Number of channels. Derived from output module configuration.
 
     typedef struct 
     {
         uint8_t  * Destination;
-        uint16_t   BytesToCopy;
-        uint16_t   SourceDataOffset;
+        uint32_t   BytesToCopy;
+        uint32_t   SourceDataOffset;
         uint32_t   SequenceErrorCounter;
-        uint8_t    SequenceNumber;
+        uint8_t    SequenceNumber;      ///< Next expected sequence number
         uint32_t   num_packets;
+        c_UniverseLoss::UniverseLoss_t Loss;
 
     } Universe_t;
-    Universe_t UniverseArray[MAX_NUM_UNIVERSES];
 
-    void SetUpArtnet ();
+    /// Buffer handed to SetBufferInfo (). The universe table is built for it
+    /// and it becomes InputDataBuffer when the table is swapped in.
+    uint8_t    * PendingBuffer     = nullptr;
+    uint32_t     PendingBufferSize = 0;
+    Universe_t * UniverseArray     = nullptr; ///< One entry per universe from startUniverse to LastUniverse
+    uint32_t     UniverseArraySize = 0;       ///< Number of entries in UniverseArray
+
     void validateConfiguration ();
     void NetworkStateChanged (bool IsConnected, bool RebootAllowed); // used by poorly designed rx functions
     void SetBufferTranslation ();
-    void onDmxFrame (uint16_t CurrentUniverseId, uint16_t length, uint8_t sequence, uint8_t* data, IPAddress remoteIP);
+    void ProcessIncomingArtDmx (ArtDmxFrame_t & Frame, IPAddress RemoteIP, uint32_t ArrivalUS);
+    void ProcessIncomingArtSync (IPAddress RemoteIP, uint32_t ArrivalUS);
+    void SendPollReply (IPAddress Address);
+    void StopSync ();
 
   public:
 
     c_InputArtnet (c_InputMgr::e_InputChannelIds NewInputChannelId,
                    c_InputMgr::e_InputType       NewChannelType,
                    uint8_t                     * BufferStart,
-                   uint16_t                      BufferSize);
+                   uint32_t                      BufferSize);
     ~c_InputArtnet();
 
     // functions to be provided by the derived class
@@ -77,8 +166,9 @@ class c_InputArtnet : public c_InputCommon
     void GetStatus (JsonObject & jsonStatus);
     void Process ();                                        ///< Call from loop(),  renders Input data
     void GetDriverName (String & sDriverName) { sDriverName = "Artnet"; } ///< get the name for the instantiated driver
-    void SetBufferInfo (uint8_t * BufferStart, uint16_t BufferSize);
+    void SetBufferInfo (uint8_t * BufferStart, uint32_t BufferSize);
     void NetworkStateChanged (bool IsConnected); // used by poorly designed rx functions
     bool isShutDownRebootNeeded () { return HasBeenInitialized; }
+    void ProcessReceivedUdpPacket (UdpRxPacket_t & Packet);   ///< Called by the UDP receive task
 
 };
@@ -28,7 +28,7 @@
 c_InputCommon::c_InputCommon (c_InputMgr::e_InputChannelIds NewInputChannelId,
                               c_InputMgr::e_InputType       NewChannelType,
                               uint8_t                     * BufferStart,
-                              uint16_t                      BufferSize) :
+                              uint32_t                      BufferSize) :
     InputDataBuffer(BufferStart),
     InputDataBufferSize(BufferSize),
     InputChannelId(NewInputChannelId),
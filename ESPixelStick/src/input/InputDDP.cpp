@@ -19,6 +19,13 @@
 #include "InputDDP.h"
 #include <string.h>
 #include "../network/NetworkMgr.hpp"
+#include "../service/LatencyTracker.hpp"
+
+//-----------------------------------------------------------------------------
+static void DDPRxHandler (void * Context, UdpRxPacket_t & Packet)
+{
+    reinterpret_cast <c_InputDDP*> (Context)->ProcessReceivedUdpPacket (Packet);
+} // DDPRxHandler
 
 #ifdef ARDUINO_ARCH_ESP32
 #   define FPP_TYPE_ID          0xC3
@@ -33,13 +40,14 @@
 c_InputDDP::c_InputDDP (c_InputMgr::e_InputChannelIds NewInputChannelId,
                         c_InputMgr::e_InputType       NewChannelType,
                         uint8_t                     * BufferStart,
-                        uint16_t                      BufferSize) :
+                        uint32_t                      BufferSize) :
     c_InputCommon (NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 
 {
     // DEBUG_START;
 
-    PacketBuffer.PacketBufferStatus = PacketBufferStatus_t::BufferIsAvailable;
+    PacketQueueHead = 0;
+    PacketQueueTail = 0;
 
     // DEBUG_END;
 } // c_InputDDP
@@ -50,7 +58,19 @@ c_InputDDP::~c_InputDDP ()
     // DEBUG_START;
 
     // OutputMgr.PauseOutput (false);
-    // udp->stop ();
+
+    if (nullptr != udp)
+    {
+        // stop the callbacks before this object goes away
+        udp->close ();
+        delete udp;
+        udp = nullptr;
+    }
+
+    // drop anything still waiting in the receive queue for us
+    UdpRxTask.Purge (this);
+
+    FreePushBuffer ();
 
     // DEBUG_END;
 } // ~c_InputDDP
@@ -96,6 +116,10 @@ void c_InputDDP::GetStatus (JsonObject& jsonStatus)
     ddpStatus["packetsreceived"] = stats.packetsReceived;
     ddpStatus["bytesreceived"]   = float(stats.bytesReceived) / 1024.0;
     ddpStatus[CN_errors]         = stats.errors;
+    ddpStatus["framesLatched"]   = stats.framesLatched;
+    ddpStatus["lostPackets"]     = stats.lostPackets;
+    ddpStatus["outOfOrder"]      = stats.outOfOrder;
+    ddpStatus["push"]            = PushActive;
     ddpStatus[CN_id]             = InputChannelId;
 
     // DEBUG_END;
@@ -114,12 +138,20 @@ bool c_InputDDP::SetConfig (JsonObject& jsonConfig)
 } // SetConfig
 
 //-----------------------------------------------------------------------------
-void c_InputDDP::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputDDP::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
+    // anything still queued was meant for the old buffer
+    UdpRxTask.Purge (this);
+
+    // the back buffer has to follow the input buffer. Process () will rebuild it.
+    FreePushBuffer ();
+
+    UdpRxTask.Lock ();
     InputDataBuffer = BufferStart;
     InputDataBufferSize = BufferSize;
+    UdpRxTask.Unlock ();
 
     // DEBUG_V (String ("        InputBuffer: 0x") + String (uint32_t (InputDataBuffer), HEX));
     // DEBUG_V (String ("InputDataBufferSize: ") + String (uint32_t (InputDataBufferSize)));
@@ -128,6 +160,52 @@ void c_InputDDP::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
 
 } // SetBufferInfo
 
+//-----------------------------------------------------------------------------
+void c_InputDDP::FreePushBuffer ()
+{
+    // DEBUG_START;
+
+    // the receive task latches from the buffer. Detach it while it is locked out.
+    UdpRxTask.Lock ();
+    uint8_t * OldPushBuffer = PushBuffer;
+    PushBuffer = nullptr;
+    PushActive = false;
+    PushBufferSize = 0;
+    PushBufferAllocFailed = false;
+    DirtyStart = DirtyEnd = 0;
+    UdpRxTask.Unlock ();
+
+    if (nullptr != OldPushBuffer)
+    {
+        free (OldPushBuffer);
+    }
+
+    // DEBUG_END;
+
+} // FreePushBuffer
+
+//-----------------------------------------------------------------------------
+/*
+    Stop holding data for a PUSH and output whatever was waiting in the
+    back buffer. Call with the receive task locked out.
+*/
+void c_InputDDP::StopPush ()
+{
+    // DEBUG_START;
+
+    if (PushActive)
+    {
+        PushActive = false;
+        if (DirtyEnd > DirtyStart)
+        {
+            memcpy (&InputDataBuffer[DirtyStart], &PushBuffer[DirtyStart], DirtyEnd - DirtyStart);
+        }
+    }
+
+    // DEBUG_END;
+
+} // StopPush
+
 //-----------------------------------------------------------------------------
 void c_InputDDP::NetworkStateChanged (bool IsConnected)
 {
@@ -137,7 +215,7 @@ void c_InputDDP::NetworkStateChanged (bool IsConnected)
 
         if (udp->listen (DDP_PORT))
         {
-            udp->onPacket (std::bind (&c_InputDDP::ProcessReceivedUdpPacket, this, std::placeholders::_1));
+            udp->onPacket ([this] (AsyncUDPPacket & Packet) { UdpRxTask.Enqueue (&DDPRxHandler, this, Packet); });
         }
 
         HasBeenInitialized = true;
@@ -147,43 +225,51 @@ void c_InputDDP::NetworkStateChanged (bool IsConnected)
 } // NetworkStateChanged
 
 //-----------------------------------------------------------------------------
-void c_InputDDP::ProcessReceivedUdpPacket(AsyncUDPPacket ReceivedPacket)
+void c_InputDDP::ProcessReceivedUdpPacket (UdpRxPacket_t & ReceivedPacket)
 {
     // DEBUG_START;
 
     do // once
     {
-        DDP_packet_t & packet = *((DDP_packet_t * )(ReceivedPacket.data ()));
+        size_t PacketLength = ReceivedPacket.length;
 
         stats.packetsReceived++;
-        stats.bytesReceived += ReceivedPacket.length ();
+        stats.bytesReceived += PacketLength;
 
-        if ((packet.header.flags1 & DDP_FLAGS1_VERMASK) != DDP_FLAGS1_VER1)
+        DdpFrame_t Frame;
+        if (!DecodeDdp (ReceivedPacket.data, PacketLength, Frame))
         {
             stats.errors++;
-            // DEBUG_V ("Invalid version");
+            // DEBUG_V ("Packet is too short or an unsupported version");
             break;
         }
 
         // need to fast track data
-        if (true == IsData(packet.header.flags1))
+        if (true == IsData(Frame.flags1))
         {
-            ProcessReceivedData (packet);
+            ProcessReceivedData (Frame, ReceivedPacket.arrivalUS);
             break;
         }
 
-        // do we have a place to put the received data?
-        if (PacketBuffer.PacketBufferStatus == PacketBufferStatus_t::BufferIsBeingProcessed)
+        // do we have a place to put the received packet?
+        uint32_t NextHead = (PacketQueueHead + 1) % DDP_PACKET_QUEUE_SIZE;
+        if (NextHead == PacketQueueTail)
         {
-            // DEBUG_V ("Throw away the received packet. We dont have a place to put it.");
+            // DEBUG_V ("Throw away the received packet. The queue is full.");
+            stats.errors++;
             break;
         }
         // DEBUG_V ("");
 
-        PacketBuffer.ResponseAddress = ReceivedPacket.remoteIP ();
-        PacketBuffer.ResponsePort = ReceivedPacket.remotePort ();
-        memcpy ((void*)&PacketBuffer.Packet, ReceivedPacket.data (), sizeof (PacketBuffer.Packet));
-        PacketBuffer.PacketBufferStatus = PacketBufferStatus_t::BufferIsFilled;
+        QueuedPacket_t & QueuedPacket = PacketQueue[PacketQueueHead];
+        QueuedPacket.ResponseAddress = ReceivedPacket.remoteIP;
+        QueuedPacket.ResponsePort    = ReceivedPacket.remotePort;
+        QueuedPacket.DataLength      = min (uint32_t (PacketLength - Frame.headerLength), uint32_t (sizeof (QueuedPacket.data)));
+        memcpy ((void*)&QueuedPacket.header, (void*)ReceivedPacket.data, sizeof (QueuedPacket.header));
+        memcpy ((void*)QueuedPacket.data, Frame.data, QueuedPacket.DataLength);
+
+        // publish the entry
+        PacketQueueHead = NextHead;
 
     } while (false);
 
@@ -196,55 +282,79 @@ void c_InputDDP::Process ()
 {
     // DEBUG_START;
 
-    do // once
+    if (PushActive && ((millis () - LastPushTime) > DDP_PUSH_TIMEOUT_MS))
     {
-        if (PacketBuffer.PacketBufferStatus != PacketBufferStatus_t::BufferIsFilled)
+        logcon (String (F ("PUSH has stopped. Reverting to unlatched output.")));
+        UdpRxTask.Lock ();
+        PushRequested = false;
+        StopPush ();
+        UdpRxTask.Unlock ();
+    }
+
+    if (PushRequested && (nullptr == PushBuffer) && !PushBufferAllocFailed && (0 != InputDataBufferSize))
+    {
+        uint8_t * NewPushBuffer = (uint8_t *)malloc (InputDataBufferSize);
+        if (nullptr == NewPushBuffer)
         {
-            // DEBUG_V ("There is nothing in the buffer for us to porcess");
-            break;
+            logcon (String (F ("ERROR: Could not allocate the PUSH buffer. Frame latching is disabled.")));
+            PushBufferAllocFailed = true;
         }
+        else
+        {
+            // the receive task starts latching as soon as the pointer is set
+            UdpRxTask.Lock ();
+            memcpy (NewPushBuffer, InputDataBuffer, InputDataBufferSize);
+            PushBufferSize = InputDataBufferSize;
+            PushBuffer     = NewPushBuffer;
+            UdpRxTask.Unlock ();
+        }
+    }
 
-        // DEBUG_V ("There is something in the buffer for us to process");
-        PacketBuffer.PacketBufferStatus = PacketBufferStatus_t::BufferIsBeingProcessed;
+    while (PacketQueueTail != PacketQueueHead)
+    {
+        // DEBUG_V ("There is something in the queue for us to process");
+        QueuedPacket_t & QueuedPacket = PacketQueue[PacketQueueTail];
 
-        if (true == IsData(PacketBuffer.Packet.header.flags1))
+        if (true == IsQuery (QueuedPacket.header.flags1))
         {
-            ProcessReceivedData (PacketBuffer.Packet);
-            PacketBuffer.PacketBufferStatus = PacketBufferStatus_t::BufferIsAvailable;
-            break;
+            ProcessReceivedQuery (QueuedPacket);
         }
-
-        if (true == IsQuery (PacketBuffer.Packet.header.flags1))
+        else
         {
-            ProcessReceivedQuery ();
-            PacketBuffer.PacketBufferStatus = PacketBufferStatus_t::BufferIsAvailable;
-            break;
+            // DEBUG_V ("not sure what this thing is but we are going to ignore it");
         }
 
-        // DEBUG_V ("not sure what this thing is but we are going to ignore it");
-        PacketBuffer.PacketBufferStatus = PacketBufferStatus_t::BufferIsAvailable;
-        // DEBUG_V("UnSupported PDU type");
-
-    } while (false);
+        // release the slot
+        PacketQueueTail = (PacketQueueTail + 1) % DDP_PACKET_QUEUE_SIZE;
+    }
 
     // DEBUG_END;
 
 } // Process
 
 //-----------------------------------------------------------------------------
-void c_InputDDP::ProcessReceivedData (DDP_packet_t & Packet)
+void c_InputDDP::ProcessReceivedData (DdpFrame_t & Frame, uint32_t ArrivalUS)
 {
     // DEBUG_START;
 
     do // once
     {
-        DDP_Header_t & header = Packet.header;
-        // DEBUG_V (String ("              header: 0x") + String (uint32_t (&Packet.header), HEX));
+        if (IsStaleSequence (Frame.flags2))
+        {
+            // DEBUG_V ("Dropping an old packet that arrived out of order");
+            break;
+        }
 
         // is the offset and length valid?
 
-        uint32_t InputBufferOffset = ntohl (header.channelOffset);
-        uint32_t packetDataLength  = ntohs (header.dataLen);
+        uint32_t InputBufferOffset = Frame.channelOffset;
+        uint32_t packetDataLength  = Frame.dataLength;
+
+        if (Frame.dataTruncated)
+        {
+            // DEBUG_V ("dataLen claims more than the datagram holds");
+            stats.errors++;
+        }
 
         // DEBUG_V (String ("    packetDataLength: ") + String (packetDataLength));
         // DEBUG_V (String (" InputDataBufferSize: ") + String (InputDataBufferSize));
@@ -267,12 +377,62 @@ void c_InputDDP::ProcessReceivedData (DDP_packet_t & Packet)
         }
         // DEBUG_V (String (" AdjPacketDataLength: ") + String (AdjPacketDataLength));
 
-        byte* Data = (IsTime(header.flags1)) ? &((DDP_TimeCode_packet_t&)Packet).data[0] : &Packet.data[0];
+        const uint8_t * Data = Frame.data;
         // DEBUG_V (String ("                Data: 0x") + String (uint32_t (Data), HEX));
         // DEBUG_V (String ("   InputBufferOffset: ") + String (InputBufferOffset));
-        memcpy (&InputDataBuffer[InputBufferOffset], &Data[0], AdjPacketDataLength);
 
-        InputMgr.RestartBlankTimer (GetInputChannelId ());
+        if (!PushActive)
+        {
+            memcpy (&InputDataBuffer[InputBufferOffset], &Data[0], AdjPacketDataLength);
+            LatencyTracker.DataArrived (ArrivalUS);
+        }
+        else
+        {
+            // hold the data until the sender says the frame is complete
+            memcpy (&PushBuffer[InputBufferOffset], &Data[0], AdjPacketDataLength);
+            if (DirtyEnd == DirtyStart)
+            {
+                DirtyStart = InputBufferOffset;
+                DirtyEnd   = InputBufferOffset + AdjPacketDataLength;
+            }
+            else
+            {
+                DirtyStart = min (DirtyStart, InputBufferOffset);
+                DirtyEnd   = max (DirtyEnd,   InputBufferOffset + AdjPacketDataLength);
+            }
+        }
+
+        if (IsPush (Frame.flags1))
+        {
+            PushRequested = true;
+            LastPushTime  = millis ();
+
+            if (PushActive)
+            {
+                // latch the completed frame
+                if (DirtyEnd > DirtyStart)
+                {
+                    memcpy (&InputDataBuffer[DirtyStart], &PushBuffer[DirtyStart], DirtyEnd - DirtyStart);
+                }
+                ++stats.framesLatched;
+                LatencyTracker.DataArrived (ArrivalUS);
+            }
+            else if ((nullptr != PushBuffer) && (PushBufferSize == InputDataBufferSize))
+            {
+                // first PUSH with a back buffer. Start holding from what is currently being output
+                memcpy (PushBuffer, InputDataBuffer, PushBufferSize);
+                PushActive = true;
+            }
+
+            DirtyStart = DirtyEnd = 0;
+
+            // the whole frame is in. Compose it now.
+            InputMgr.FrameComplete (GetInputChannelId ());
+        }
+        else
+        {
+            InputMgr.RestartBlankTimer (GetInputChannelId ());
+        }
 
     } while (false);
 
@@ -281,11 +441,58 @@ void c_InputDDP::ProcessReceivedData (DDP_packet_t & Packet)
 } // ProcessReceivedData
 
 //-----------------------------------------------------------------------------
-void c_InputDDP::ProcessReceivedQuery ()
+/*
+    Track the 4 bit sequence number. Packets that are behind the last one we
+    accepted are stale and get dropped. Gaps are counted as lost packets.
+*/
+bool c_InputDDP::IsStaleSequence (uint8_t flags2)
 {
     // DEBUG_START;
 
-    DDP_packet_t & Packet = PacketBuffer.Packet;
+    bool Response = false;
+
+    do // once
+    {
+        uint8_t SequenceNumber = flags2 & DDP_FLAGS2_SEQMASK;
+        if (0 == SequenceNumber)
+        {
+            // sender is not using sequence numbers
+            break;
+        }
+
+        if (0 != lastReceivedSequenceNumber)
+        {
+            // distance from the last accepted packet around the 1 - 15 cycle
+            uint8_t Delta = (SequenceNumber + DDP_SEQUENCE_COUNT - lastReceivedSequenceNumber) % DDP_SEQUENCE_COUNT;
+
+            if (Delta > (DDP_SEQUENCE_COUNT / 2))
+            {
+                // behind the last packet
+                ++stats.outOfOrder;
+                Response = true;
+                break;
+            }
+
+            // some senders use one sequence number for every packet in a frame
+            if (Delta > 1)
+            {
+                stats.lostPackets += Delta - 1;
+            }
+        }
+
+        lastReceivedSequenceNumber = SequenceNumber;
+
+    } while (false);
+
+    // DEBUG_END;
+    return Response;
+
+} // IsStaleSequence
+
+//-----------------------------------------------------------------------------
+void c_InputDDP::ProcessReceivedQuery (QueuedPacket_t & Packet)
+{
+    // DEBUG_START;
 
     DDP_packet_t DDPresponse;
     memset ((void*)&DDPresponse, 0x00, sizeof (DDPresponse));
@@ -307,7 +514,7 @@ void c_InputDDP::ProcessReceivedQuery ()
             DDPresponse.header.dataLen = htons (JsonResponse.length());
             memcpy (&DDPresponse.data, JsonResponse.c_str (), JsonResponse.length());
             UDPresponse.write ((const uint8_t*)&DDPresponse, size_t(sizeof(DDPresponse.header) + JsonResponse.length ()));
-            udp->sendTo (UDPresponse, PacketBuffer.ResponseAddress, PacketBuffer.ResponsePort);
+            udp->sendTo (UDPresponse, Packet.ResponseAddress, Packet.ResponsePort);
             break;
         }
 
@@ -340,7 +547,7 @@ void c_InputDDP::ProcessReceivedQuery ()
             DDPresponse.header.dataLen = htons (JsonResponse.length ());
             memcpy (&DDPresponse.data, JsonResponse.c_str (), JsonResponse.length ());
             UDPresponse.write ((const uint8_t*)&DDPresponse, size_t (sizeof (DDPresponse.header) + JsonResponse.length ()));
-            udp->sendTo (UDPresponse, PacketBuffer.ResponseAddress, PacketBuffer.ResponsePort);
+            udp->sendTo (UDPresponse, Packet.ResponseAddress, Packet.ResponsePort);
             break;
         }
 
@@ -19,6 +19,8 @@
 
 #include "../ESPixelStick.h"
 #include "InputCommon.hpp"
+#include "../network/UdpRxTask.hpp"
+#include "InputPacketDecode.hpp"
 
 #ifdef ESP32
 #include <WiFi.h>
@@ -40,15 +42,12 @@ private:
 #define DDP_Header_t_LEN (sizeof(struct ddp_hdr_struct))
 #define DDP_MAX_DATALEN (480*3)   // fits nicely in an ethernet packet
 
-#define DDP_FLAGS1_VERMASK  0xc0   // version mask
-#define DDP_FLAGS1_VER1     0x40   // version=1
-#define DDP_FLAGS1_PUSH     0x01
-#define DDP_FLAGS1_QUERY    0x02
-#define DDP_FLAGS1_REPLY    0x04
-#define DDP_FLAGS1_STORAGE  0x08
-#define DDP_FLAGS1_TIME     0x10
-#define DDP_FLAGS1_DATAMASK (DDP_FLAGS1_QUERY | DDP_FLAGS1_REPLY | DDP_FLAGS1_STORAGE | DDP_FLAGS1_TIME)
-#define DDP_FLAGS1_DATA     0x00
+#define DDP_FLAGS2_SEQMASK  0x0f   // sequence 1 - 15. zero means not used
+#define DDP_SEQUENCE_COUNT  15
+#define DDP_PUSH_TIMEOUT_MS 2500   // revert to unlatched output if PUSH stops
+
+#define DDP_PACKET_QUEUE_SIZE   4  // control packets waiting for Process ()
+#define DDP_MAX_QUEUED_DATALEN 64  // control packets carry little or no data
 
 #define DDP_ID_DEFAULT_ID    1
 #define DDP_ID_CONTROL     246
@@ -80,18 +79,14 @@ private:
         byte         data[DDP_MAX_DATALEN];
     } DDP_packet_t;
 
-    typedef struct __attribute__ ((packed))
-    {
-        DDP_Header_t header;  // header may or may not be time code
-        uint32_t     TimeCode;
-        byte         data[DDP_MAX_DATALEN - sizeof(TimeCode)];
-    } DDP_TimeCode_packet_t;
-
     typedef struct __attribute__ ((packed))
     {
         uint32_t packetsReceived;
         uint64_t bytesReceived;
         uint32_t errors;
+        uint32_t framesLatched;
+        uint32_t lostPackets;
+        uint32_t outOfOrder;
     } DDP_stats_t;
 
     AsyncUDP        * udp = nullptr;         // UDP
@@ -99,36 +94,47 @@ private:
     bool            suspend = false;
     DDP_stats_t     stats;    // Statistics tracker
 
+    /// Once a sender uses PUSH, data is held in PushBuffer and latched into
+    /// the input buffer as a single frame when the PUSH packet arrives.
+    uint8_t       * PushBuffer            = nullptr; ///< Back buffer. Same layout as InputDataBuffer
+    uint32_t        PushBufferSize        = 0;
+    bool            PushBufferAllocFailed = false;
+    bool            PushRequested         = false;   ///< A PUSH has been seen. Need a back buffer
+    bool            PushActive            = false;   ///< Holding data for the next PUSH
+    uint32_t        LastPushTime          = 0;       ///< millis () of the last PUSH
+    uint32_t        DirtyStart            = 0;       ///< Range of PushBuffer written since the last latch
+    uint32_t        DirtyEnd              = 0;
+
     void NetworkStateChanged (bool NetwokState);
 
     // Packet parser callback
-    void ProcessReceivedUdpPacket (AsyncUDPPacket _packet);
-    void ProcessReceivedData  (DDP_packet_t & Packet);
-    void ProcessReceivedQuery ();
-
-    enum PacketBufferStatus_t
-    {
-        BufferIsAvailable,
-        BufferIsFilled,
-        BufferIsBeingProcessed,
-    };
+    void ProcessReceivedData  (DdpFrame_t & Frame, uint32_t ArrivalUS);
+    bool IsStaleSequence      (uint8_t flags2);
+    void StopPush             ();
+    void FreePushBuffer       ();
 
     typedef struct
     {
-        PacketBufferStatus_t PacketBufferStatus = PacketBufferStatus_t::BufferIsAvailable;
-        DDP_packet_t Packet;
-        IPAddress ResponseAddress;
-        uint16_t  ResponsePort;
-    } PacketBuffer_t;
+        DDP_Header_t header;
+        byte         data[DDP_MAX_QUEUED_DATALEN];
+        uint32_t     DataLength;
+        IPAddress    ResponseAddress;
+        uint16_t     ResponsePort;
+    } QueuedPacket_t;
+
+    /// Single producer (receive callback), single consumer (Process) ring
+    QueuedPacket_t    PacketQueue[DDP_PACKET_QUEUE_SIZE];
+    volatile uint32_t PacketQueueHead = 0;  ///< Next slot the receive callback fills
+    volatile uint32_t PacketQueueTail = 0;  ///< Next slot Process () reads
 
-    PacketBuffer_t PacketBuffer;
+    void ProcessReceivedQuery (QueuedPacket_t & Packet);
 
 public:
 
     c_InputDDP (c_InputMgr::e_InputChannelIds NewInputChannelId,
                 c_InputMgr::e_InputType       NewChannelType,
                 uint8_t                     * BufferStart,
-                uint16_t                      BufferSize);
+                uint32_t                      BufferSize);
 
     ~c_InputDDP ();
 
@@ -139,8 +145,9 @@ public:
     void GetStatus (JsonObject& jsonStatus);
     void Process ();                                        ///< Call from loop(),  renders Input data
     void GetDriverName (String& sDriverName) { sDriverName = "DDP"; } ///< get the name for the instantiated driver
-    void SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize);
+    void SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize);
     bool isShutDownRebootNeeded () { return HasBeenInitialized; }
+    void ProcessReceivedUdpPacket (UdpRxPacket_t & Packet);   ///< Called by the UDP receive task
 
 };
 
@@ -28,7 +28,7 @@
 c_InputDisabled::c_InputDisabled (c_InputMgr::e_InputChannelIds NewInputChannelId,
                                   c_InputMgr::e_InputType       NewChannelType,
                                   uint8_t* BufferStart,
-                                  uint16_t                      BufferSize) :
+                                  uint32_t                      BufferSize) :
     c_InputCommon (NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 {
     // DEBUG_START;
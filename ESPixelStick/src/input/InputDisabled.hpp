@@ -31,7 +31,7 @@ public:
     c_InputDisabled (c_InputMgr::e_InputChannelIds NewInputChannelId,
                      c_InputMgr::e_InputType       NewChannelType,
                      uint8_t *                     BufferStart,
-                     uint16_t                      BufferSize);
+                     uint32_t                      BufferSize);
     virtual ~c_InputDisabled ();
 
     // functions to be provided by the derived class
@@ -41,7 +41,7 @@ public:
     void GetStatus (JsonObject & jsonStatus);
     void Process ();                            ///< Call from loop(),  Process Input data
     void GetDriverName (String& sDriverName) { sDriverName = "Disabled"; } ///< get the name for the instantiated driver
-    void SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize) {}
+    void SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize) {}
 
 private:
 
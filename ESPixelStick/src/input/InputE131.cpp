@@ -1,5 +1,5 @@
 /*
-* E131Input.cpp - Code to wrap ESPAsyncE131 for input
+* E131Input.cpp - Code to receive E1.31 directly from AsyncUDP for input
 *
 * Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
 * Copyright (c) 2021 Shelby Merrick
@@ -19,20 +19,78 @@
 
 #include "InputE131.hpp"
 #include "../network/NetworkMgr.hpp"
+#include "../service/LatencyTracker.hpp"
+
+#include <lwip/igmp.h>
+#ifdef ARDUINO_ARCH_ESP32
+#   include <lwip/tcpip.h>
+#   include <lwip/priv/tcpip_priv.h>
+#endif // def ARDUINO_ARCH_ESP32
+
+//-----------------------------------------------------------------------------
+static void E131RxHandler (void * Context, UdpRxPacket_t & Packet)
+{
+    reinterpret_cast <c_InputE131*> (Context)->ProcessReceivedUdpPacket (Packet);
+} // E131RxHandler
+
+#ifdef ARDUINO_ARCH_ESP32
+typedef struct
+{
+    struct tcpip_api_call_data Call;    ///< Must be first
+    ip4_addr_t                 Group;
+    bool                       Join;
+} IgmpRequest_t;
+
+//-----------------------------------------------------------------------------
+static err_t IgmpRequestHandler (struct tcpip_api_call_data * Call)
+{
+    IgmpRequest_t * Request = reinterpret_cast <IgmpRequest_t *> (Call);
+    return Request->Join ? igmp_joingroup  (IP4_ADDR_ANY4, &Request->Group) :
+                           igmp_leavegroup (IP4_ADDR_ANY4, &Request->Group);
+} // IgmpRequestHandler
+#endif // def ARDUINO_ARCH_ESP32
+
+//-----------------------------------------------------------------------------
+/*
+    Join or leave the multicast group for a universe. On the ESP32 lwIP
+    runs in its own task, so the request is handed to tcpip_api_call (). It
+    holds the core lock, or runs the request in the lwIP task and waits for
+    it, depending on how lwIP was built. On the ESP8266 lwIP runs in the
+    same context as loop ().
+*/
+static err_t E131MulticastGroup (uint32_t UniverseId, bool Join)
+{
+    ip4_addr_t Group;
+    IP4_ADDR (&Group, 239, 255, ((UniverseId >> 8) & 0xff), ((UniverseId >> 0) & 0xff));
+
+#ifdef ARDUINO_ARCH_ESP32
+    IgmpRequest_t Request;
+    Request.Group = Group;
+    Request.Join  = Join;
+    return tcpip_api_call (IgmpRequestHandler, &Request.Call);
+#else
+    return Join ? igmp_joingroup (IP4_ADDR_ANY4, &Group) : igmp_leavegroup (IP4_ADDR_ANY4, &Group);
+#endif // def ARDUINO_ARCH_ESP32
+
+} // E131MulticastGroup
 
 //-----------------------------------------------------------------------------
 c_InputE131::c_InputE131 (c_InputMgr::e_InputChannelIds NewInputChannelId,
                           c_InputMgr::e_InputType       NewChannelType,
                           uint8_t                     * BufferStart,
-                          uint16_t                      BufferSize) :
+                          uint32_t                      BufferSize) :
     c_InputCommon(NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 
 {
     // DEBUG_START;
     // DEBUG_V ("BufferSize: " + String (BufferSize));
-    e131 = new ESPAsyncE131 (0);
+    PendingBuffer     = BufferStart;
+    PendingBufferSize = BufferSize;
+    memset ((void*)&stats, 0x00, sizeof (stats));
+    memset ((void*)Sources, 0x00, sizeof (Sources));
+    memset ((void*)Discovered, 0x00, sizeof (Discovered));
 
-    memset ((void*)UniverseArray, 0x00, sizeof (UniverseArray));
+    udp = new AsyncUDP ();
 
     // DEBUG_END;
 } // c_InputE131
@@ -42,6 +100,40 @@ c_InputE131::~c_InputE131()
 {
     // DEBUG_START;
 
+    if (nullptr != udp)
+    {
+        // stop the callbacks before this object goes away
+        udp->close ();
+        delete udp;
+        udp = nullptr;
+    }
+
+    // drop anything still waiting in the receive queue for us
+    UdpRxTask.Purge (this);
+
+    LeaveMulticastGroups ();
+
+    SyncActive = false;
+    if (nullptr != SyncBuffer)
+    {
+        free (SyncBuffer);
+        SyncBuffer = nullptr;
+    }
+
+    UniverseArraySize = 0;
+    if (nullptr != UniverseArray)
+    {
+        free (UniverseArray);
+        UniverseArray = nullptr;
+    }
+
+    MergeSlotCount = 0;
+    if (nullptr != MergeSlots)
+    {
+        free (MergeSlots);
+        MergeSlots = nullptr;
+    }
+
     // DEBUG_END;
 
 } // ~c_InputE131
@@ -59,11 +151,6 @@ void c_InputE131::Begin ()
         // DEBUG_V ("");
 
         // DEBUG_V ("");
-        e131->registerCallback ( (void*)this, [] (e131_packet_t* Packet, void * pThis)
-            {
-                ((c_InputE131*)pThis)->ProcessIncomingE131Data (Packet);
-            });
-
         NetworkStateChanged (NetworkMgr.IsConnected (), false);
 
         HasBeenInitialized = true;
@@ -83,6 +170,9 @@ void c_InputE131::GetConfig (JsonObject & jsonConfig)
     jsonConfig[CN_universe_limit] = ChannelsPerUniverse;
     jsonConfig[CN_universe_start] = FirstUniverseChannelOffset;
     jsonConfig[CN_port]           = PortId;
+    jsonConfig[CN_merge]          = MergeEnabled;
+    jsonConfig[CN_multicast]      = MulticastEnabled;
+    UniverseLoss.GetConfig (jsonConfig);
 
     // DEBUG_END;
 
@@ -99,21 +189,68 @@ void c_InputE131::GetStatus (JsonObject & jsonStatus)
     e131Status[CN_unilast ]   = LastUniverse;
     e131Status[CN_unichanlim] = ChannelsPerUniverse;
 
-    e131Status[CN_num_packets]   = e131->stats.num_packets;
-    e131Status[CN_last_clientIP] = uint32_t(e131->stats.last_clientIP);
+    e131Status[CN_num_packets]   = stats.num_packets;
+    e131Status[CN_last_clientIP] = uint32_t(stats.last_clientIP);
+    e131Status[CN_sync_address]  = SyncActive ? ActiveSyncAddress : 0;
+    e131Status[CN_sync_packets]  = stats.sync_packets;
+    e131Status[F ("source_changes")] = stats.source_changes;
+    e131Status[F ("preempted")]      = stats.preempted;
+    e131Status[F ("unknown_source")] = stats.unknown_source;
+    e131Status[F ("merge_slots")]    = MergeSlotCount;
+    e131Status[F ("merge_overflow")] = stats.merge_overflow;
+    e131Status[F ("unicast")]        = stats.unicast_packets;
+    e131Status[CN_multicast]         = stats.multicast_packets;
+    e131Status[F ("discovery")]      = stats.discovery_packets;
+
+    JsonArray DiscoveredStatus = e131Status.createNestedArray (F ("discovered"));
+    for (E131_discovered_t & Source : Discovered)
+    {
+        if (Source.InUse && ((millis () - Source.LastSeen) <= E131_DISCOVERY_TIMEOUT_MS))
+        {
+            JsonObject SourceStatus = DiscoveredStatus.createNestedObject ();
+            SourceStatus[CN_name]    = Source.Name;
+            SourceStatus[CN_ip]      = Source.RemoteIP.toString ();
+            SourceStatus[F ("ours")] = Source.Offered;
+        }
+    }
     // DEBUG_V ("");
 
     JsonArray e131UniverseStatus = e131Status.createNestedArray (CN_channels);
-    uint32_t TotalErrors = e131->stats.packet_errors;
-    for (auto & CurrentUniverse : UniverseArray)
+    uint32_t TotalErrors = stats.packet_errors;
+    uint32_t StaleUniverses = 0;
+
+    // the table can be swapped by the main loop while the web server runs this
+    UdpRxTask.Lock ();
+    for (uint32_t UniverseIndex = 0; UniverseIndex < UniverseArraySize; ++UniverseIndex)
     {
+        Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
         JsonObject e131CurrentUniverseStatus = e131UniverseStatus.createNestedObject ();
 
         e131CurrentUniverseStatus[CN_errors] = CurrentUniverse.SequenceErrorCounter;
+
+        uint32_t NumSources = 0;
+        for (uint32_t SourceIndex = 0; SourceIndex < E131_MAX_SOURCES; ++SourceIndex)
+        {
+            if ((CurrentUniverse.ActiveSources & (1 << SourceIndex)) &&
+                ((millis () - CurrentUniverse.SourceLastSeen[SourceIndex]) <= E131_SOURCE_LOSS_TIMEOUT_MS))
+            {
+                ++NumSources;
+            }
+        }
+        e131CurrentUniverseStatus[CN_sources]  = NumSources;
+        e131CurrentUniverseStatus[CN_priority] = CurrentUniverse.ActivePriority;
+        e131CurrentUniverseStatus[CN_stale]    = UniverseLoss.IsStale (CurrentUniverse.Loss);
+        e131CurrentUniverseStatus[F ("losses")] = CurrentUniverse.Loss.Losses;
         TotalErrors += CurrentUniverse.SequenceErrorCounter;
+        if (UniverseLoss.IsStale (CurrentUniverse.Loss))
+        {
+            ++StaleUniverses;
+        }
     }
+    UdpRxTask.Unlock ();
 
     e131Status[CN_packet_errors] = TotalErrors;
+    e131Status[CN_stale]         = StaleUniverses;
 
     // DEBUG_END;
 
@@ -124,16 +261,213 @@ void c_InputE131::Process ()
 {
     // DEBUG_START;
 
+    // hold, fade or blank the universes that have gone quiet. The receive
+    // task updates the same entries.
+    uint32_t now = millis ();
+    UdpRxTask.Lock ();
+    for (uint32_t UniverseIndex = 0; UniverseIndex < UniverseArraySize; ++UniverseIndex)
+    {
+        Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
+        uint32_t Offset   = CurrentUniverse.Destination - InputDataBuffer;
+        uint8_t * BackData = ((nullptr != SyncBuffer) && ((Offset + CurrentUniverse.BytesToCopy) <= SyncBufferSize)) ? &SyncBuffer[Offset] : nullptr;
+        UniverseLoss.Poll (CurrentUniverse.Loss, CurrentUniverse.Destination, BackData, CurrentUniverse.BytesToCopy, now);
+    }
+    UdpRxTask.Unlock ();
+
+    do // once
+    {
+        if (SyncActive && ((now - LastSyncTime) > E131_SYNC_TIMEOUT_MS))
+        {
+            logcon (String (F ("Lost sync on sync address ")) + String (ActiveSyncAddress) + F (". Reverting to unsynchronized output."));
+            UdpRxTask.Lock ();
+            StopSync ();
+            // the next tagged data packet sets it (and the sync group) up again
+            ActiveSyncAddress = 0;
+            UdpRxTask.Unlock ();
+            LeaveSyncGroup ();
+            break;
+        }
+
+        UpdateSyncGroup ();
+
+        if ((0 == ActiveSyncAddress) || (nullptr != SyncBuffer) || SyncBufferAllocFailed || (0 == InputDataBufferSize))
+        {
+            // no back buffer needed (or possible)
+            break;
+        }
+
+        // a sender is tagging its data with a sync address. Get ready to latch.
+        uint8_t * NewSyncBuffer = (uint8_t *)malloc (InputDataBufferSize);
+        if (nullptr == NewSyncBuffer)
+        {
+            logcon (String (F ("ERROR: Could not allocate the sync buffer. Universe synchronization is disabled.")));
+            SyncBufferAllocFailed = true;
+            break;
+        }
+
+        // the receive task starts using it as soon as the pointer is set
+        UdpRxTask.Lock ();
+        memcpy (NewSyncBuffer, InputDataBuffer, InputDataBufferSize);
+        SyncBufferSize = InputDataBufferSize;
+        SyncBuffer     = NewSyncBuffer;
+        UdpRxTask.Unlock ();
+
+    } while (false);
+
     // DEBUG_END;
 
 } // process
 
 //-----------------------------------------------------------------------------
-void c_InputE131::ProcessIncomingE131Data (e131_packet_t * packet)
+/*
+    Stop holding data for a sync packet and push out whatever was waiting
+    in the back buffer. Call with the receive task locked out.
+*/
+void c_InputE131::StopSync ()
+{
+    // DEBUG_START;
+
+    if (SyncActive)
+    {
+        SyncActive = false;
+        LatchSyncBuffer ();
+    }
+
+    // DEBUG_END;
+
+} // StopSync
+
+//-----------------------------------------------------------------------------
+/*
+    Copy the universes that received tagged data since the last latch from
+    the back buffer into the input buffer. Universes sent without a sync
+    address are written straight to the input buffer and are left alone.
+    Call with the receive task locked out.
+*/
+void c_InputE131::LatchSyncBuffer ()
+{
+    // DEBUG_START;
+
+    for (uint32_t UniverseIndex = 0; UniverseIndex < UniverseArraySize; ++UniverseIndex)
+    {
+        Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
+        if (!CurrentUniverse.SyncPending)
+        {
+            continue;
+        }
+
+        CurrentUniverse.SyncPending = false;
+        uint32_t Offset = CurrentUniverse.Destination - InputDataBuffer;
+        if ((Offset + CurrentUniverse.BytesToCopy) <= SyncBufferSize)
+        {
+            memcpy (CurrentUniverse.Destination, &SyncBuffer[Offset], CurrentUniverse.BytesToCopy);
+        }
+    }
+
+    // DEBUG_END;
+
+} // LatchSyncBuffer
+
+//-----------------------------------------------------------------------------
+/*
+    Called from the UDP receive task. The packet is validated and copied
+    directly out of the receive queue entry.
+*/
+void c_InputE131::ProcessReceivedUdpPacket (UdpRxPacket_t & Packet)
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        uint16_t SyncAddress;
+        if (DecodeE131Sync (Packet.data, Packet.length, SyncAddress))
+        {
+            ++stats.sync_packets;
+            ProcessIncomingE131Sync (SyncAddress, Packet.arrivalUS);
+            break;
+        }
+
+        E131DiscoveryFrame_t DiscoveryFrame;
+        if (DecodeE131Discovery (Packet.data, Packet.length, DiscoveryFrame))
+        {
+            ++stats.discovery_packets;
+            ProcessIncomingE131Discovery (DiscoveryFrame, Packet.remoteIP);
+            break;
+        }
+
+        E131DataFrame_t Frame;
+        if (!DecodeE131Data (Packet.data, Packet.length, Frame))
+        {
+            // DEBUG_V ("Invalid E1.31 packet");
+            ++stats.packet_errors;
+            break;
+        }
+
+        ++stats.num_packets;
+        stats.last_clientIP = Packet.remoteIP;
+        if (Packet.isBroadcast)
+        {
+            ++stats.multicast_packets;
+        }
+        else
+        {
+            ++stats.unicast_packets;
+        }
+
+        ProcessIncomingE131Data (Frame, Packet.arrivalUS);
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // ProcessReceivedUdpPacket
+
+//-----------------------------------------------------------------------------
+/*
+    All of the universes tagged with this sync address have been sent.
+    Latch the back buffer into the input buffer as a single frame.
+*/
+void c_InputE131::ProcessIncomingE131Sync (uint16_t SyncAddress, uint32_t ArrivalUS)
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        if ((0 == SyncAddress) || (SyncAddress != ActiveSyncAddress) || (nullptr == SyncBuffer))
+        {
+            // DEBUG_V ("Not our sync address or not ready to latch");
+            break;
+        }
+
+        if (SyncActive)
+        {
+            LatchSyncBuffer ();
+            LatencyTracker.DataArrived (ArrivalUS);
+
+            // the whole frame is in. Compose it now.
+            InputMgr.FrameComplete (GetInputChannelId ());
+        }
+        else
+        {
+            // first sync. Start holding from what is currently being output
+            memcpy (SyncBuffer, InputDataBuffer, min (SyncBufferSize, InputDataBufferSize));
+            SyncActive = true;
+            logcon (String (F ("Synchronizing on sync address ")) + String (SyncAddress));
+        }
+
+        LastSyncTime = millis ();
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // ProcessIncomingE131Sync
+
+//-----------------------------------------------------------------------------
+void c_InputE131::ProcessIncomingE131Data (E131DataFrame_t & Frame, uint32_t ArrivalUS)
 {
     // DEBUG_START;
 
-    uint8_t   * E131Data;
     uint16_t    CurrentUniverseId;
 
     do // once
@@ -144,39 +478,95 @@ void c_InputE131::ProcessIncomingE131Data (e131_packet_t * packet)
             break;
         }
 
-        CurrentUniverseId = ntohs (packet->universe);
-        E131Data = packet->property_values + 1;
+        if (Frame.options & E131_OPTIONS_PREVIEW_DATA)
+        {
+            // visualizer data. Not for output
+            break;
+        }
+
+        CurrentUniverseId = Frame.universe;
 
         // DEBUG_V ("     CurrentUniverseId: " + String(CurrentUniverseId));
-        // DEBUG_V ("packet.sequence_number: " + String(packet.sequence_number));
+        // DEBUG_V ("  Frame.sequence: " + String(Frame.sequence));
 
-        if ((startUniverse <= CurrentUniverseId) && (LastUniverse >= CurrentUniverseId))
+        uint32_t UniverseIndex = uint32_t (CurrentUniverseId) - uint32_t (startUniverse);
+        if ((startUniverse <= CurrentUniverseId) && (UniverseIndex < UniverseArraySize))
         {
             // Universe offset and sequence tracking
-            Universe_t& CurrentUniverse = UniverseArray[CurrentUniverseId - startUniverse];
+            Universe_t& CurrentUniverse = UniverseArray[UniverseIndex];
+
+            uint32_t now = millis ();
+            uint8_t SourceIndex = FindSource (Frame.cid, now);
+            if (E131_NO_SOURCE == SourceIndex)
+            {
+                // DEBUG_V ("Too many sources");
+                ++stats.unknown_source;
+                break;
+            }
+
+            if (Frame.options & E131_OPTIONS_STREAM_TERMINATED)
+            {
+                // the source is going away. Its data is not to be used.
+                RemoveSource (UniverseIndex, SourceIndex);
+                break;
+            }
+
+            SourceAction_t SourceAction = SelectSource (UniverseIndex, SourceIndex, Frame.priority, now);
+            if (SourceAction_Drop == SourceAction)
+            {
+                // DEBUG_V ("Another source owns this universe");
+                break;
+            }
 
             // Do we need to update a sequnce error?
-            if (packet->sequence_number != CurrentUniverse.SequenceNumber)
+            if (Frame.sequence != CurrentUniverse.SequenceNumber)
             {
                 // DEBUG_V (F ("E1.31 Sequence Error - expected: "));
                 // DEBUG_V (CurrentUniverse.SequenceNumber);
                 // DEBUG_V (F (" actual: "));
-                // DEBUG_V (packet->sequence_number);
+                // DEBUG_V (Frame.sequence);
                 // DEBUG_V (" " + String (CN_universe) + " : ");
                 // DEBUG_V (CurrentUniverseId);
 
                 CurrentUniverse.SequenceErrorCounter++;
-                CurrentUniverse.SequenceNumber = packet->sequence_number;
+                CurrentUniverse.SequenceNumber = Frame.sequence;
             }
 
             ++CurrentUniverse.SequenceNumber;
 
-            uint16_t NumBytesOfE131Data = ntohs (packet->property_value_count) - 1;
+            // data tagged with a sync address waits in the back buffer for the sync packet
+            uint8_t * Destination = CurrentUniverse.Destination;
+            uint16_t  SyncAddress = Frame.syncAddress;
+            if (0 != SyncAddress)
+            {
+                if (SyncActive && (SyncAddress == ActiveSyncAddress))
+                {
+                    Destination = &SyncBuffer[CurrentUniverse.Destination - InputDataBuffer];
+                    CurrentUniverse.SyncPending = true;
+                }
+                ActiveSyncAddress = SyncAddress;
+            }
+
+            if ((SourceAction_Merge == SourceAction) && (Frame.numSlots > CurrentUniverse.SourceDataOffset))
+            {
+                uint32_t BytesToMerge = min (uint32_t (CurrentUniverse.BytesToCopy), Frame.numSlots - CurrentUniverse.SourceDataOffset);
+                if (!MergeUniverse (UniverseIndex, SourceIndex, &Frame.slots[CurrentUniverse.SourceDataOffset], BytesToMerge, Destination))
+                {
+                    SourceAction = SourceAction_Copy;
+                }
+            }
+
+            if (SourceAction_Copy == SourceAction)
+            {
+                CopySlots (Destination, Frame.slots, Frame.numSlots, CurrentUniverse.SourceDataOffset, CurrentUniverse.BytesToCopy);
+            }
 
-            memcpy (CurrentUniverse.Destination,
-                &E131Data[CurrentUniverse.SourceDataOffset],
-                min (CurrentUniverse.BytesToCopy, NumBytesOfE131Data));
+            if (Destination == CurrentUniverse.Destination)
+            {
+                LatencyTracker.DataArrived (ArrivalUS);
+            }
 
+            UniverseLoss.DataArrived (CurrentUniverse.Loss, now);
             InputMgr.RestartBlankTimer (GetInputChannelId ());
         }
         else
@@ -188,15 +578,379 @@ void c_InputE131::ProcessIncomingE131Data (e131_packet_t * packet)
 
     // DEBUG_END;
 
-} // process
+} // ProcessIncomingE131Data
+
+//-----------------------------------------------------------------------------
+/*
+    Sources send the list of universes they transmit to the discovery
+    universe every ten seconds. The list can be spread over several pages.
+    Remember who is out there and how many of our universes each one
+    offers so the status page can show what the network is sending.
+*/
+void c_InputE131::ProcessIncomingE131Discovery (E131DiscoveryFrame_t & Frame, IPAddress RemoteIP)
+{
+    // DEBUG_START;
+
+    uint32_t now = millis ();
+
+    // find the source or the entry that has been quiet the longest
+    E131_discovered_t * Entry = &Discovered[0];
+    for (E131_discovered_t & Source : Discovered)
+    {
+        if (Source.InUse && (0 == memcmp (Source.cid, Frame.cid, E131_CID_SIZE)))
+        {
+            Entry = &Source;
+            break;
+        }
+
+        if (!Source.InUse)
+        {
+            Entry = &Source;
+        }
+        else if (Entry->InUse && ((now - Source.LastSeen) > (now - Entry->LastSeen)))
+        {
+            Entry = &Source;
+        }
+    }
+
+    if (!Entry->InUse || (0 != memcmp (Entry->cid, Frame.cid, E131_CID_SIZE)))
+    {
+        memset ((void*)Entry, 0x00, sizeof (E131_discovered_t));
+        memcpy (Entry->cid, Frame.cid, E131_CID_SIZE);
+        memcpy (Entry->Name, Frame.sourceName, E131_DISCOVERY_NAME_SIZE - 1);
+        Entry->InUse = true;
+    }
+
+    Entry->RemoteIP = RemoteIP;
+    Entry->LastSeen = now;
+
+    if (0 == Frame.page)
+    {
+        Entry->OfferedPending = 0;
+    }
+
+    for (uint32_t Index = 0; Index < Frame.numUniverses; ++Index)
+    {
+        uint16_t UniverseId = E131DiscoveryUniverse (Frame, Index);
+        if ((UniverseId >= startUniverse) && (UniverseId <= LastUniverse))
+        {
+            ++Entry->OfferedPending;
+        }
+    }
+
+    if (Frame.page >= Frame.lastPage)
+    {
+        Entry->Offered = Entry->OfferedPending;
+    }
+
+    // DEBUG_END;
+
+} // ProcessIncomingE131Discovery
+
+//-----------------------------------------------------------------------------
+/*
+    Map a CID to an entry in the source table. The last match is checked
+    first so a single sender costs one compare. Entries that have not been
+    heard from for E131_SOURCE_LOSS_TIMEOUT_MS are reused.
+*/
+uint8_t c_InputE131::FindSource (const uint8_t * cid, uint32_t now)
+{
+    // DEBUG_START;
+
+    uint8_t Response = E131_NO_SOURCE;
+
+    do // once
+    {
+        E131_source_t & LastSource = Sources[LastSourceIndex];
+        if (LastSource.InUse && (0 == memcmp (LastSource.cid, cid, sizeof (LastSource.cid))))
+        {
+            LastSource.LastSeen = now;
+            Response = LastSourceIndex;
+            break;
+        }
+
+        uint8_t FreeIndex = E131_NO_SOURCE;
+        for (uint8_t SourceIndex = 0; SourceIndex < E131_MAX_SOURCES; ++SourceIndex)
+        {
+            E131_source_t & CurrentSource = Sources[SourceIndex];
+            if (CurrentSource.InUse && (0 == memcmp (CurrentSource.cid, cid, sizeof (CurrentSource.cid))))
+            {
+                Response = SourceIndex;
+                break;
+            }
+
+            if ((E131_NO_SOURCE == FreeIndex) &&
+                (!CurrentSource.InUse || ((now - CurrentSource.LastSeen) > E131_SOURCE_LOSS_TIMEOUT_MS)))
+            {
+                FreeIndex = SourceIndex;
+            }
+        }
+
+        if ((E131_NO_SOURCE == Response) && (E131_NO_SOURCE != FreeIndex))
+        {
+            // new sender
+            E131_source_t & NewSource = Sources[FreeIndex];
+            memcpy (NewSource.cid, cid, sizeof (NewSource.cid));
+            NewSource.InUse = true;
+            Response = FreeIndex;
+        }
+
+        if (E131_NO_SOURCE != Response)
+        {
+            Sources[Response].LastSeen = now;
+            LastSourceIndex = Response;
+        }
+
+    } while (false);
+
+    // DEBUG_END;
+    return Response;
+
+} // FindSource
 
 //-----------------------------------------------------------------------------
-void c_InputE131::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+/*
+    Decide what to do with a packet from SourceIndex for a universe.
+
+    The highest priority wins. At equal priority the sources are merged
+    (HTP) if merging is enabled, otherwise the current owner keeps the
+    universe until it goes quiet.
+*/
+c_InputE131::SourceAction_t c_InputE131::SelectSource (uint32_t UniverseIndex, uint8_t SourceIndex, uint8_t Priority, uint32_t now)
+{
+    // DEBUG_START;
+
+    Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
+    SourceAction_t Response = SourceAction_Copy;
+    uint8_t SourceBit = uint8_t (1 << SourceIndex);
+
+    CurrentUniverse.SourceLastSeen[SourceIndex] = now;
+    CurrentUniverse.SourcePriority[SourceIndex] = Priority;
+
+    do // once
+    {
+        if (SourceBit == CurrentUniverse.ActiveSources)
+        {
+            // fast path. Nobody else is sending this universe.
+            CurrentUniverse.ActivePriority = Priority;
+            break;
+        }
+
+        ExpireSources (UniverseIndex, now);
+        CurrentUniverse.ActiveSources |= SourceBit;
+
+        uint8_t HighestPriority = 0;
+        uint8_t NumAtHighestPriority = 0;
+        for (uint8_t Index = 0; Index < E131_MAX_SOURCES; ++Index)
+        {
+            if (0 == (CurrentUniverse.ActiveSources & (1 << Index)))
+            {
+                continue;
+            }
+
+            if (CurrentUniverse.SourcePriority[Index] > HighestPriority)
+            {
+                HighestPriority = CurrentUniverse.SourcePriority[Index];
+                NumAtHighestPriority = 1;
+            }
+            else if (CurrentUniverse.SourcePriority[Index] == HighestPriority)
+            {
+                ++NumAtHighestPriority;
+            }
+        }
+        CurrentUniverse.ActivePriority = HighestPriority;
+
+        if (Priority < HighestPriority)
+        {
+            // DEBUG_V ("A higher priority source is active");
+            ++stats.preempted;
+            Response = SourceAction_Drop;
+            break;
+        }
+
+        if (1 < NumAtHighestPriority)
+        {
+            if (MergeEnabled)
+            {
+                Response = SourceAction_Merge;
+                break;
+            }
+
+            // keep the current owner if it is still at the top
+            uint8_t Owner = CurrentUniverse.Owner;
+            if ((E131_NO_SOURCE != Owner) &&
+                (Owner != SourceIndex) &&
+                (CurrentUniverse.ActiveSources & (1 << Owner)) &&
+                (CurrentUniverse.SourcePriority[Owner] == HighestPriority))
+            {
+                Response = SourceAction_Drop;
+                break;
+            }
+        }
+
+    } while (false);
+
+    if ((SourceAction_Copy == Response) && (SourceIndex != CurrentUniverse.Owner))
+    {
+        // DEBUG_V ("New owner for this universe");
+        if (E131_NO_SOURCE != CurrentUniverse.Owner)
+        {
+            ++stats.source_changes;
+        }
+        CurrentUniverse.Owner = SourceIndex;
+        ReleaseMergeSlots (UniverseIndex, E131_NO_SOURCE);
+    }
+    else if (SourceAction_Merge == Response)
+    {
+        CurrentUniverse.Owner = SourceIndex;
+    }
+
+    // DEBUG_END;
+    return Response;
+
+} // SelectSource
+
+//-----------------------------------------------------------------------------
+///< Forget the sources that have stopped sending to a universe
+void c_InputE131::ExpireSources (uint32_t UniverseIndex, uint32_t now)
+{
+    // DEBUG_START;
+
+    Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
+
+    for (uint8_t SourceIndex = 0; SourceIndex < E131_MAX_SOURCES; ++SourceIndex)
+    {
+        if ((CurrentUniverse.ActiveSources & (1 << SourceIndex)) &&
+            ((now - CurrentUniverse.SourceLastSeen[SourceIndex]) > E131_SOURCE_LOSS_TIMEOUT_MS))
+        {
+            // DEBUG_V (String ("Source lost: ") + String (SourceIndex));
+            RemoveSource (UniverseIndex, SourceIndex);
+        }
+    }
+
+    // DEBUG_END;
+
+} // ExpireSources
+
+//-----------------------------------------------------------------------------
+void c_InputE131::RemoveSource (uint32_t UniverseIndex, uint8_t SourceIndex)
+{
+    // DEBUG_START;
+
+    Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
+
+    CurrentUniverse.ActiveSources &= uint8_t (~(1 << SourceIndex));
+    if (SourceIndex == CurrentUniverse.Owner)
+    {
+        CurrentUniverse.Owner = E131_NO_SOURCE;
+    }
+
+    // nothing left to merge with when a single source remains
+    bool MultipleSources = (0 != (CurrentUniverse.ActiveSources & (CurrentUniverse.ActiveSources - 1)));
+    ReleaseMergeSlots (UniverseIndex, MultipleSources ? SourceIndex : E131_NO_SOURCE);
+
+    // DEBUG_END;
+
+} // RemoveSource
+
+//-----------------------------------------------------------------------------
+/*
+    Save the data from one source and rebuild the universe as the highest
+    value per slot across all of the sources at the active priority.
+    Returns false if the data could not be merged and should be copied.
+*/
+bool c_InputE131::MergeUniverse (uint32_t UniverseIndex, uint8_t SourceIndex, const uint8_t * Data, uint32_t DataLength, uint8_t * Destination)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
+    {
+        if (nullptr == MergeSlots)
+        {
+            // the buffers could not be allocated. Output this source as is.
+            ++stats.merge_overflow;
+            if (!MergeOverflowLogged)
+            {
+                MergeOverflowLogged = true;
+                logcon (String (F ("WARNING: No merge buffers. Sources sending at the same priority are not merged.")));
+            }
+            break;
+        }
+
+        E131_merge_slot_t * UniverseSlots = &MergeSlots[UniverseIndex * E131_MAX_SOURCES];
+        E131_merge_slot_t & SourceSlot    = UniverseSlots[SourceIndex];
+        if (!SourceSlot.InUse)
+        {
+            SourceSlot.InUse = true;
+            memset (SourceSlot.Data, 0x00, sizeof (SourceSlot.Data));
+        }
+
+        DataLength = min (DataLength, uint32_t (sizeof (SourceSlot.Data)));
+        memcpy (SourceSlot.Data, Data, DataLength);
+
+        Universe_t & CurrentUniverse = UniverseArray[UniverseIndex];
+        memcpy (Destination, SourceSlot.Data, DataLength);
+        for (uint8_t OtherIndex = 0; OtherIndex < E131_MAX_SOURCES; ++OtherIndex)
+        {
+            E131_merge_slot_t & CurrentSlot = UniverseSlots[OtherIndex];
+            if ((OtherIndex == SourceIndex) ||
+                !CurrentSlot.InUse ||
+                (CurrentUniverse.SourcePriority[OtherIndex] != CurrentUniverse.ActivePriority))
+            {
+                continue;
+            }
+
+            for (uint32_t Index = 0; Index < DataLength; ++Index)
+            {
+                if (CurrentSlot.Data[Index] > Destination[Index])
+                {
+                    Destination[Index] = CurrentSlot.Data[Index];
+                }
+            }
+        }
+
+        Response = true;
+
+    } while (false);
+
+    // DEBUG_END;
+    return Response;
+
+} // MergeUniverse
+
+//-----------------------------------------------------------------------------
+///< Free the merge slots held by a source on a universe. E131_NO_SOURCE frees all of them.
+void c_InputE131::ReleaseMergeSlots (uint32_t UniverseIndex, uint8_t SourceIndex)
+{
+    // DEBUG_START;
+
+    if ((nullptr != MergeSlots) && (UniverseIndex < UniverseArraySize))
+    {
+        E131_merge_slot_t * UniverseSlots = &MergeSlots[UniverseIndex * E131_MAX_SOURCES];
+        for (uint8_t Index = 0; Index < E131_MAX_SOURCES; ++Index)
+        {
+            if ((E131_NO_SOURCE == SourceIndex) || (SourceIndex == Index))
+            {
+                UniverseSlots[Index].InUse = false;
+            }
+        }
+    }
+
+    // DEBUG_END;
+
+} // ReleaseMergeSlots
+
+//-----------------------------------------------------------------------------
+void c_InputE131::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
-    InputDataBuffer = BufferStart;
-    InputDataBufferSize = BufferSize;
+    // the receive task keeps using the old buffer until the new universe
+    // table is swapped in
+    PendingBuffer     = BufferStart;
+    PendingBufferSize = BufferSize;
 
     if (HasBeenInitialized)
     {
@@ -205,7 +959,7 @@ void c_InputE131::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
         Begin ();
     }
 
-    SetBufferTranslation ();
+    validateConfiguration ();
 
     // DEBUG_END;
 
@@ -216,24 +970,66 @@ void c_InputE131::SetBufferTranslation ()
 {
     // DEBUG_START;
 
-    // for each possible universe, set the start and size
+    // build the new table while the receive task keeps using the old one.
+    // Size it so that a universe id maps directly to its entry
+    uint32_t NumUniverses = (LastUniverse >= startUniverse) ? (uint32_t (LastUniverse) - uint32_t (startUniverse) + 1) : 0;
+    Universe_t * NewUniverseArray = nullptr;
+    if (0 != NumUniverses)
+    {
+        NewUniverseArray = (Universe_t *)malloc (NumUniverses * sizeof (Universe_t));
+        if (nullptr == NewUniverseArray)
+        {
+            logcon (String (F ("ERROR: Could not allocate memory for ")) + String (NumUniverses) + F (" universes."));
+            NumUniverses = 0;
+        }
+        else
+        {
+            memset ((void*)NewUniverseArray, 0x00, NumUniverses * sizeof (Universe_t));
+        }
+    }
 
-    uint16_t InputOffset = FirstUniverseChannelOffset - 1;
-    uint16_t DestinationOffset = 0;
-    uint16_t BytesLeftToMap = InputDataBufferSize;
+    // one merge buffer for every universe / source pair so a merge always has room
+    uint32_t NewMergeSlotCount = 0;
+    E131_merge_slot_t * NewMergeSlots = nullptr;
+    if (MergeEnabled && (0 != NumUniverses))
+    {
+        NewMergeSlotCount = NumUniverses * E131_MAX_SOURCES;
+        NewMergeSlots = (E131_merge_slot_t *)malloc (NewMergeSlotCount * sizeof (E131_merge_slot_t));
+        if (nullptr == NewMergeSlots)
+        {
+            logcon (String (F ("ERROR: Could not allocate ")) + String (NewMergeSlotCount) + F (" merge buffers. Sources will not be merged."));
+            NewMergeSlotCount = 0;
+        }
+        else
+        {
+            for (uint32_t SlotIndex = 0; SlotIndex < NewMergeSlotCount; ++SlotIndex)
+            {
+                NewMergeSlots[SlotIndex].InUse = false;
+            }
+        }
+    }
+
+    uint32_t InputOffset = FirstUniverseChannelOffset - 1;
+    uint32_t DestinationOffset = 0;
+    uint32_t BytesLeftToMap = PendingBufferSize;
 
     // set up the bytes for the First Universe
-    uint16_t BytesInUniverse = ChannelsPerUniverse - InputOffset;
+    uint32_t BytesInUniverse = ChannelsPerUniverse - InputOffset;
     // DEBUG_V (String ("ChannelsPerUniverse: ") + String (uint32_t (ChannelsPerUniverse), HEX));
 
-    for (auto& CurrentUniverse : UniverseArray)
+    for (uint32_t UniverseIndex = 0; UniverseIndex < NumUniverses; ++UniverseIndex)
     {
-        uint16_t BytesInThisUniverse = min (BytesInUniverse, BytesLeftToMap);
-        CurrentUniverse.Destination = &InputDataBuffer[DestinationOffset];
+        Universe_t & CurrentUniverse = NewUniverseArray[UniverseIndex];
+        uint32_t BytesInThisUniverse = min (BytesInUniverse, BytesLeftToMap);
+        CurrentUniverse.Destination = &PendingBuffer[DestinationOffset];
         CurrentUniverse.BytesToCopy = BytesInThisUniverse;
         CurrentUniverse.SourceDataOffset = InputOffset;
         CurrentUniverse.SequenceErrorCounter = 0;
         CurrentUniverse.SequenceNumber = 0;
+        CurrentUniverse.Owner = E131_NO_SOURCE;
+        CurrentUniverse.ActiveSources = 0;
+        CurrentUniverse.ActivePriority = 0;
+        UniverseLoss.Reset (CurrentUniverse.Loss);
 
         // DEBUG_V (String ("        Destination: ") + String (uint32_t (CurrentUniverse.Destination), HEX));
         // DEBUG_V (String ("        BytesToCopy: ") + String (CurrentUniverse.BytesToCopy, HEX));
@@ -245,6 +1041,47 @@ void c_InputE131::SetBufferTranslation ()
         InputOffset = 0;
     }
 
+    // swap the tables while no handler is running
+    UdpRxTask.Lock ();
+
+    Universe_t * OldUniverseArray = UniverseArray;
+    UniverseArray     = NewUniverseArray;
+    UniverseArraySize = NumUniverses;
+
+    // the new table points into the new buffer
+    InputDataBuffer     = PendingBuffer;
+    InputDataBufferSize = PendingBufferSize;
+
+    // the back buffer has to follow the input buffer. Process () will rebuild it.
+    uint8_t * OldSyncBuffer = SyncBuffer;
+    SyncBuffer            = nullptr;
+    SyncBufferSize        = 0;
+    SyncActive            = false;
+    SyncBufferAllocFailed = false;
+
+    // the merge buffers are indexed by universe
+    E131_merge_slot_t * OldMergeSlots = MergeSlots;
+    MergeSlots          = NewMergeSlots;
+    MergeSlotCount      = NewMergeSlotCount;
+    MergeOverflowLogged = false;
+
+    UdpRxTask.Unlock ();
+
+    if (nullptr != OldUniverseArray)
+    {
+        free (OldUniverseArray);
+    }
+
+    if (nullptr != OldSyncBuffer)
+    {
+        free (OldSyncBuffer);
+    }
+
+    if (nullptr != OldMergeSlots)
+    {
+        free (OldMergeSlots);
+    }
+
     if (0 != BytesLeftToMap)
     {
         logcon (String (F ("ERROR: Universe configuration is too small to fill output buffer. Outputs have been truncated.")));
@@ -259,14 +1096,17 @@ bool c_InputE131::SetConfig (ArduinoJson::JsonObject& jsonConfig)
 {
     // DEBUG_START;
 
-    ESPAsyncE131PortId OldPortId = PortId;
+    uint16_t OldPortId = PortId;
 
     setFromJSON (startUniverse,              jsonConfig, CN_universe);
     setFromJSON (ChannelsPerUniverse,        jsonConfig, CN_universe_limit);
     setFromJSON (FirstUniverseChannelOffset, jsonConfig, CN_universe_start);
     setFromJSON (PortId,                     jsonConfig, CN_port);
+    setFromJSON (MergeEnabled,               jsonConfig, CN_merge);
+    setFromJSON (MulticastEnabled,           jsonConfig, CN_multicast);
+    UniverseLoss.SetConfig (jsonConfig);
 
-    if ((OldPortId != PortId) && (ESPAsyncE131Initialized))
+    if ((OldPortId != PortId) && (E131Initialized))
     {
         // ask for a reboot. 
         reboot = true;
@@ -275,6 +1115,19 @@ bool c_InputE131::SetConfig (ArduinoJson::JsonObject& jsonConfig)
 
     validateConfiguration ();
 
+    if (E131Initialized)
+    {
+        // follow the new universe range without a reboot
+        if (MulticastEnabled)
+        {
+            JoinMulticastGroups ();
+        }
+        else
+        {
+            LeaveMulticastGroups ();
+        }
+    }
+
     // Update the config fields in case the validator changed them
     GetConfig (jsonConfig);
 
@@ -323,7 +1176,7 @@ void c_InputE131::validateConfiguration ()
 
     // Find the last universe we should listen for
      // DEBUG_V ("");
-    uint16_t span = FirstUniverseChannelOffset + InputDataBufferSize - 1;
+    uint32_t span = FirstUniverseChannelOffset + PendingBufferSize - 1;
     if (span % ChannelsPerUniverse)
     {
         LastUniverse = startUniverse + span / ChannelsPerUniverse;
@@ -355,32 +1208,27 @@ void c_InputE131::NetworkStateChanged (bool IsConnected, bool ReBootAllowed)
     if (IsConnected)
     {
         // Get on with business
-        if (e131->begin (e131_listen_t::E131_MULTICAST, PortId, startUniverse, LastUniverse - startUniverse + 1))
-        {
-            // logcon (String (F ("Multicast enabled")));
-        }
-        else
-        {
-            logcon (String (CN_stars) + F (" E1.31 MULTICAST INIT FAILED ") + CN_stars);
-        }
-
-        // DEBUG_V ("");
-
-        if (e131->begin (e131_listen_t::E131_UNICAST, PortId, startUniverse, LastUniverse - startUniverse + 1))
+        // A single socket bound to the port receives both unicast and the joined multicast groups
+        if (udp->listen (PortId))
         {
-            // logcon (String (F ("Listening on port ")) + PortId);
+            udp->onPacket ([this] (AsyncUDPPacket & Packet) { UdpRxTask.Enqueue (&E131RxHandler, this, Packet); });
+            if (MulticastEnabled)
+            {
+                JoinMulticastGroups ();
+            }
         }
         else
         {
-            logcon (CN_stars + String (F (" E1.31 UNICAST INIT FAILED ")) + CN_stars);
+            logcon (String (CN_stars) + F (" E1.31 UDP INIT FAILED ") + CN_stars);
         }
 
         logcon (String (F ("Listening for ")) + InputDataBufferSize +
                         F (" channels from Universe ") + startUniverse +
                         F (" to ") + LastUniverse + 
-                        F (" on port ") + PortId);
+                        F (" on port ") + PortId +
+                        (MulticastEnabled ? F (" (unicast and multicast)") : F (" (unicast only)")));
 
-        ESPAsyncE131Initialized = true;
+        E131Initialized = true;
     }
     else if (ReBootAllowed)
     {
@@ -394,3 +1242,117 @@ void c_InputE131::NetworkStateChanged (bool IsConnected, bool ReBootAllowed)
     // DEBUG_END;
 
 } // NetworkStateChanged
+
+//-----------------------------------------------------------------------------
+void c_InputE131::JoinMulticastGroups ()
+{
+    // DEBUG_START;
+
+    // drop any groups left over from a previous configuration
+    LeaveMulticastGroups ();
+
+    for (uint32_t UniverseId = startUniverse; UniverseId <= LastUniverse; ++UniverseId)
+    {
+        if (ERR_OK != E131MulticastGroup (UniverseId, true))
+        {
+            logcon (String (CN_stars) + F (" E1.31 MULTICAST JOIN FAILED FOR UNIVERSE ") + String (UniverseId) + " " + CN_stars);
+        }
+    }
+
+    MulticastFirstUniverse = startUniverse;
+    MulticastLastUniverse  = LastUniverse;
+
+    // sources announce the universes they send on the discovery universe
+    DiscoveryJoined = (ERR_OK == E131MulticastGroup (E131_DISCOVERY_UNIVERSE, true));
+
+    // the sync group is joined again by the next UpdateSyncGroup ()
+
+    // DEBUG_END;
+
+} // JoinMulticastGroups
+
+//-----------------------------------------------------------------------------
+void c_InputE131::LeaveMulticastGroups ()
+{
+    // DEBUG_START;
+
+    if (0 != MulticastFirstUniverse)
+    {
+        for (uint32_t UniverseId = MulticastFirstUniverse; UniverseId <= MulticastLastUniverse; ++UniverseId)
+        {
+            E131MulticastGroup (UniverseId, false);
+        }
+
+        MulticastFirstUniverse = 0;
+        MulticastLastUniverse  = 0;
+    }
+
+    if (DiscoveryJoined)
+    {
+        E131MulticastGroup (E131_DISCOVERY_UNIVERSE, false);
+        DiscoveryJoined = false;
+    }
+
+    LeaveSyncGroup ();
+
+    // DEBUG_END;
+
+} // LeaveMulticastGroups
+
+//-----------------------------------------------------------------------------
+/*
+    Sync packets are sent to the multicast group of the sync address, which
+    is usually not one of our data universes. Follow the address the data
+    packets carry. Called from Process () and not the receive task because
+    a join waits on the lwIP core. lwIP counts joins, so a sync address that
+    is also one of our data universes is safe to join and leave.
+*/
+void c_InputE131::UpdateSyncGroup ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        uint16_t SyncAddress = (0 != MulticastFirstUniverse) ? ActiveSyncAddress : 0;
+        if (SyncAddress == MulticastSyncAddress)
+        {
+            // nothing changed
+            break;
+        }
+
+        LeaveSyncGroup ();
+        MulticastSyncAddress = SyncAddress;
+
+        if (0 == SyncAddress)
+        {
+            break;
+        }
+
+        SyncGroupJoined = (ERR_OK == E131MulticastGroup (SyncAddress, true));
+        if (!SyncGroupJoined)
+        {
+            logcon (String (CN_stars) + F (" E1.31 MULTICAST JOIN FAILED FOR SYNC ADDRESS ") + String (SyncAddress) + " " + CN_stars);
+        }
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // UpdateSyncGroup
+
+//-----------------------------------------------------------------------------
+void c_InputE131::LeaveSyncGroup ()
+{
+    // DEBUG_START;
+
+    if (SyncGroupJoined)
+    {
+        E131MulticastGroup (MulticastSyncAddress, false);
+        SyncGroupJoined = false;
+    }
+
+    MulticastSyncAddress = 0;
+
+    // DEBUG_END;
+
+} // LeaveSyncGroup
@@ -1,6 +1,6 @@
 #pragma once
 /*
-* E131Input.h - Code to wrap ESPAsyncE131 for input
+* E131Input.h - Code to receive E1.31 directly from AsyncUDP for input
 *
 * Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
 * Copyright (c) 2021 Shelby Merrick
@@ -19,50 +19,172 @@
 */
 
 #include "InputCommon.hpp"
-#include <ESPAsyncE131.h>
+#include "../network/UdpRxTask.hpp"
+#include "InputPacketDecode.hpp"
+#include "UniverseLoss.hpp"
+
+#ifdef ESP32
+#   include <WiFi.h>
+#   include <AsyncUDP.h>
+#elif defined (ESP8266)
+#   include <ESPAsyncUDP.h>
+#   include <ESP8266WiFi.h>
+#else
+#   error Platform not supported
+#endif
 
 class c_InputE131 : public c_InputCommon 
 {
   private:
     static const uint16_t   UNIVERSE_MAX = 512;
     static const char       ConfigFileName[];
-    static const uint8_t    MAX_NUM_UNIVERSES = 10;
 
-    ESPAsyncE131  * e131 = nullptr; ///< ESPAsyncE131
-    // e131_packet_t packet;           ///< Packet buffer for parsing
+#define E131_DEFAULT_PORT               5568
+#define E131_OPTIONS_PREVIEW_DATA       0x80
+#define E131_OPTIONS_STREAM_TERMINATED  0x40
+#define E131_SYNC_TIMEOUT_MS            2500    // E131_NETWORK_DATA_LOSS_TIMEOUT
+#define E131_SOURCE_LOSS_TIMEOUT_MS     2500    // E131_NETWORK_DATA_LOSS_TIMEOUT
+#define E131_MAX_SOURCES                4       // senders tracked at the same time. One bit each in ActiveSources
+#define E131_NO_SOURCE                  0xff
+#define E131_MAX_DISCOVERED             4       // sources remembered from universe discovery
+#define E131_DISCOVERY_TIMEOUT_MS       30000   // three missed E131_UNIVERSE_DISCOVERY_INTERVALs
+#define E131_DISCOVERY_NAME_SIZE        32      // part of the source name that is kept
+
+    typedef struct
+    {
+        uint32_t  num_packets;
+        uint32_t  packet_errors;
+        uint32_t  sync_packets;
+        uint32_t  source_changes;   ///< A different source took over a universe
+        uint32_t  preempted;        ///< Packets dropped because a higher priority source is active
+        uint32_t  unknown_source;   ///< Packets dropped because the source table was full
+        uint32_t  merge_overflow;   ///< Merges output unmerged because there were no merge buffers
+        uint32_t  unicast_packets;
+        uint32_t  multicast_packets;
+        uint32_t  discovery_packets;
+        IPAddress last_clientIP;
+    } E131_stats_t;
+
+    typedef struct
+    {
+        uint8_t   cid[E131_CID_SIZE];
+        uint32_t  LastSeen;         ///< millis () of the last packet from this source
+        bool      InUse;
+    } E131_source_t;
+
+    typedef struct
+    {
+        uint8_t   cid[E131_CID_SIZE];
+        char      Name[E131_DISCOVERY_NAME_SIZE];
+        IPAddress RemoteIP;
+        uint32_t  LastSeen;         ///< millis () of the last discovery packet
+        uint16_t  Offered;          ///< How many of our universes the source sends
+        uint16_t  OfferedPending;   ///< Count for the pages seen so far
+        bool      InUse;
+    } E131_discovered_t;
+
+    /// Last data from one source on one universe. Slot UniverseIndex * E131_MAX_SOURCES + SourceIndex
+    typedef struct
+    {
+        bool      InUse;
+        uint8_t   Data[UNIVERSE_MAX];
+    } E131_merge_slot_t;
+
+    enum SourceAction_t
+    {
+        SourceAction_Copy = 0,      ///< Use the data as is
+        SourceAction_Merge,         ///< HTP merge with the other sources at the same priority
+        SourceAction_Drop,          ///< Another source owns the universe
+    };
+
+    AsyncUDP      * udp = nullptr;  ///< Socket used for both unicast and multicast reception
+    E131_stats_t    stats;          ///< Statistics tracker
 
     /// JSON configuration parameters
     uint16_t    startUniverse              = 1;    ///< Universe to listen for
     uint16_t    LastUniverse               = 1;    ///< Last Universe to listen for
-    uint16_t    ChannelsPerUniverse        = 512;  ///< Universe boundary limit
-    uint16_t    FirstUniverseChannelOffset = 1;    ///< Channel to start listening at - 1 based
-    ESPAsyncE131PortId PortId              = E131_DEFAULT_PORT;
-    bool        ESPAsyncE131Initialized    = false;
+    uint32_t    ChannelsPerUniverse        = 512;  ///< Universe boundary limit
+    uint32_t    FirstUniverseChannelOffset = 1;    ///< Channel to start listening at - 1 based
+    uint16_t    PortId                     = E131_DEFAULT_PORT;
+    bool        E131Initialized            = false;
+    uint16_t    MulticastFirstUniverse     = 0;    ///< First multicast group we have joined
+    uint16_t    MulticastLastUniverse      = 0;    ///< Last multicast group we have joined
+    bool        MulticastEnabled           = true; ///< Join the multicast groups. Unicast is always received
+    bool        DiscoveryJoined            = false;
+    uint16_t    MulticastSyncAddress       = 0;    ///< Sync address the sync group was last set up for
+    bool        SyncGroupJoined            = false; ///< The multicast group for MulticastSyncAddress is joined
+    bool        MergeEnabled               = false; ///< HTP merge sources that send at the same priority
+    c_UniverseLoss UniverseLoss;                       ///< What to do when a universe goes quiet
+
+    /// Universe synchronization. Data tagged with a sync address is held in
+    /// SyncBuffer and latched into the input buffer when the sync packet
+    /// arrives. Only the universes that received tagged data are latched.
+    uint8_t   * SyncBuffer          = nullptr; ///< Back buffer. Same layout as InputDataBuffer
+    uint32_t    SyncBufferSize      = 0;
+    bool        SyncBufferAllocFailed = false;
+    uint16_t    ActiveSyncAddress   = 0;       ///< Sync address carried by the most recent data packet
+    bool        SyncActive          = false;   ///< Sync packets are arriving for ActiveSyncAddress
+    uint32_t    LastSyncTime        = 0;       ///< millis () of the last sync packet
+
+    /// Senders. A universe remembers which of these are sending to it.
+    E131_source_t       Sources[E131_MAX_SOURCES];
+    uint8_t             LastSourceIndex  = 0;        ///< Most recent match. Checked first.
+    E131_discovered_t   Discovered[E131_MAX_DISCOVERED];    ///< Sources that announced themselves
+    E131_merge_slot_t * MergeSlots       = nullptr;  ///< Allocated with UniverseArray when merging is enabled
+    uint32_t            MergeSlotCount   = 0;        ///< UniverseArraySize * E131_MAX_SOURCES or 0
+    bool                MergeOverflowLogged = false;
 
     /// from sketch globals
-    uint16_t    channel_count = 0;       ///< Number of channels. Derived from output module configuration.
+    uint32_t    channel_count = 0;       ///< Number of channels. Derived from output module configuration.
 
     typedef struct 
     {
         uint8_t  * Destination;
-        uint16_t   BytesToCopy;
-        uint16_t   SourceDataOffset;
+        uint32_t   BytesToCopy;
+        uint32_t   SourceDataOffset;
         uint32_t   SequenceErrorCounter;
         uint8_t    SequenceNumber;
+        uint8_t    Owner;                               ///< Source being output. E131_NO_SOURCE if none
+        uint8_t    ActiveSources;                       ///< Bit per source index sending to this universe
+        uint8_t    ActivePriority;                      ///< Highest priority among ActiveSources
+        uint8_t    SourcePriority[E131_MAX_SOURCES];
+        uint32_t   SourceLastSeen[E131_MAX_SOURCES];
+        bool       SyncPending;                         ///< SyncBuffer holds data for this universe waiting for the sync packet
+        c_UniverseLoss::UniverseLoss_t Loss;
 
     } Universe_t;
-    Universe_t UniverseArray[MAX_NUM_UNIVERSES];
+
+    /// Buffer handed to SetBufferInfo (). The universe table is built for it
+    /// and it becomes InputDataBuffer when the table is swapped in.
+    uint8_t    * PendingBuffer     = nullptr;
+    uint32_t     PendingBufferSize = 0;
+    Universe_t * UniverseArray     = nullptr; ///< One entry per universe from startUniverse to LastUniverse
+    uint32_t     UniverseArraySize = 0;       ///< Number of entries in UniverseArray
 
     void validateConfiguration ();
     void NetworkStateChanged (bool IsConnected, bool RebootAllowed); // used by poorly designed rx functions
     void SetBufferTranslation ();
+    void JoinMulticastGroups ();
+    void LeaveMulticastGroups ();
+    void UpdateSyncGroup ();
+    void LeaveSyncGroup ();
+    void ProcessIncomingE131Sync (uint16_t SyncAddress, uint32_t ArrivalUS);
+    void ProcessIncomingE131Discovery (E131DiscoveryFrame_t & Frame, IPAddress RemoteIP);
+    void StopSync ();
+    void LatchSyncBuffer ();
+    uint8_t        FindSource         (const uint8_t * cid, uint32_t now);
+    SourceAction_t SelectSource       (uint32_t UniverseIndex, uint8_t SourceIndex, uint8_t Priority, uint32_t now);
+    void           ExpireSources      (uint32_t UniverseIndex, uint32_t now);
+    void           RemoveSource       (uint32_t UniverseIndex, uint8_t SourceIndex);
+    bool           MergeUniverse      (uint32_t UniverseIndex, uint8_t SourceIndex, const uint8_t * Data, uint32_t DataLength, uint8_t * Destination);
+    void           ReleaseMergeSlots  (uint32_t UniverseIndex, uint8_t SourceIndex);
 
   public:
 
     c_InputE131 (c_InputMgr::e_InputChannelIds NewInputChannelId,
                  c_InputMgr::e_InputType       NewChannelType,
                  uint8_t                     * BufferStart,
-                 uint16_t                      BufferSize);
+                 uint32_t                      BufferSize);
     ~c_InputE131();
 
     // functions to be provided by the derived class
@@ -72,8 +194,9 @@ class c_InputE131 : public c_InputCommon
     void GetStatus (JsonObject & jsonStatus);
     void Process ();                                        ///< Call from loop(),  renders Input data
     void GetDriverName (String & sDriverName) { sDriverName = "E1.31"; } ///< get the name for the instantiated driver
-    void SetBufferInfo (uint8_t * BufferStart, uint16_t BufferSize);
+    void SetBufferInfo (uint8_t * BufferStart, uint32_t BufferSize);
     void NetworkStateChanged (bool IsConnected); // used by poorly designed rx functions
     bool isShutDownRebootNeeded () { return HasBeenInitialized; }
-    void ProcessIncomingE131Data (e131_packet_t *);
+    void ProcessIncomingE131Data (E131DataFrame_t & Frame, uint32_t ArrivalUS);
+    void ProcessReceivedUdpPacket (UdpRxPacket_t & Packet);   ///< Called by the UDP receive task
 };
@@ -44,7 +44,7 @@ static const c_InputEffectEngine::EffectDescriptor_t ListOfEffects[] =
 c_InputEffectEngine::c_InputEffectEngine (c_InputMgr::e_InputChannelIds NewInputChannelId,
     c_InputMgr::e_InputType       NewChannelType,
     uint8_t                     * BufferStart,
-    uint16_t                      BufferSize) :
+    uint32_t                      BufferSize) :
     c_InputCommon (NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 {
     // DEBUG_START;
@@ -248,7 +248,7 @@ void c_InputEffectEngine::Process ()
 } // process
 
 //-----------------------------------------------------------------------------
-void c_InputEffectEngine::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputEffectEngine::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
@@ -26,7 +26,7 @@ public:
     c_InputEffectEngine (c_InputMgr::e_InputChannelIds NewInputChannelId,
                          c_InputMgr::e_InputType       NewChannelType,
                          uint8_t                     * BufferStart,
-                         uint16_t                      BufferSize);
+                         uint32_t                      BufferSize);
     ~c_InputEffectEngine ();
 
     c_InputEffectEngine ();
@@ -88,7 +88,7 @@ public:
     void GetStatus (JsonObject& jsonStatus);
     void Process ();                           ///< Call from loop(),  renders Input data
     void GetDriverName (String  & sDriverName) { sDriverName = "Effects"; } ///< get the name for the instantiated driver
-    void SetBufferInfo (uint8_t * BufferStart, uint16_t BufferSize);
+    void SetBufferInfo (uint8_t * BufferStart, uint32_t BufferSize);
     void NextEffect ();
 
     // Effect functions
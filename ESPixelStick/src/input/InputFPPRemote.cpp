@@ -33,7 +33,7 @@ c_InputFPPRemote::c_InputFPPRemote (
     c_InputMgr::e_InputChannelIds NewInputChannelId,
     c_InputMgr::e_InputType       NewChannelType,
     uint8_t* BufferStart,
-    uint16_t                      BufferSize) :
+    uint32_t                      BufferSize) :
     c_InputCommon (NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 {
     // DEBUG_START;
@@ -145,7 +145,7 @@ void c_InputFPPRemote::Process ()
 } // process
 
 //-----------------------------------------------------------------------------
-void c_InputFPPRemote::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputFPPRemote::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     InputDataBuffer = BufferStart;
     InputDataBufferSize = BufferSize;
@@ -167,7 +167,7 @@ bool c_InputFPPRemote::SetConfig (JsonObject& jsonConfig)
 
     // DEBUG_V ("Config Processing");
     // Clear outbuffer on config change
-    memset (OutputMgr.GetBufferAddress (), 0x0, OutputMgr.GetBufferUsedSize ());
+    memset (InputDataBuffer, 0x0, InputDataBufferSize);
     StartPlaying (FileToPlay);
 
     // DEBUG_END;
@@ -31,7 +31,7 @@ class c_InputFPPRemote : public c_InputCommon
           c_InputMgr::e_InputChannelIds NewInputChannelId,
           c_InputMgr::e_InputType       NewChannelType,
           uint8_t                     * BufferStart,
-          uint16_t                      BufferSize);
+          uint32_t                      BufferSize);
       
       ~c_InputFPPRemote ();
 
@@ -42,7 +42,7 @@ class c_InputFPPRemote : public c_InputCommon
       void GetStatus (JsonObject& jsonStatus);
       void Process ();                         ///< Call from loop(),  renders Input data
       void GetDriverName (String& sDriverName) { sDriverName = "FPP Remote"; } ///< get the name for the instantiated driver
-      void SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize);
+      void SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize);
 
 protected:
     c_InputFPPRemotePlayItem * pInputFPPRemotePlayItem = nullptr;
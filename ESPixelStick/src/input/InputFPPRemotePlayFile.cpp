@@ -55,6 +55,21 @@ static void TimerPollHandlerTask (void* pvParameters)
     // DEBUG_END;
 
 } // TimerPollHandlerTask
+
+//----------------------------------------------------------------------------
+static void PrefetchTask (void* pvParameters)
+{
+    c_InputFPPRemotePlayFile* InputFpp = reinterpret_cast <c_InputFPPRemotePlayFile*> (pvParameters);
+
+    do
+    {
+        // sleep until a frame has been used or playback starts
+        ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+        InputFpp->FillPrefetch ();
+
+    } while (true);
+
+} // PrefetchTask
 #endif // def ARDUINO_ARCH_ESP32
 
 //-----------------------------------------------------------------------------
@@ -65,11 +80,16 @@ c_InputFPPRemotePlayFile::c_InputFPPRemotePlayFile (c_InputMgr::e_InputChannelId
 
     fsm_PlayFile_state_Idle_imp.Init (this);
 
-    LastIsrTimeStampMS = millis ();
-    MsTicker.attach_ms (uint32_t (FPP_TICKER_PERIOD_MS), &TimerPollHandler, (void*)this); // Add ISR Function
+#ifdef ARDUINO_ARCH_ESP32
+    TimerPollLock = xSemaphoreCreateMutex ();
+#endif // def ARDUINO_ARCH_ESP32
+
+    StartFrameTimer (FPP_TICKER_PERIOD_MS);
 
 #ifdef ARDUINO_ARCH_ESP32
     xTaskCreate (TimerPollHandlerTask, "FPPTask", TimerPollHandlerTaskStack, this, ESP_TASK_PRIO_MIN + 4, &TimerPollTaskHandle);
+    // below the frame timer so a slow read never delays a frame
+    xTaskCreate (PrefetchTask, "FseqPrefetch", FSEQ_PREFETCH_TASK_STACK, this, ESP_TASK_PRIO_MIN + 3, &PrefetchTaskHandle);
 #endif // def ARDUINO_ARCH_ESP32
 
     // DEBUG_END;
@@ -79,13 +99,16 @@ c_InputFPPRemotePlayFile::c_InputFPPRemotePlayFile (c_InputMgr::e_InputChannelId
 c_InputFPPRemotePlayFile::~c_InputFPPRemotePlayFile ()
 {
     // DEBUG_START;
-    MsTicker.detach ();
+    StopFrameTimer ();
 
 #ifdef ARDUINO_ARCH_ESP32
     if (NULL != TimerPollTaskHandle)
     {
+        // do not delete the task in the middle of a tick
+        LockTimerPoll ();
         vTaskDelete (TimerPollTaskHandle);
         TimerPollTaskHandle = NULL;
+        UnlockTimerPoll ();
     }
 #endif // def ARDUINO_ARCH_ESP32
 
@@ -94,6 +117,25 @@ c_InputFPPRemotePlayFile::~c_InputFPPRemotePlayFile ()
         Stop ();
         Poll (nullptr, 0);
     }
+
+    StopPrefetch ();
+
+    // stopping restarts the idle ticks
+    StopFrameTimer ();
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (NULL != PrefetchTaskHandle)
+    {
+        vTaskDelete (PrefetchTaskHandle);
+        PrefetchTaskHandle = NULL;
+    }
+
+    if (NULL != TimerPollLock)
+    {
+        vSemaphoreDelete (TimerPollLock);
+        TimerPollLock = NULL;
+    }
+#endif // def ARDUINO_ARCH_ESP32
     // DEBUG_END;
 
 } // ~c_InputFPPRemotePlayFile
@@ -164,17 +206,277 @@ void c_InputFPPRemotePlayFile::TimerPoll ()
 {
     // xDEBUG_START;
 
+    LockTimerPoll ();
+
     // Are polls still coming in?
-    if (PollDetectionCounter < PollDetectionCounterLimit)
+    if (PollDetectionCounter < int (FPP_POLL_DETECTION_MS / FrameTimerPeriodMS))
     {
         PollDetectionCounter++;
         UpdateElapsedPlayTimeMS ();
         pCurrentFsmState->TimerPoll ();
     }
+
+    UnlockTimerPoll ();
+
     // xDEBUG_END;
 
 } // TimerPoll
 
+//-----------------------------------------------------------------------------
+/*
+    Set up the read ahead ring for the file that was just parsed. Each slot
+    holds exactly what TimerPoll puts in the output buffer.
+*/
+void c_InputFPPRemotePlayFile::StartPrefetch ()
+{
+    // DEBUG_START;
+
+    StopPrefetch ();
+
+    do // once
+    {
+        uint32_t SlotSize = min (uint32_t (BufferSize), FrameOutputLength);
+        if (0 == SlotSize)
+        {
+            break;
+        }
+
+        uint32_t NumSlots = FSEQ_PREFETCH_BYTES / SlotSize;
+        NumSlots = max (NumSlots, uint32_t (FSEQ_PREFETCH_MIN_FRAMES));
+        NumSlots = min (NumSlots, uint32_t (FSEQ_PREFETCH_MAX_FRAMES));
+
+        Prefetch.Ring = (uint8_t *)malloc (NumSlots * SlotSize);
+        if (nullptr == Prefetch.Ring)
+        {
+            logcon (String (F ("WARNING: Not enough memory to read ahead. Frames will be read as they are played.")));
+            break;
+        }
+
+        // a plain file that fills the buffer can be read several frames at a time
+        Prefetch.Contiguous = !BlockReader.IsOpen () &&
+                              (1 == NumFrameSegments) &&
+                              (0 == FrameSegments[0].BufferOffset) &&
+                              (SlotSize == FrameControl.ChannelsPerFrame) &&
+                              (FrameSegments[0].Length == FrameControl.ChannelsPerFrame);
+
+        Prefetch.SlotSize        = SlotSize;
+        Prefetch.NumSlots        = NumSlots;
+        Prefetch.Head            = 0;
+        Prefetch.Tail            = 0;
+        Prefetch.NextFrame       = 0;
+        Prefetch.ResyncRequested = false;
+        Prefetch.ReadFailed      = false;
+        Prefetch.Hits            = 0;
+        Prefetch.Misses          = 0;
+        Prefetch.Reads           = 0;
+        Prefetch.Active          = true;
+
+        KickPrefetch ();
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // StartPrefetch
+
+//-----------------------------------------------------------------------------
+void c_InputFPPRemotePlayFile::StopPrefetch ()
+{
+    // DEBUG_START;
+
+    Prefetch.Active = false;
+
+#ifdef ARDUINO_ARCH_ESP32
+    // wait for a read that is in progress to finish
+    while (Prefetch.Busy)
+    {
+        vTaskDelay (1);
+    }
+#endif // def ARDUINO_ARCH_ESP32
+
+    // no new ticks. The caller restarts the timer when it is ready.
+    StopFrameTimer ();
+
+    // wait for a tick that may still be taking a frame from the ring
+    LockTimerPoll ();
+
+    uint8_t * OldRing = Prefetch.Ring;
+    Prefetch.Ring     = nullptr;
+    Prefetch.NumSlots = 0;
+    Prefetch.Head     = 0;
+    Prefetch.Tail     = 0;
+
+    UnlockTimerPoll ();
+
+    if (nullptr != OldRing)
+    {
+        free (OldRing);
+    }
+
+    // DEBUG_END;
+
+} // StopPrefetch
+
+//-----------------------------------------------------------------------------
+void c_InputFPPRemotePlayFile::KickPrefetch ()
+{
+#ifdef ARDUINO_ARCH_ESP32
+    if (NULL != PrefetchTaskHandle)
+    {
+        xTaskNotifyGive (PrefetchTaskHandle);
+    }
+#else
+    FillPrefetch ();
+#endif // def ARDUINO_ARCH_ESP32
+
+} // KickPrefetch
+
+//-----------------------------------------------------------------------------
+/*
+    Fill the free slots with the next frames. The SD card is only ever
+    touched from here while a file is playing.
+*/
+void c_InputFPPRemotePlayFile::FillPrefetch ()
+{
+    // xDEBUG_START;
+
+    Prefetch.Busy = true;
+
+    do // once
+    {
+        if (!Prefetch.Active)
+        {
+            break;
+        }
+
+        if (Prefetch.ResyncRequested)
+        {
+            Prefetch.NextFrame       = Prefetch.ResyncFrame;
+            Prefetch.ResyncRequested = false;
+        }
+
+        while (Prefetch.Active &&
+               !Prefetch.ResyncRequested &&
+               ((Prefetch.Head - Prefetch.Tail) < Prefetch.NumSlots) &&
+               (Prefetch.NextFrame < FrameControl.TotalNumberOfFramesInSequence))
+        {
+            uint32_t  Slot          = Prefetch.Head % Prefetch.NumSlots;
+            uint8_t * Destination   = &Prefetch.Ring[Slot * Prefetch.SlotSize];
+            uint32_t  FramesToRead  = 1;
+            bool      ReadSucceeded = false;
+
+            if (Prefetch.Contiguous)
+            {
+                // as many frames as fit before the ring wraps
+                FramesToRead = Prefetch.NumSlots - (Prefetch.Head - Prefetch.Tail);
+                FramesToRead = min (FramesToRead, Prefetch.NumSlots - Slot);
+                FramesToRead = min (FramesToRead, FrameControl.TotalNumberOfFramesInSequence - Prefetch.NextFrame);
+
+                size_t BytesToRead = FramesToRead * Prefetch.SlotSize;
+                ReadSucceeded = (BytesToRead == ReadFrameData (Prefetch.NextFrame, 0, Destination, BytesToRead));
+            }
+            else
+            {
+                ReadSucceeded = ReadFrame (Prefetch.NextFrame, Destination, Prefetch.SlotSize);
+            }
+
+            ++Prefetch.Reads;
+
+            if (!ReadSucceeded)
+            {
+                Prefetch.ReadFailed = true;
+                Prefetch.Active     = false;
+                break;
+            }
+
+            for (uint32_t FrameIndex = 0; FrameIndex < FramesToRead; ++FrameIndex)
+            {
+                Prefetch.SlotFrameId[Slot + FrameIndex] = Prefetch.NextFrame + FrameIndex;
+            }
+
+            // publish the frames
+            Prefetch.NextFrame += FramesToRead;
+            Prefetch.Head      += FramesToRead;
+        }
+
+        // Read the file into the cache a chunk at a time once the ring is
+        // topped up. Frames come from the SD card until all of it is in.
+        if (Prefetch.Active && (nullptr == CachedFile) && (FSEQ_CACHE_NO_HANDLE != CachedFileHandle))
+        {
+            if (FseqCache.LoadChunk (CachedFileHandle, FileHandleForFileBeingPlayed))
+            {
+                CachedFile = FseqCache.GetData (CachedFileHandle);
+            }
+        }
+
+    } while (false);
+
+    Prefetch.Busy = false;
+
+    // xDEBUG_END;
+
+} // FillPrefetch
+
+//-----------------------------------------------------------------------------
+/*
+    Called from TimerPoll. Copy the frame to the output if it has been
+    read. Otherwise the output keeps the last frame and the reader is
+    pointed at the frame that is needed.
+*/
+bool c_InputFPPRemotePlayFile::TakePrefetchedFrame (uint32_t FrameId)
+{
+    bool Response = false;
+
+    do // once
+    {
+        if (nullptr == Prefetch.Ring)
+        {
+            break;
+        }
+
+        // drop frames that were skipped
+        while ((Prefetch.Tail != Prefetch.Head) && (Prefetch.SlotFrameId[Prefetch.Tail % Prefetch.NumSlots] < FrameId))
+        {
+            ++Prefetch.Tail;
+        }
+
+        if ((Prefetch.Tail != Prefetch.Head) && (Prefetch.SlotFrameId[Prefetch.Tail % Prefetch.NumSlots] == FrameId))
+        {
+            uint32_t Slot = Prefetch.Tail % Prefetch.NumSlots;
+            memcpy (Buffer, &Prefetch.Ring[Slot * Prefetch.SlotSize], min (size_t (Prefetch.SlotSize), BufferSize));
+            ++Prefetch.Tail;
+            ++Prefetch.Hits;
+            Response = true;
+            break;
+        }
+
+        ++Prefetch.Misses;
+
+        // the reader will get there on its own unless playback jumped
+        bool Jumped = (Prefetch.Tail != Prefetch.Head) ||
+                      (Prefetch.NextFrame > FrameId) ||
+                      ((FrameId - Prefetch.NextFrame) >= Prefetch.NumSlots);
+        if (Jumped)
+        {
+            Prefetch.Tail            = Prefetch.Head;
+            Prefetch.ResyncFrame     = FrameId;
+            Prefetch.ResyncRequested = true;
+        }
+
+    } while (false);
+
+#ifdef ARDUINO_ARCH_ESP32
+    // there is room in the ring now
+    if (NULL != PrefetchTaskHandle)
+    {
+        xTaskNotifyGive (PrefetchTaskHandle);
+    }
+#endif // def ARDUINO_ARCH_ESP32
+
+    return Response;
+
+} // TakePrefetchedFrame
+
 //-----------------------------------------------------------------------------
 void c_InputFPPRemotePlayFile::GetStatus (JsonObject& JsonStatus)
 {
@@ -215,25 +517,112 @@ void c_InputFPPRemotePlayFile::GetStatus (JsonObject& JsonStatus)
 
     JsonStatus[CN_errors] = LastFailedPlayStatusMsg;
 
+    if (BlockReader.IsOpen ())
+    {
+        BlockReader.GetStatus (JsonStatus);
+    }
+
+    FseqCache.GetStatus (JsonStatus);
+    FseqIndex.GetStatus (JsonStatus);
+
+    JsonObject PrefetchStatus = JsonStatus.createNestedObject (F ("prefetch"));
+    PrefetchStatus[F ("frames")] = Prefetch.NumSlots;
+    PrefetchStatus[F ("hits")]   = Prefetch.Hits;
+    PrefetchStatus[F ("misses")] = Prefetch.Misses;
+    PrefetchStatus[F ("reads")]  = Prefetch.Reads;
+
     // xDEBUG_END;
 
 } // GetStatus
 
 //-----------------------------------------------------------------------------
-void c_InputFPPRemotePlayFile::UpdateElapsedPlayTimeMS ()
+/*
+    Runs TimerPoll every PeriodMS. Restarting the timer also restarts the
+    play clock so the ticks line up with the start of the sequence.
+
+    On the ESP32 this is an esp_timer, which has microsecond resolution
+    and does not drift the way a millisecond Ticker does at short periods.
+*/
+void c_InputFPPRemotePlayFile::StartFrameTimer (uint32_t PeriodMS)
 {
+    // DEBUG_START;
+
+    FrameTimerPeriodMS = max (PeriodMS, uint32_t (1));
+
     noInterrupts ();
+    LastIsrTimeStampUS = micros ();
+    ElapsedUSCarry = 0;
+    interrupts ();
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (nullptr == FrameTimer)
+    {
+        esp_timer_create_args_t TimerArgs;
+        memset ((void*)&TimerArgs, 0x00, sizeof (TimerArgs));
+        TimerArgs.callback = &TimerPollHandler;
+        TimerArgs.arg      = (void*)this;
+        TimerArgs.name     = "FppFrameTimer";
 
-    uint32_t now = millis ();
-    uint32_t elapsedMS = now - LastIsrTimeStampMS;
-    if (now < LastIsrTimeStampMS)
+        if (ESP_OK != esp_timer_create (&TimerArgs, &FrameTimer))
+        {
+            logcon (String (F ("Could not create the frame timer")));
+            FrameTimer = nullptr;
+        }
+    }
+    else
     {
-        // handle wrap
-        elapsedMS = (0 - LastIsrTimeStampMS) + now;
+        esp_timer_stop (FrameTimer);
     }
 
-    LastIsrTimeStampMS = now;
-    FrameControl.ElapsedPlayTimeMS += elapsedMS;
+    if (nullptr != FrameTimer)
+    {
+        esp_timer_start_periodic (FrameTimer, uint64_t (FrameTimerPeriodMS) * 1000);
+    }
+#else
+    MsTicker.detach ();
+    MsTicker.attach_ms (FrameTimerPeriodMS, &TimerPollHandler, (void*)this); // Add ISR Function
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // StartFrameTimer
+
+//-----------------------------------------------------------------------------
+void c_InputFPPRemotePlayFile::StopFrameTimer ()
+{
+    // DEBUG_START;
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (nullptr != FrameTimer)
+    {
+        esp_timer_stop (FrameTimer);
+        esp_timer_delete (FrameTimer);
+        FrameTimer = nullptr;
+    }
+#else
+    MsTicker.detach ();
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // StopFrameTimer
+
+//-----------------------------------------------------------------------------
+/*
+    Kept in microseconds so a short step time does not lose a fraction of
+    a ms on every tick. The remainder is carried into the next update.
+*/
+void c_InputFPPRemotePlayFile::UpdateElapsedPlayTimeMS ()
+{
+    noInterrupts ();
+
+    uint32_t now = micros ();
+    // unsigned math takes care of micros () wrapping
+    uint32_t ElapsedUS = (now - LastIsrTimeStampUS) + ElapsedUSCarry;
+
+    LastIsrTimeStampUS = now;
+    FrameControl.ElapsedPlayTimeMS += ElapsedUS / 1000;
+    ElapsedUSCarry = ElapsedUS % 1000;
 
     interrupts ();
 } // UpdateElapsedPlayTimeMS
@@ -276,6 +665,9 @@ bool c_InputFPPRemotePlayFile::ParseFseqFile ()
         FSEQRawHeader    fsqRawHeader;
         FSEQParsedHeader fsqParsedHeader;
 
+        BlockReader.Close ();
+        ReleaseCachedFile ();
+
         FileHandleForFileBeingPlayed = -1;
         if (false == FileMgr.OpenSdFile (PlayItemName,
                                          c_FileMgr::FileMode::FileRead,
@@ -287,9 +679,10 @@ bool c_InputFPPRemotePlayFile::ParseFseqFile ()
         }
 
         // DEBUG_V (String ("FileHandleForFileBeingPlayed: ") + String (FileHandleForFileBeingPlayed));
-        size_t BytesRead = FileMgr.ReadSdFile (FileHandleForFileBeingPlayed,
-                                               (uint8_t*)&fsqRawHeader,
-                                               sizeof (fsqRawHeader), 0);
+        size_t BytesRead = FseqIndex.ReadHeader (PlayItemName,
+                                                 FileHandleForFileBeingPlayed,
+                                                 (uint8_t*)&fsqRawHeader,
+                                                 sizeof (fsqRawHeader), 0);
         // DEBUG_V (String ("                    BytesRead: ") + String (BytesRead));
         // DEBUG_V (String ("        sizeof (fsqRawHeader): ") + String (sizeof (fsqRawHeader)));
 
@@ -333,117 +726,361 @@ bool c_InputFPPRemotePlayFile::ParseFseqFile ()
         // DEBUG_V (String ("                           id: 0x") + String ((unsigned long)fsqParsedHeader.id, HEX));
 #endif // def DUMP_FSEQ_HEADER
 
-        if (fsqParsedHeader.majorVersion != 2 || fsqParsedHeader.compressionType != 0)
+        if (fsqParsedHeader.majorVersion != 2)
         {
-            LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + F (" is not a v2 uncompressed sequence"));
+            LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + F (" is not a v2 sequence"));
             logcon (LastFailedPlayStatusMsg);
             break;
         }
         // DEBUG_V ("");
 
-        if ((fsqParsedHeader.TotalNumberOfFramesInSequence * fsqParsedHeader.channelCount) > FileMgr.GetSdFileSize (FileHandleForFileBeingPlayed))
+        if (FSEQ_COMPRESSION_NONE != FseqCompressionType (fsqRawHeader))
+        {
+            String ErrorMsg;
+            if (!BlockReader.Open (PlayItemName, FileHandleForFileBeingPlayed, fsqRawHeader, ErrorMsg))
+            {
+                LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + " " + ErrorMsg);
+                logcon (LastFailedPlayStatusMsg);
+                break;
+            }
+        }
+        else if ((fsqParsedHeader.TotalNumberOfFramesInSequence * fsqParsedHeader.channelCount) > FileMgr.GetSdFileSize (FileHandleForFileBeingPlayed))
         {
             LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + F (" File does not contain enough data to meet the Stated Channel Count * Number of Frames value."));
             logcon (LastFailedPlayStatusMsg);
             break;
         }
 
-        FrameControl.FrameStepTimeMS = max ((uint8_t)25, fsqParsedHeader.stepTime);
+        FrameControl.FrameStepTimeMS = max (uint32_t (FPP_MIN_STEP_TIME_MS), uint32_t (fsqParsedHeader.stepTime));
         FrameControl.TotalNumberOfFramesInSequence = fsqParsedHeader.TotalNumberOfFramesInSequence;
 
         FrameControl.DataOffset = fsqParsedHeader.dataOffset;
         FrameControl.ChannelsPerFrame = fsqParsedHeader.channelCount;
 
-        memset ((void*)&SparseRanges, 0x00, sizeof (SparseRanges));
-        if (fsqParsedHeader.numSparseRanges)
+        if (!ParseSparseRanges (fsqRawHeader, fsqParsedHeader.numSparseRanges))
         {
-            if (MAX_NUM_SPARSE_RANGES < fsqParsedHeader.numSparseRanges)
+            break;
+        }
+
+        if (!BlockReader.IsOpen ())
+        {
+            // a file that is not cached yet is read in by FillPrefetch
+            CachedFileSize   = FileMgr.GetSdFileSize (FileHandleForFileBeingPlayed);
+            CachedFileHandle = FseqCache.Acquire (PlayItemName, CachedFileSize);
+            CachedFile       = FseqCache.GetData (CachedFileHandle);
+        }
+
+        PlayedFileCount++;
+        Response = true;
+
+    } while (false);
+
+    // Caller must close the file since it is used to play the channel data.
+
+    // DEBUG_END;
+
+    return Response;
+
+} // ParseFseqFile
+
+//-----------------------------------------------------------------------------
+/*
+    Turn the sparse range table into the list of frame segments ReadFrame
+    uses. A file without ranges, or with a table that does not fit the
+    frame, is played as one segment covering the whole frame.
+
+    Ranges that sit next to each other in the output are merged, so a
+    table that was split up by the sequencer costs nothing at play time.
+*/
+bool c_InputFPPRemotePlayFile::ParseSparseRanges (FSEQRawHeader & fsqRawHeader, uint32_t NumSparseRanges)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+    FSEQRawRangeEntry * FseqRawRanges = nullptr;
+
+    FreeFrameSegments ();
+
+    do // once
+    {
+        FrameSegments = (FrameSegment_t *)malloc (sizeof (FrameSegment_t) * max (NumSparseRanges, uint32_t (1)));
+        if (nullptr == FrameSegments)
+        {
+            LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + F (" Not enough memory for the sparse range table."));
+            logcon (LastFailedPlayStatusMsg);
+            break;
+        }
+
+        if (NumSparseRanges)
+        {
+            FseqRawRanges = (FSEQRawRangeEntry *)malloc (sizeof (FSEQRawRangeEntry) * NumSparseRanges);
+            if (nullptr == FseqRawRanges)
             {
-                LastFailedPlayStatusMsg =  (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + F (" Too many sparse ranges defined in file header."));
+                LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + F (" Not enough memory for the sparse range table."));
                 logcon (LastFailedPlayStatusMsg);
                 break;
             }
 
-            FSEQRawRangeEntry FseqRawRanges[MAX_NUM_SPARSE_RANGES];
+            size_t TableSize = sizeof (FSEQRawRangeEntry) * NumSparseRanges;
+            if (TableSize != FseqIndex.ReadHeader (PlayItemName,
+                                                   FileHandleForFileBeingPlayed,
+                                                   (uint8_t*)FseqRawRanges,
+                                                   TableSize,
+                                                   sizeof (FSEQRawHeader) + FseqNumCompressedBlocks (fsqRawHeader) * sizeof (FSEQRawCompressedBlockEntry)))
+            {
+                LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Could not start. ")) + PlayItemName + F (" Could not read the sparse range table."));
+                logcon (LastFailedPlayStatusMsg);
+                break;
+            }
 
-            FileMgr.ReadSdFile (FileHandleForFileBeingPlayed,
-                                (uint8_t*)&FseqRawRanges[0],
-                                sizeof (FseqRawRanges),
-                                sizeof (FSEQRawHeader) + fsqParsedHeader.numCompressedBlocks * 8);
+            uint32_t LowestStart = 0xffffffff;
+            for (uint32_t RangeIndex = 0; RangeIndex < NumSparseRanges; ++RangeIndex)
+            {
+                LowestStart = min (LowestStart, read24 (FseqRawRanges[RangeIndex].Start));
+            }
 
-            uint32_t SparseRangeIndex = 0;
             uint32_t TotalChannels = 0;
-            uint32_t LargestBlock = 0;
-            for (auto & CurrentSparseRange : SparseRanges)
+            FrameSegmentsInOrder = true;
+
+            for (uint32_t RangeIndex = 0; RangeIndex < NumSparseRanges; ++RangeIndex)
             {
-                // DEBUG_V (String ("           Sparse Range Index: ") + String (SparseRangeIndex));
-                if (SparseRangeIndex >= fsqParsedHeader.numSparseRanges)
+                uint32_t RangeOffset = read24 (FseqRawRanges[RangeIndex].Start) - LowestStart;
+                uint32_t RangeLength = read24 (FseqRawRanges[RangeIndex].Length);
+
+#ifdef DUMP_FSEQ_HEADER
+                // DEBUG_V (String ("           Sparse Range Index: ") + String (RangeIndex));
+                // DEBUG_V (String ("            RangeChannelCount: ") + String (RangeLength));
+                // DEBUG_V (String ("              RangeDataOffset: 0x") + String (RangeOffset, HEX));
+#endif // def DUMP_FSEQ_HEADER
+
+                if (0 == RangeLength)
                 {
-                    // DEBUG_V (String ("No Sparse Range Data for this entry "));
-                    ++SparseRangeIndex;
                     continue;
                 }
 
-                // CurrentSparseRange.DataOffset = read24 (FseqRawRanges[SparseRangeIndex].Start);
-                CurrentSparseRange.DataOffset = TotalChannels;
-                CurrentSparseRange.ChannelCount = read24 (FseqRawRanges[SparseRangeIndex].Length);
-                TotalChannels += CurrentSparseRange.ChannelCount;
-                LargestBlock  = max (LargestBlock, CurrentSparseRange.DataOffset + CurrentSparseRange.ChannelCount);
+                if (NumFrameSegments)
+                {
+                    FrameSegment_t & PreviousSegment = FrameSegments[NumFrameSegments - 1];
+                    uint32_t PreviousEnd = PreviousSegment.BufferOffset + PreviousSegment.Length;
+
+                    if (RangeOffset == PreviousEnd)
+                    {
+                        // continues the previous segment in both the file and the output
+                        PreviousSegment.Length += RangeLength;
+                        TotalChannels += RangeLength;
+                        continue;
+                    }
+
+                    if (RangeOffset < PreviousEnd)
+                    {
+                        // out of order or overlapping. Read each segment on its own
+                        FrameSegmentsInOrder = false;
+                    }
+                }
 
-#ifdef DUMP_FSEQ_HEADER
-                // DEBUG_V (String ("            RangeChannelCount: ") + String (CurrentSparseRange.ChannelCount));
-                // DEBUG_V (String ("              RangeDataOffset: 0x") + String (CurrentSparseRange.DataOffset, HEX));
-#endif // def DUMP_FSEQ_HEADER
+                FrameSegments[NumFrameSegments].FileOffset   = TotalChannels;
+                FrameSegments[NumFrameSegments].BufferOffset = RangeOffset;
+                FrameSegments[NumFrameSegments].Length       = RangeLength;
+                FrameOutputLength = max (FrameOutputLength, RangeOffset + RangeLength);
+                ++NumFrameSegments;
 
-                ++SparseRangeIndex;
+                TotalChannels += RangeLength;
             }
 
 #ifdef DUMP_FSEQ_HEADER
             // DEBUG_V (String ("                TotalChannels: ") + String (TotalChannels));
-            // DEBUG_V (String ("                 LargestBlock: ") + String (LargestBlock));
+            // DEBUG_V (String ("             NumFrameSegments: ") + String (NumFrameSegments));
 #endif // def DUMP_FSEQ_HEADER
+
             if (0 == TotalChannels)
             {
                 LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Ignoring Range Info. ")) + PlayItemName + F (" No channels defined in Sparse Ranges."));
                 logcon (LastFailedPlayStatusMsg);
-                memset ((void*)&SparseRanges, 0x00, sizeof (SparseRanges));
-                SparseRanges[0].ChannelCount = fsqParsedHeader.channelCount;
+                NumFrameSegments = 0;
             }
 
-            else if (TotalChannels > fsqParsedHeader.channelCount)
+            else if (TotalChannels > FrameControl.ChannelsPerFrame)
             {
                 LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Ignoring Range Info. ")) + PlayItemName + F (" Too many channels defined in Sparse Ranges."));
                 logcon (LastFailedPlayStatusMsg);
-                memset ((void*)&SparseRanges, 0x00, sizeof (SparseRanges));
-                SparseRanges[0].ChannelCount = fsqParsedHeader.channelCount;
-            }
-
-            else if (LargestBlock > fsqParsedHeader.channelCount)
-            {
-                LastFailedPlayStatusMsg = (String (F ("ParseFseqFile:: Ignoring Range Info. ")) + PlayItemName + F (" Sparse Range Frame offset + Num channels is larger than frame size."));
-                logcon (LastFailedPlayStatusMsg);
-                memset ((void*)&SparseRanges, 0x00, sizeof (SparseRanges));
-                SparseRanges[0].ChannelCount = fsqParsedHeader.channelCount;
+                NumFrameSegments = 0;
             }
         }
-        else
+
+        if (0 == NumFrameSegments)
         {
-            memset ((void*)&SparseRanges, 0x00, sizeof (SparseRanges));
-            SparseRanges[0].ChannelCount = fsqParsedHeader.channelCount;
+            // the whole frame as it is stored
+            FrameSegments[0].FileOffset   = 0;
+            FrameSegments[0].BufferOffset = 0;
+            FrameSegments[0].Length       = FrameControl.ChannelsPerFrame;
+            NumFrameSegments     = 1;
+            FrameOutputLength    = FrameControl.ChannelsPerFrame;
+            FrameSegmentsInOrder = true;
         }
 
-        PlayedFileCount++;
         Response = true;
 
     } while (false);
 
-    // Caller must close the file since it is used to play the channel data.
+    if (nullptr != FseqRawRanges)
+    {
+        free (FseqRawRanges);
+    }
 
     // DEBUG_END;
 
     return Response;
 
-} // ParseFseqFile
+} // ParseSparseRanges
+
+//-----------------------------------------------------------------------------
+void c_InputFPPRemotePlayFile::FreeFrameSegments ()
+{
+    // DEBUG_START;
+
+    if (nullptr != FrameSegments)
+    {
+        free (FrameSegments);
+        FrameSegments = nullptr;
+    }
+
+    NumFrameSegments     = 0;
+    FrameOutputLength    = 0;
+    FrameSegmentsInOrder = false;
+
+    // DEBUG_END;
+
+} // FreeFrameSegments
+
+//-----------------------------------------------------------------------------
+/*
+    Copy part of a frame to the output. FrameOffset is relative to the
+    start of the frame as it is stored in the file.
+*/
+size_t c_InputFPPRemotePlayFile::ReadFrameData (uint32_t FrameId, uint32_t FrameOffset, uint8_t * Destination, size_t Length)
+{
+    size_t Response = 0;
+
+    if (BlockReader.IsOpen ())
+    {
+        Response = BlockReader.Read (FrameId, FrameOffset, Destination, Length);
+    }
+    else
+    {
+        uint32_t FilePosition = FrameControl.DataOffset + (FrameControl.ChannelsPerFrame * FrameId) + FrameOffset;
+        if (nullptr != CachedFile)
+        {
+            Response = min (Length, CachedFileSize - min (CachedFileSize, size_t (FilePosition)));
+            memcpy (Destination, &CachedFile[FilePosition], Response);
+        }
+        else
+        {
+            Response = FileMgr.ReadSdFile (FileHandleForFileBeingPlayed, Destination, Length, FilePosition);
+        }
+    }
+
+    return Response;
+
+} // ReadFrameData
+
+//-----------------------------------------------------------------------------
+void c_InputFPPRemotePlayFile::ReleaseCachedFile ()
+{
+    // DEBUG_START;
+
+    if (FSEQ_CACHE_NO_HANDLE != CachedFileHandle)
+    {
+        FseqCache.Release (CachedFileHandle);
+        CachedFileHandle = FSEQ_CACHE_NO_HANDLE;
+    }
+
+    CachedFile     = nullptr;
+    CachedFileSize = 0;
+
+    // DEBUG_END;
+
+} // ReleaseCachedFile
+
+//-----------------------------------------------------------------------------
+/*
+    Read one frame the way it is sent to the output, up to Size bytes.
+
+    The segments of a frame are stored back to back, so when they are in
+    output order the frame is read with a single read and then spread out
+    from the last segment to the first. A segment never lands in front of
+    where it was read, so nothing is overwritten before it is moved.
+    Gaps between segments are cleared.
+*/
+bool c_InputFPPRemotePlayFile::ReadFrame (uint32_t FrameId, uint8_t * Destination, size_t Size)
+{
+    bool Response = true;
+
+    do // once
+    {
+        if (FrameSegmentsInOrder)
+        {
+            uint32_t ReadLength = 0;
+            for (uint32_t SegmentIndex = 0; SegmentIndex < NumFrameSegments; ++SegmentIndex)
+            {
+                FrameSegment_t & Segment = FrameSegments[SegmentIndex];
+                if (Segment.BufferOffset >= Size)
+                {
+                    break;
+                }
+                ReadLength = Segment.FileOffset + min (size_t (Segment.Length), Size - Segment.BufferOffset);
+            }
+
+            if (ReadLength != ReadFrameData (FrameId, 0, Destination, ReadLength))
+            {
+                Response = false;
+                break;
+            }
+
+            for (uint32_t SegmentIndex = NumFrameSegments; SegmentIndex-- > 0;)
+            {
+                FrameSegment_t & Segment = FrameSegments[SegmentIndex];
+                if (Segment.BufferOffset >= Size)
+                {
+                    continue;
+                }
+
+                if (Segment.BufferOffset != Segment.FileOffset)
+                {
+                    memmove (&Destination[Segment.BufferOffset],
+                             &Destination[Segment.FileOffset],
+                             min (size_t (Segment.Length), Size - Segment.BufferOffset));
+                }
+
+                uint32_t GapStart = (0 == SegmentIndex) ? 0 :
+                                    FrameSegments[SegmentIndex - 1].BufferOffset + FrameSegments[SegmentIndex - 1].Length;
+                memset (&Destination[GapStart], 0x00, Segment.BufferOffset - GapStart);
+            }
+            break;
+        }
+
+        // segments overlap or are out of order. Read them one at a time
+        memset (Destination, 0x00, Size);
+        for (uint32_t SegmentIndex = 0; SegmentIndex < NumFrameSegments; ++SegmentIndex)
+        {
+            FrameSegment_t & Segment = FrameSegments[SegmentIndex];
+            if (Segment.BufferOffset >= Size)
+            {
+                continue;
+            }
+
+            size_t BytesToRead = min (size_t (Segment.Length), Size - Segment.BufferOffset);
+            if (BytesToRead != ReadFrameData (FrameId, Segment.FileOffset, &Destination[Segment.BufferOffset], BytesToRead))
+            {
+                Response = false;
+                break;
+            }
+        }
+
+    } while (false);
+
+    return Response;
+
+} // ReadFrame
 
 //-----------------------------------------------------------------------------
 void c_InputFPPRemotePlayFile::ClearFileInfo()
@@ -454,7 +1091,8 @@ void c_InputFPPRemotePlayFile::ClearFileInfo()
     FrameControl.ElapsedPlayTimeMS             = 0;
     FrameControl.DataOffset                    = 0;
     FrameControl.ChannelsPerFrame              = 0;
-    FrameControl.FrameStepTimeMS               = 25;
+    FrameControl.FrameStepTimeMS               = FPP_TICKER_PERIOD_MS;
     FrameControl.TotalNumberOfFramesInSequence = 0;
+    FreeFrameSegments ();
 
 } // ClearFileInfo
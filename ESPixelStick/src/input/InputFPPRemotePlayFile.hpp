@@ -23,10 +23,15 @@
 #include "InputFPPRemotePlayItem.hpp"
 #include "InputFPPRemotePlayFileFsm.hpp"
 #include "../service/fseq.h"
-#include <Ticker.h>
+#include "../service/FseqBlockReader.hpp"
+#include "../service/FseqCache.hpp"
+#include "../service/FseqIndex.hpp"
 
 #ifdef ARDUINO_ARCH_ESP32
 #include <esp_task.h>
+#include <esp_timer.h>
+#else
+#include <Ticker.h>
 #endif // def ARDUINO_ARCH_ESP32
 
 
@@ -44,6 +49,7 @@ public:
     virtual bool IsIdle () { return (pCurrentFsmState == &fsm_PlayFile_state_Idle_imp); }
     
     void TimerPoll ();
+    void FillPrefetch ();       ///< Read ahead. Runs on the prefetch task (ESP32) or from Poll
 #ifdef ARDUINO_ARCH_ESP32
     TaskHandle_t GetTaskHandle () { return TimerPollTaskHandle; }
 #endif // def ARDUINO_ARCH_ESP32
@@ -69,6 +75,10 @@ private:
     fsm_PlayFile_state * pCurrentFsmState = &fsm_PlayFile_state_Idle_imp;
     
     c_FileMgr::FileId FileHandleForFileBeingPlayed = 0;
+    c_FseqBlockReader BlockReader;      ///< Only open for compressed sequences
+    c_FseqCache::Handle_t CachedFileHandle = FSEQ_CACHE_NO_HANDLE; ///< Cache entry for the file. Filled in by FillPrefetch
+    const uint8_t   * CachedFile = nullptr; ///< Whole file in RAM once the cache has all of it
+    size_t            CachedFileSize = 0;
 
     struct FrameControl_t
     {
@@ -89,30 +99,104 @@ private:
 
     uint8_t * Buffer = nullptr;
     size_t    BufferSize = 0;
-#   define    FPP_TICKER_PERIOD_MS 25
+#   define    FPP_TICKER_PERIOD_MS 25   // Timer period while nothing is playing
 // #   define    FPP_TICKER_PERIOD_MS 1000
+#   define    FPP_MIN_STEP_TIME_MS 10   // Fastest sequence we will play (100 fps)
+    /// While playing, the frame timer runs at the sequence step time so
+    /// every frame gets its own tick.
+#ifdef ARDUINO_ARCH_ESP32
+    esp_timer_handle_t FrameTimer = nullptr;
+#else
     Ticker    MsTicker;
-    uint32_t  LastIsrTimeStampMS = 0;
+#endif // def ARDUINO_ARCH_ESP32
+    uint32_t  FrameTimerPeriodMS = FPP_TICKER_PERIOD_MS;
+    uint32_t  LastIsrTimeStampUS = 0;
+    uint32_t  ElapsedUSCarry = 0;       ///< Part of a ms not yet added to ElapsedPlayTimeMS
     uint32_t  PlayedFileCount = 0;
 
     // Logic to detect if polls have stopped coming in. 
     // This is part of the blanking logic.
+#   define    FPP_POLL_DETECTION_MS (5 * FPP_TICKER_PERIOD_MS)
     int       PollDetectionCounter = 0;
-    static const int PollDetectionCounterLimit = 5;
 
-#define MAX_NUM_SPARSE_RANGES 5
-    FSEQParsedRangeEntry SparseRanges[MAX_NUM_SPARSE_RANGES];
+    /// Where each piece of a stored frame goes in the output buffer. Built
+    /// from the sparse range table when the file is opened. A v2 file stores
+    /// the ranges back to back, so FileOffset is a running total and
+    /// BufferOffset is the range start relative to the lowest range start.
+    struct FrameSegment_t
+    {
+        uint32_t FileOffset;
+        uint32_t BufferOffset;
+        uint32_t Length;
+    };
+    FrameSegment_t * FrameSegments      = nullptr;
+    uint32_t         NumFrameSegments   = 0;
+    uint32_t         FrameOutputLength  = 0;    ///< Output bytes covered by the segments
+    bool             FrameSegmentsInOrder = false; ///< One read per frame, spread out in place
+
+    /// Frames are read ahead into a ring by FillPrefetch. TimerPoll only
+    /// copies a ready frame to the output buffer.
+#define FSEQ_PREFETCH_MIN_FRAMES    2
+#define FSEQ_PREFETCH_MAX_FRAMES    8
+#ifdef ARDUINO_ARCH_ESP32
+#   define FSEQ_PREFETCH_BYTES      (16 * 1024)
+#   define FSEQ_PREFETCH_TASK_STACK 3072
+#else
+#   define FSEQ_PREFETCH_BYTES      (4 * 1024)
+#endif // def ARDUINO_ARCH_ESP32
 
+    struct PrefetchControl_t
+    {
+        uint8_t         * Ring = nullptr;
+        uint32_t          SlotSize = 0;             ///< Bytes of output data per frame
+        uint32_t          NumSlots = 0;
+        uint32_t          SlotFrameId[FSEQ_PREFETCH_MAX_FRAMES];
+        bool              Contiguous = false;       ///< Whole frames are used. Read several at once
+        volatile uint32_t Head = 0;                 ///< Frames filled. Only FillPrefetch writes it
+        volatile uint32_t Tail = 0;                 ///< Frames used. Only TimerPoll writes it
+        volatile uint32_t NextFrame = 0;            ///< Next frame FillPrefetch reads
+        volatile uint32_t ResyncFrame = 0;
+        volatile bool     ResyncRequested = false;
+        volatile bool     Active = false;
+        volatile bool     Busy = false;
+        volatile bool     ReadFailed = false;
+        uint32_t          Hits = 0;
+        uint32_t          Misses = 0;
+        uint32_t          Reads = 0;
+    } Prefetch;
+
+    void        StartPrefetch ();
+    void        StopPrefetch ();
+    void        KickPrefetch ();
+    bool        TakePrefetchedFrame (uint32_t FrameId);
+    bool        ReadFrame (uint32_t FrameId, uint8_t * Destination, size_t Size);
+
+    void        StartFrameTimer (uint32_t PeriodMS);
+    void        StopFrameTimer ();
     void        UpdateElapsedPlayTimeMS ();
     uint32_t    CalculateFrameId (uint32_t ElapsedMS, int32_t SyncOffsetMS);
     bool        ParseFseqFile ();
+    bool        ParseSparseRanges (FSEQRawHeader & fsqRawHeader, uint32_t NumSparseRanges);
+    void        FreeFrameSegments ();
+    void        ReleaseCachedFile ();
+    size_t      ReadFrameData (uint32_t FrameId, uint32_t FrameOffset, uint8_t * Destination, size_t Length);
 
     String      LastFailedPlayStatusMsg;
 
 #ifdef ARDUINO_ARCH_ESP32
     TaskHandle_t TimerPollTaskHandle = NULL;
+    TaskHandle_t PrefetchTaskHandle = NULL;
 #   define TimerPollHandlerTaskStack 2000
 // #   define TimerPollHandlerTaskStack 4000
+
+    /// Held for the whole of TimerPoll. Taking it waits out a tick that is already running.
+    SemaphoreHandle_t TimerPollLock = NULL;
+    void LockTimerPoll   () { xSemaphoreTake (TimerPollLock, portMAX_DELAY); }
+    void UnlockTimerPoll () { xSemaphoreGive (TimerPollLock); }
+#else
+    // the Ticker runs in the same context as loop ()
+    void LockTimerPoll   () {}
+    void UnlockTimerPoll () {}
 #endif // def ARDUINO_ARCH_ESP32
 
 }; // c_InputFPPRemotePlayFile
@@ -194,6 +194,7 @@ void fsm_PlayFile_state_PlayingFile::Poll ()
                 --p_Parent->RemainingPlayCount;
                 // DEBUG_V (String ("RemainingPlayCount: ") + p_Parent->RemainingPlayCount);
 
+                p_Parent->StartFrameTimer (p_Parent->FrameControl.FrameStepTimeMS);
                 p_Parent->FrameControl.ElapsedPlayTimeMS = 0;
                 LastPlayedFrameId = 0;
             }
@@ -206,6 +207,7 @@ void fsm_PlayFile_state_PlayingFile::Poll ()
             }
         }
 
+        p_Parent->KickPrefetch ();
         InputMgr.RestartBlankTimer (p_Parent->GetInputChannelId ());
 
     } while (false);
@@ -239,45 +241,42 @@ IRAM_ATTR void fsm_PlayFile_state_PlayingFile::TimerPoll ()
             break;
         }
 
-        uint32_t FilePosition = p_Parent->FrameControl.DataOffset + (p_Parent->FrameControl.ChannelsPerFrame * CurrentFrame);
-        size_t   MaxBytesToRead = (p_Parent->FrameControl.ChannelsPerFrame > p_Parent->BufferSize) ? p_Parent->BufferSize : p_Parent->FrameControl.ChannelsPerFrame;
-        byte* CurrentDestination = p_Parent->Buffer;
-        // xDEBUG_V (String ("               MaxBytesToRead: ") + String (MaxBytesToRead));
-
-        LastPlayedFrameId = CurrentFrame;
+        if (p_Parent->Prefetch.ReadFailed)
+        {
+            if (0 != p_Parent->FileHandleForFileBeingPlayed)
+            {
+                // logcon (F ("File Playback Failed to read enough data"));
+                Stop ();
+            }
+            break;
+        }
 
-        for (auto& CurrentSparseRange : p_Parent->SparseRanges)
+        if (nullptr != p_Parent->Prefetch.Ring)
         {
-            size_t ActualBytesToRead = min (MaxBytesToRead, CurrentSparseRange.ChannelCount);
-            if (0 == ActualBytesToRead)
+            // hand over a frame that has already been read
+            if (p_Parent->TakePrefetchedFrame (CurrentFrame))
             {
-                // no data to read for this range
-                continue;
+                LastPlayedFrameId = CurrentFrame;
             }
+            // else keep the last frame and try again on the next tick
+            break;
+        }
+
+        // no read ahead buffer. Read straight into the output
+        size_t MaxBytesToRead = (p_Parent->FrameControl.ChannelsPerFrame > p_Parent->BufferSize) ? p_Parent->BufferSize : p_Parent->FrameControl.ChannelsPerFrame;
+        // xDEBUG_V (String ("               MaxBytesToRead: ") + String (MaxBytesToRead));
 
-            uint32_t AdjustedFilePosition = FilePosition + CurrentSparseRange.DataOffset;
+        LastPlayedFrameId = CurrentFrame;
 
-            // xDEBUG_V (String ("                 FilePosition: ") + String (FilePosition));
-            // xDEBUG_V (String ("         AdjustedFilePosition: ") + String (uint32_t(AdjustedFilePosition), HEX));
-            // xDEBUG_V (String ("           CurrentDestination: ") + String (uint32_t(CurrentDestination), HEX));
-            // xDEBUG_V (String ("            ActualBytesToRead: ") + String (ActualBytesToRead));
-            size_t ActualBytesRead = FileMgr.ReadSdFile (p_Parent->FileHandleForFileBeingPlayed,
-                CurrentDestination,
-                ActualBytesToRead,
-                AdjustedFilePosition);
-            MaxBytesToRead -= ActualBytesRead;
-            CurrentDestination += ActualBytesRead;
+        if (!p_Parent->ReadFrame (CurrentFrame, p_Parent->Buffer, MaxBytesToRead))
+        {
+            // xDEBUG_V (String ("TotalNumberOfFramesInSequence: ") + String (p_Parent->TotalNumberOfFramesInSequence));
+            // xDEBUG_V (String ("                 CurrentFrame: ") + String (CurrentFrame));
 
-            if (ActualBytesRead != ActualBytesToRead)
+            if (0 != p_Parent->FileHandleForFileBeingPlayed)
             {
-                // xDEBUG_V (String ("TotalNumberOfFramesInSequence: ") + String (p_Parent->TotalNumberOfFramesInSequence));
-                // xDEBUG_V (String ("                 CurrentFrame: ") + String (CurrentFrame));
-
-                if (0 != p_Parent->FileHandleForFileBeingPlayed)
-                {
-                    // logcon (F ("File Playback Failed to read enough data"));
-                    Stop ();
-                }
+                // logcon (F ("File Playback Failed to read enough data"));
+                Stop ();
             }
         }
 
@@ -328,6 +327,9 @@ void fsm_PlayFile_state_PlayingFile::Init (c_InputFPPRemotePlayFile* Parent)
 
         logcon (String (F ("Start Playing:: FileName: '")) + p_Parent->PlayItemName + "'");
 
+        p_Parent->StartPrefetch ();
+        p_Parent->StartFrameTimer (p_Parent->FrameControl.FrameStepTimeMS);
+
         Parent->pCurrentFsmState = &(Parent->fsm_PlayFile_state_PlayingFile_imp);
         Parent->FrameControl.ElapsedPlayTimeMS = 0;
 
@@ -445,6 +447,10 @@ void fsm_PlayFile_state_Stopping::Poll ()
 
     // DEBUG_V (String ("FileHandleForFileBeingPlayed: ") + String (p_Parent->FileHandleForFileBeingPlayed));
 
+    p_Parent->StopPrefetch ();
+    p_Parent->StartFrameTimer (FPP_TICKER_PERIOD_MS);
+    p_Parent->BlockReader.Close ();
+    p_Parent->ReleaseCachedFile ();
     FileMgr.CloseSdFile (p_Parent->FileHandleForFileBeingPlayed);
     p_Parent->FileHandleForFileBeingPlayed = 0;
     p_Parent->fsm_PlayFile_state_Idle_imp.Init (p_Parent);
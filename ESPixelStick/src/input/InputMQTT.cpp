@@ -34,7 +34,7 @@ c_InputMQTT::c_InputMQTT (
     c_InputMgr::e_InputChannelIds NewInputChannelId,
     c_InputMgr::e_InputType       NewChannelType,
     uint8_t                     * BufferStart,
-    uint16_t                      BufferSize) :
+    uint32_t                      BufferSize) :
     c_InputCommon (NewInputChannelId, NewChannelType, BufferStart, BufferSize)
 
 {
@@ -171,7 +171,7 @@ void c_InputMQTT::Process ()
 } // process
 
 //-----------------------------------------------------------------------------
-void c_InputMQTT::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputMQTT::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
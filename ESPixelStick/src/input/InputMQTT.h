@@ -32,7 +32,7 @@ class c_InputMQTT : public c_InputCommon
           c_InputMgr::e_InputChannelIds NewInputChannelId,
           c_InputMgr::e_InputType       NewChannelType,
           uint8_t                     * BufferStart,
-          uint16_t                      BufferSize);
+          uint32_t                      BufferSize);
 
       ~c_InputMQTT ();
 
@@ -43,7 +43,7 @@ class c_InputMQTT : public c_InputCommon
       void GetStatus (JsonObject& jsonStatus);
       void Process ();                         ///< Call from loop(),  renders Input data
       void GetDriverName (String& sDriverName) { sDriverName = "MQTT"; } ///< get the name for the instantiated driver
-      void SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize);
+      void SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize);
       void NetworkStateChanged (bool IsConnected); // used by poorly designed rx functions
 
 private:
@@ -35,6 +35,7 @@
 #include "InputArtnet.hpp"
 // needs to be last
 #include "InputMgr.hpp"
+#include "../network/UdpRxTask.hpp"
 
 //-----------------------------------------------------------------------------
 
@@ -74,9 +75,20 @@ c_InputMgr::c_InputMgr ()
     {
         pInputChannelDrivers[pInputChannelDriversIndex] = nullptr;
         EffectEngineIsConfiguredToRun[pInputChannelDriversIndex] = false;
+        LayerBuffer[pInputChannelDriversIndex]       = nullptr;
+        LayerFront[pInputChannelDriversIndex]        = nullptr;
+        DriverBuffer[pInputChannelDriversIndex]      = nullptr;
+        LayerHasData[pInputChannelDriversIndex]      = false;
+        LayerDirty[pInputChannelDriversIndex]        = false;
+        LayerLastDataTime[pInputChannelDriversIndex] = 0;
+        BlankEndTime[pInputChannelDriversIndex]      = 0;
         ++pInputChannelDriversIndex;
     }
 
+#ifdef ARDUINO_ARCH_ESP32
+    LayerLock = xSemaphoreCreateMutex ();
+#endif // def ARDUINO_ARCH_ESP32
+
 } // c_InputMgr
 
 //-----------------------------------------------------------------------------
@@ -97,13 +109,16 @@ c_InputMgr::~c_InputMgr ()
         }
         pInputChannelDriversIndex++;
     }
+
+    FreeLayerBuffers ();
+
     // DEBUG_END;
 
 } // ~c_InputMgr
 
 //-----------------------------------------------------------------------------
 ///< Start the module
-void c_InputMgr::Begin (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputMgr::Begin (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
@@ -164,6 +179,9 @@ void c_InputMgr::CreateJsonConfig (JsonObject & jsonConfig)
 
     // DEBUG_V ("");
 
+    jsonConfig[CN_compositor] = CompositorMode;
+    jsonConfig[CN_alpha]      = CompositorAlpha;
+
     // add the channels header
     JsonObject InputMgrChannelsData;
     if (true == jsonConfig.containsKey (CN_channels))
@@ -548,12 +566,19 @@ void c_InputMgr::InstantiateNewInputChannel (e_InputChannelIds ChannelIndex, e_I
         //String sDriverName;
         //pInputChannelDrivers[ChannelIndex]->GetDriverName (sDriverName);
         //Serial.println (String (CN_stars) + " '" + sDriverName + F("' Initialization for input: '") + String(ChannelIndex) + "' " + CN_stars);
+        // the constructor was given the output buffer
+        DriverBuffer[ChannelIndex] = InputDataBuffer;
+        LayerHasData[ChannelIndex] = false;
+
         if (StartDriver)
         {
             // DEBUG_V (String ("StartDriver: ") + String (StartDriver));
             pInputChannelDrivers[ChannelIndex]->Begin ();
             // DEBUG_V ("");
             pInputChannelDrivers[ChannelIndex]->SetBufferInfo (InputDataBuffer, InputDataBufferSize);
+
+            // move the channels to their own layers if needed
+            UpdateLayerBuffers (false);
         }
         // DEBUG_V ("");
 
@@ -626,6 +651,7 @@ void c_InputMgr::Process ()
             configInProgress = false;
         }
 
+        // each channel has its own layer so all of them get to run
         bool aBlankTimerIsRunning = false;
         for (c_InputCommon * CurrentInput : pInputChannelDrivers)
         {
@@ -636,17 +662,23 @@ void c_InputMgr::Process ()
             {
                 // DEBUG_V (String ("Blank Timer is running: ") + String (CurrentInput->GetInputChannelId ()));
                 aBlankTimerIsRunning = true;
-                break;
             }
         }
 
         if (false == aBlankTimerIsRunning && config.BlankDelay != 0)
         {
             // DEBUG_V("Clear Input Buffer");
-            memset (InputDataBuffer, 0x00, InputDataBufferSize);
-            RestartBlankTimer (InputSecondaryChannelId);
+            ClearLayers ();
+            // hold off the next clear without marking the channel as having data
+            BlankEndTime[InputSecondaryChannelId] = (millis () / 1000) + config.BlankDelay;
         } // ALL blank timers have expired
 
+        // pick up changes made here and layers that have gone idle
+        if (LayersInUse && (LayersChanged || ((millis () - LastComposeTime) >= IM_COMPOSITOR_REFRESH_MS)))
+        {
+            RefreshLayers ();
+        }
+
         if (rebootNeeded)
         {
             // DEBUG_V("Requesting Reboot");
@@ -748,6 +780,15 @@ bool c_InputMgr::ProcessJsonConfig (JsonObject & jsonConfig)
         }
 
         // extract my own config data here
+        setFromJSON (CompositorMode,  InputChannelMgrData, CN_compositor);
+        setFromJSON (CompositorAlpha, InputChannelMgrData, CN_alpha);
+        if (CompositorMode >= CompositorMode_End)
+        {
+            logcon (String (F ("InputMgr: Invalid compositor mode. Using priority.")));
+            CompositorMode = CompositorMode_Default;
+        }
+        LayersChanged = true;
+
         if (true == InputChannelMgrData.containsKey (IM_EffectsControlButtonName))
         {
             // DEBUG_V ("Found Input Button Config");
@@ -870,30 +911,569 @@ void c_InputMgr::SetConfig (const char * NewConfigData)
 } // SetConfig
 
 //-----------------------------------------------------------------------------
-void c_InputMgr::SetBufferInfo (uint8_t* BufferStart, uint16_t BufferSize)
+void c_InputMgr::SetBufferInfo (uint8_t* BufferStart, uint32_t BufferSize)
 {
     // DEBUG_START;
 
+    // stop composing into the old buffer. UpdateLayerBuffers turns it back on.
+    LockLayers ();
     InputDataBuffer = BufferStart;
     InputDataBufferSize = BufferSize;
+    LayersInUse = false;
+    UnlockLayers ();
 
     // DEBUG_V ("InputDataBufferSize: " + String (InputDataBufferSize));
 
-    // pass through each active interface and set the buffer info
-            // for each Input channel
-    for (int ChannelIndex = int (InputChannelId_Start);
-        ChannelIndex < int (InputChannelId_End);
-        ChannelIndex++)
+    // pass the new buffer or layer to each active interface. Layers of the
+    // wrong size are replaced once the drivers have moved off of them.
+    UpdateLayerBuffers (true);
+
+    // DEBUG_END;
+
+} // SetBufferInfo
+
+//-----------------------------------------------------------------------------
+/*
+    Called by a channel every time it writes new data into its buffer. Runs
+    in the context of the channel, which can be the UDP receive task. The
+    layer is only marked dirty. Process () composes it on the next refresh.
+*/
+void c_InputMgr::RestartBlankTimer (c_InputMgr::e_InputChannelIds Selector)
+{
+    LockLayers ();
+    NoteNewData (Selector);
+    UnlockLayers ();
+
+} // RestartBlankTimer
+
+//-----------------------------------------------------------------------------
+/*
+    Called by a channel when a whole frame has been written, e.g. on a sync
+    or PUSH packet. The frame is composed right away instead of waiting for
+    loop ().
+*/
+void c_InputMgr::FrameComplete (c_InputMgr::e_InputChannelIds Selector)
+{
+    LockLayers ();
+
+    NoteNewData (Selector);
+
+    if (LayersInUse)
     {
-        if (nullptr != pInputChannelDrivers[ChannelIndex])
+        PublishLayer (Selector);
+        Compose ();
+    }
+
+    UnlockLayers ();
+
+} // FrameComplete
+
+//-----------------------------------------------------------------------------
+///< Call with LayerLock held
+void c_InputMgr::NoteNewData (e_InputChannelIds ChannelId)
+{
+    BlankEndTime[ChannelId]      = (millis () / 1000) + config.BlankDelay;
+    LayerLastDataTime[ChannelId] = millis ();
+    LayerHasData[ChannelId]      = true;
+    LayerDirty[ChannelId]        = true;
+
+} // NoteNewData
+
+//-----------------------------------------------------------------------------
+///< Blank every layer and the output buffer
+void c_InputMgr::ClearLayers ()
+{
+    // DEBUG_START;
+
+    LockLayers ();
+
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         ChannelIndex < uint32_t (InputChannelId_End);
+         ChannelIndex++)
+    {
+        if (nullptr != LayerBuffer[ChannelIndex])
         {
-            pInputChannelDrivers[ChannelIndex]->SetBufferInfo (InputDataBuffer, InputDataBufferSize);
+            memset (LayerBuffer[ChannelIndex], 0x00, LayerBufferSize);
         }
-    } // end for each channel
+        if ((nullptr != LayerFront[ChannelIndex]) && (LayerFront[ChannelIndex] != LayerBuffer[ChannelIndex]))
+        {
+            memset (LayerFront[ChannelIndex], 0x00, LayerBufferSize);
+        }
+        LayerHasData[ChannelIndex] = false;
+    }
+
+    if (nullptr != InputDataBuffer)
+    {
+        memset (InputDataBuffer, 0x00, InputDataBufferSize);
+    }
+
+    LayersChanged = true;
+
+    UnlockLayers ();
 
     // DEBUG_END;
 
-} // SetBufferInfo
+} // ClearLayers
+
+//-----------------------------------------------------------------------------
+/*
+    Decide where each channel writes its data. With a single enabled channel
+    the driver writes straight into the output buffer and there is nothing to
+    compose. As soon as a second channel is enabled each enabled channel gets
+    its own layer and Compose builds the output buffer from the layers.
+
+    If a layer cannot be allocated we fall back to the shared buffer.
+*/
+void c_InputMgr::UpdateLayerBuffers (bool ForceUpdate)
+{
+    // DEBUG_START;
+
+    uint8_t * NewLayerBuffer[InputChannelId_End];
+    uint8_t * NewLayerFront[InputChannelId_End];
+    uint32_t  NumEnabledChannels = 0;
+
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         ChannelIndex < uint32_t (InputChannelId_End);
+         ChannelIndex++)
+    {
+        NewLayerBuffer[ChannelIndex] = nullptr;
+        NewLayerFront[ChannelIndex]  = nullptr;
+        if ((nullptr != pInputChannelDrivers[ChannelIndex]) &&
+            (e_InputType::InputType_Disabled != pInputChannelDrivers[ChannelIndex]->GetInputType ()))
+        {
+            ++NumEnabledChannels;
+        }
+    }
+    // DEBUG_V (String ("NumEnabledChannels: ") + String (NumEnabledChannels));
+
+    bool NeedLayers = (1 < NumEnabledChannels) && (nullptr != InputDataBuffer) && (0 != InputDataBufferSize);
+
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         NeedLayers && (ChannelIndex < uint32_t (InputChannelId_End));
+         ChannelIndex++)
+    {
+        c_InputCommon * CurrentInput = pInputChannelDrivers[ChannelIndex];
+        if ((nullptr == CurrentInput) || (e_InputType::InputType_Disabled == CurrentInput->GetInputType ()))
+        {
+            continue;
+        }
+
+        // keep an existing layer that is still the right size
+        if ((nullptr != LayerBuffer[ChannelIndex]) && (LayerBufferSize == InputDataBufferSize))
+        {
+            NewLayerBuffer[ChannelIndex] = LayerBuffer[ChannelIndex];
+            NewLayerFront[ChannelIndex]  = LayerFront[ChannelIndex];
+            continue;
+        }
+
+        NewLayerBuffer[ChannelIndex] = (uint8_t *)malloc (InputDataBufferSize);
+#ifdef ARDUINO_ARCH_ESP32
+        NewLayerFront[ChannelIndex]  = (uint8_t *)malloc (InputDataBufferSize);
+#else
+        NewLayerFront[ChannelIndex]  = NewLayerBuffer[ChannelIndex];
+#endif // def ARDUINO_ARCH_ESP32
+        if ((nullptr == NewLayerBuffer[ChannelIndex]) || (nullptr == NewLayerFront[ChannelIndex]))
+        {
+            logcon (String (F ("ERROR: Could not allocate the layer for input ")) + String (ChannelIndex) + F (". Inputs will share the output buffer."));
+
+            // release what we allocated in this pass
+            for (uint32_t Index = uint32_t (InputChannelId_Start); Index <= ChannelIndex; Index++)
+            {
+                if ((nullptr != NewLayerFront[Index]) && (NewLayerFront[Index] != NewLayerBuffer[Index]) && (NewLayerFront[Index] != LayerFront[Index]))
+                {
+                    free (NewLayerFront[Index]);
+                }
+                if ((nullptr != NewLayerBuffer[Index]) && (NewLayerBuffer[Index] != LayerBuffer[Index]))
+                {
+                    free (NewLayerBuffer[Index]);
+                }
+                NewLayerBuffer[Index] = nullptr;
+                NewLayerFront[Index]  = nullptr;
+            }
+            NeedLayers = false;
+            break;
+        }
+
+        // start the layer with what the channel has already sent
+        memset (NewLayerBuffer[ChannelIndex], 0x00, InputDataBufferSize);
+        if (nullptr != LayerBuffer[ChannelIndex])
+        {
+            memcpy (NewLayerBuffer[ChannelIndex], LayerBuffer[ChannelIndex], min (LayerBufferSize, InputDataBufferSize));
+        }
+        else
+        {
+            memcpy (NewLayerBuffer[ChannelIndex], InputDataBuffer, InputDataBufferSize);
+        }
+
+        if (NewLayerFront[ChannelIndex] != NewLayerBuffer[ChannelIndex])
+        {
+            memcpy (NewLayerFront[ChannelIndex], NewLayerBuffer[ChannelIndex], InputDataBufferSize);
+        }
+    }
+
+    // going back to a single channel. Keep showing what it last sent.
+    if (!NeedLayers && LayersInUse && (nullptr != InputDataBuffer))
+    {
+        LockLayers ();
+        for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+             ChannelIndex < uint32_t (InputChannelId_End);
+             ChannelIndex++)
+        {
+            c_InputCommon * CurrentInput = pInputChannelDrivers[ChannelIndex];
+            if ((nullptr != LayerFront[ChannelIndex]) &&
+                (nullptr != CurrentInput) &&
+                (e_InputType::InputType_Disabled != CurrentInput->GetInputType ()))
+            {
+                memcpy (InputDataBuffer, LayerFront[ChannelIndex], min (LayerBufferSize, InputDataBufferSize));
+            }
+        }
+
+        // the remaining channel is about to write straight into the output buffer
+        LayersInUse = false;
+        UnlockLayers ();
+    }
+
+    // point the drivers at their new buffers before the old layers go away.
+    // Not under LayerLock. The drivers take the UDP receive lock.
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         ChannelIndex < uint32_t (InputChannelId_End);
+         ChannelIndex++)
+    {
+        uint8_t * TargetBuffer = (nullptr != NewLayerBuffer[ChannelIndex]) ? NewLayerBuffer[ChannelIndex] : InputDataBuffer;
+
+        if ((nullptr != pInputChannelDrivers[ChannelIndex]) &&
+            (ForceUpdate || (TargetBuffer != DriverBuffer[ChannelIndex])))
+        {
+            pInputChannelDrivers[ChannelIndex]->SetBufferInfo (TargetBuffer, InputDataBufferSize);
+        }
+        DriverBuffer[ChannelIndex] = TargetBuffer;
+    }
+
+    // hand the new layers to the compositor
+    uint8_t * OldLayerBuffer[InputChannelId_End];
+    uint8_t * OldLayerFront[InputChannelId_End];
+
+    LockLayers ();
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         ChannelIndex < uint32_t (InputChannelId_End);
+         ChannelIndex++)
+    {
+        OldLayerBuffer[ChannelIndex] = LayerBuffer[ChannelIndex];
+        OldLayerFront[ChannelIndex]  = LayerFront[ChannelIndex];
+        LayerBuffer[ChannelIndex]    = NewLayerBuffer[ChannelIndex];
+        LayerFront[ChannelIndex]     = NewLayerFront[ChannelIndex];
+    }
+
+    LayerBufferSize = NeedLayers ? InputDataBufferSize : 0;
+    LayersInUse     = NeedLayers;
+    LayersChanged   = true;
+    UnlockLayers ();
+
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         ChannelIndex < uint32_t (InputChannelId_End);
+         ChannelIndex++)
+    {
+        if ((nullptr != OldLayerFront[ChannelIndex]) &&
+            (OldLayerFront[ChannelIndex] != OldLayerBuffer[ChannelIndex]) &&
+            (OldLayerFront[ChannelIndex] != NewLayerFront[ChannelIndex]))
+        {
+            free (OldLayerFront[ChannelIndex]);
+        }
+
+        if ((nullptr != OldLayerBuffer[ChannelIndex]) && (OldLayerBuffer[ChannelIndex] != NewLayerBuffer[ChannelIndex]))
+        {
+            free (OldLayerBuffer[ChannelIndex]);
+        }
+    }
+
+    // DEBUG_V (String ("LayersInUse: ") + String (LayersInUse));
+
+    // DEBUG_END;
+
+} // UpdateLayerBuffers
+
+//-----------------------------------------------------------------------------
+void c_InputMgr::FreeLayerBuffers ()
+{
+    // DEBUG_START;
+
+    LockLayers ();
+    LayerBufferSize = 0;
+    LayersInUse     = false;
+    UnlockLayers ();
+
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         ChannelIndex < uint32_t (InputChannelId_End);
+         ChannelIndex++)
+    {
+        if ((nullptr != LayerFront[ChannelIndex]) && (LayerFront[ChannelIndex] != LayerBuffer[ChannelIndex]))
+        {
+            free (LayerFront[ChannelIndex]);
+        }
+        LayerFront[ChannelIndex] = nullptr;
+
+        if (nullptr != LayerBuffer[ChannelIndex])
+        {
+            free (LayerBuffer[ChannelIndex]);
+            LayerBuffer[ChannelIndex] = nullptr;
+        }
+    }
+
+    // DEBUG_END;
+
+} // FreeLayerBuffers
+
+//-----------------------------------------------------------------------------
+/*
+    Some writers do not report their changes: fades of universes that have
+    gone quiet, the end of a sync, blanking. Publish every layer that has
+    not been published recently and compose. The UDP handlers are held off
+    so a network layer is never copied while a packet is being written.
+    Runs from loop (), so the other loop () writers are not running either.
+*/
+void c_InputMgr::RefreshLayers ()
+{
+    // DEBUG_START;
+
+    UdpRxTask.Lock ();
+    LockLayers ();
+
+    uint32_t now = millis ();
+    for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+         ChannelIndex < uint32_t (InputChannelId_End);
+         ChannelIndex++)
+    {
+        // new data, or a channel that writes without reporting it
+        if (LayerDirty[ChannelIndex] || ((now - LayerLastDataTime[ChannelIndex]) >= IM_COMPOSITOR_REFRESH_MS))
+        {
+            PublishLayer (e_InputChannelIds (ChannelIndex));
+        }
+    }
+
+    Compose ();
+
+    UnlockLayers ();
+    UdpRxTask.Unlock ();
+
+    // DEBUG_END;
+
+} // RefreshLayers
+
+//-----------------------------------------------------------------------------
+/*
+    Give the compositor the data a channel has just written. Call with
+    LayerLock held.
+*/
+void c_InputMgr::PublishLayer (e_InputChannelIds ChannelId)
+{
+    uint8_t * Layer = LayerBuffer[ChannelId];
+    uint8_t * Front = LayerFront[ChannelId];
+
+    if ((nullptr != Layer) && (nullptr != Front) && (Layer != Front))
+    {
+        memcpy (Front, Layer, LayerBufferSize);
+    }
+
+    LayerDirty[ChannelId] = false;
+
+} // PublishLayer
+
+//-----------------------------------------------------------------------------
+void c_InputMgr::LockLayers ()
+{
+#ifdef ARDUINO_ARCH_ESP32
+    xSemaphoreTake (LayerLock, portMAX_DELAY);
+#endif // def ARDUINO_ARCH_ESP32
+
+} // LockLayers
+
+//-----------------------------------------------------------------------------
+void c_InputMgr::UnlockLayers ()
+{
+#ifdef ARDUINO_ARCH_ESP32
+    xSemaphoreGive (LayerLock);
+#endif // def ARDUINO_ARCH_ESP32
+
+} // UnlockLayers
+
+//-----------------------------------------------------------------------------
+///< A layer is active while its channel keeps sending data
+bool c_InputMgr::LayerIsActive (e_InputChannelIds ChannelId)
+{
+    bool Response = false;
+
+    do // once
+    {
+        if ((nullptr == LayerBuffer[ChannelId]) || (false == LayerHasData[ChannelId]))
+        {
+            break;
+        }
+
+        if (0 != config.BlankDelay)
+        {
+            Response = !BlankTimerHasExpired (ChannelId);
+            break;
+        }
+
+        Response = (millis () - LayerLastDataTime[ChannelId]) < IM_LAYER_IDLE_TIMEOUT_MS;
+
+    } while (false);
+
+    return Response;
+
+} // LayerIsActive
+
+//-----------------------------------------------------------------------------
+// Byte wise merge kernels. Zero bytes in the upper layer are transparent.
+//-----------------------------------------------------------------------------
+static void ComposeHTP (uint8_t * Output, const uint8_t * Layer, uint32_t Length)
+{
+    for (uint32_t Index = 0; Index < Length; ++Index)
+    {
+        if (Layer[Index] > Output[Index])
+        {
+            Output[Index] = Layer[Index];
+        }
+    }
+} // ComposeHTP
+
+static void ComposeOverlay (uint8_t * Output, const uint8_t * Layer, uint32_t Length)
+{
+    for (uint32_t Index = 0; Index < Length; ++Index)
+    {
+        if (0 != Layer[Index])
+        {
+            Output[Index] = Layer[Index];
+        }
+    }
+} // ComposeOverlay
+
+static void ComposeAlpha (uint8_t * Output, const uint8_t * Layer, uint32_t Length, uint8_t Alpha)
+{
+    uint32_t InverseAlpha = 255 - Alpha;
+
+    for (uint32_t Index = 0; Index < Length; ++Index)
+    {
+        if (0 != Layer[Index])
+        {
+            // (Value / 255) without a divide
+            uint32_t Value = (uint32_t (Layer[Index]) * Alpha) + (uint32_t (Output[Index]) * InverseAlpha) + 128;
+            Output[Index] = uint8_t ((Value + (Value >> 8)) >> 8);
+        }
+    }
+} // ComposeAlpha
+
+//-----------------------------------------------------------------------------
+/*
+    Build the output buffer from the front copies of the channel layers.
+    Runs from RestartBlankTimer as soon as a channel has new data, and from
+    Process () at least every IM_COMPOSITOR_REFRESH_MS. Call with LayerLock
+    held.
+*/
+void c_InputMgr::Compose ()
+{
+    // xDEBUG_START;
+
+    do // once
+    {
+        if (false == LayersInUse)
+        {
+            // the only enabled channel writes straight into the output buffer
+            break;
+        }
+
+        uint32_t now = millis ();
+        LayersChanged   = false;
+        LastComposeTime = now;
+
+        if (CompositorMode_Priority == CompositorMode)
+        {
+            // lowest numbered active channel. Otherwise whoever sent data last.
+            int32_t  SelectedChannel = -1;
+            int32_t  FallbackChannel = -1;
+            uint32_t FallbackAge     = uint32_t (-1);
+            for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+                 ChannelIndex < uint32_t (InputChannelId_End);
+                 ChannelIndex++)
+            {
+                if (nullptr == LayerBuffer[ChannelIndex])
+                {
+                    continue;
+                }
+
+                if (LayerIsActive (e_InputChannelIds (ChannelIndex)))
+                {
+                    SelectedChannel = ChannelIndex;
+                    break;
+                }
+
+                uint32_t Age = LayerHasData[ChannelIndex] ? (now - LayerLastDataTime[ChannelIndex]) : uint32_t (-1);
+                if ((-1 == FallbackChannel) || (Age < FallbackAge))
+                {
+                    FallbackChannel = ChannelIndex;
+                    FallbackAge     = Age;
+                }
+            }
+
+            if (-1 == SelectedChannel)
+            {
+                SelectedChannel = FallbackChannel;
+            }
+
+            if (-1 != SelectedChannel)
+            {
+                memcpy (InputDataBuffer, LayerFront[SelectedChannel], InputDataBufferSize);
+            }
+            break;
+        }
+
+        // primary channel is the base. Higher channels are merged on top of it.
+        bool FirstLayer = true;
+        for (uint32_t ChannelIndex = uint32_t (InputChannelId_Start);
+             ChannelIndex < uint32_t (InputChannelId_End);
+             ChannelIndex++)
+        {
+            uint8_t * Layer = LayerFront[ChannelIndex];
+            if (nullptr == Layer)
+            {
+                continue;
+            }
+
+            if (FirstLayer)
+            {
+                memcpy (InputDataBuffer, Layer, InputDataBufferSize);
+                FirstLayer = false;
+                continue;
+            }
+
+            switch (CompositorMode)
+            {
+                case CompositorMode_HTP:
+                {
+                    ComposeHTP (InputDataBuffer, Layer, InputDataBufferSize);
+                    break;
+                }
+
+                case CompositorMode_Overlay:
+                {
+                    ComposeOverlay (InputDataBuffer, Layer, InputDataBufferSize);
+                    break;
+                }
+
+                case CompositorMode_Alpha:
+                default:
+                {
+                    ComposeAlpha (InputDataBuffer, Layer, InputDataBufferSize, CompositorAlpha);
+                    break;
+                }
+            } // switch (CompositorMode)
+        }
+
+    } while (false);
+
+    // xDEBUG_END;
+
+} // Compose
 
 //-----------------------------------------------------------------------------
 void c_InputMgr::SetOperationalState (bool ActiveFlag)
@@ -47,20 +47,22 @@ public:
     c_InputMgr ();
     virtual ~c_InputMgr ();
 
-    void Begin                (uint8_t * BufferStart, uint16_t BufferSize);
+    void Begin                (uint8_t * BufferStart, uint32_t BufferSize);
     void LoadConfig           ();
     void GetConfig            (byte * Response, size_t maxlen);
     void GetStatus            (JsonObject & jsonStatus);
     void SetConfig            (const char * NewConfig);
     void Process              ();
-    void SetBufferInfo        (uint8_t* BufferStart, uint16_t BufferSize);
+    void SetBufferInfo        (uint8_t* BufferStart, uint32_t BufferSize);
     void SetOperationalState  (bool Active);
     void NetworkStateChanged  (bool IsConnected);
     void DeleteConfig         () { FileMgr.DeleteConfigFile (ConfigFileName); }
     bool GetNetworkState      () { return IsConnected; }
     void GetDriverName        (String & Name) { Name = "InputMgr"; }
-    void RestartBlankTimer    (c_InputMgr::e_InputChannelIds Selector) { BlankEndTime[int(Selector)] = (millis () / 1000) + config.BlankDelay; }
+    void RestartBlankTimer    (c_InputMgr::e_InputChannelIds Selector);
+    void FrameComplete        (c_InputMgr::e_InputChannelIds Selector);
     bool BlankTimerHasExpired (c_InputMgr::e_InputChannelIds Selector) { return !(BlankEndTime[int(Selector)] > (millis () / 1000)); }
+    void ClearLayers          ();
 
     enum e_InputType
     {
@@ -77,6 +79,17 @@ public:
         InputType_Default = InputType_Disabled,
     };
 
+    // how the input channel layers are combined into the output buffer
+    enum e_CompositorMode
+    {
+        CompositorMode_Priority = 0,  ///< Lowest numbered channel that is receiving data wins
+        CompositorMode_HTP,           ///< Highest value per byte
+        CompositorMode_Overlay,       ///< Non zero bytes of the secondary channel replace the primary channel
+        CompositorMode_Alpha,         ///< Non zero bytes of the secondary channel are blended over the primary channel
+        CompositorMode_End,
+        CompositorMode_Default = CompositorMode_Priority,
+    };
+
 private:
 
     void InstantiateNewInputChannel (e_InputChannelIds InputChannelId, e_InputType NewChannelType, bool StartDriver = true);
@@ -84,7 +97,7 @@ private:
 
     c_InputCommon * pInputChannelDrivers[InputChannelId_End]; ///< pointer(s) to the current active Input driver
     uint8_t       * InputDataBuffer     = nullptr;
-    uint16_t        InputDataBufferSize = 0;
+    uint32_t        InputDataBufferSize = 0;
     bool            HasBeenInitialized  = false;
     c_ExternalInput ExternalInput;
     bool            EffectEngineIsConfiguredToRun[InputChannelId_End];
@@ -100,12 +113,55 @@ private:
     bool ProcessJsonChannelConfig    (JsonObject & jsonConfig, uint32_t ChannelIndex);
     bool InputTypeIsAllowedOnChannel (e_InputType type, e_InputChannelIds ChannelId);
     void ProcessEffectsButtonActions (void);
+    void UpdateLayerBuffers          (bool ForceUpdate);
+    void FreeLayerBuffers            ();
+    bool LayerIsActive               (e_InputChannelIds ChannelId);
+    void PublishLayer                (e_InputChannelIds ChannelId);
+    void NoteNewData                 (e_InputChannelIds ChannelId);
+    void RefreshLayers               ();
+    void Compose                     ();
+    void LockLayers                  ();
+    void UnlockLayers                ();
 
     String ConfigFileName;
     bool   rebootNeeded = false;
 
     time_t BlankEndTime[InputChannelId_End];
 
+    /*
+        Each input channel renders into its own layer. The layers are only
+        allocated when more than one channel is enabled. Otherwise the single
+        channel writes straight into the output buffer.
+
+        On the ESP32 the channels write from different tasks. Each layer has
+        a front copy that the compositor reads. A channel that has written
+        new data calls RestartBlankTimer, which only marks its layer dirty.
+        When a channel knows its frame is complete (sync, PUSH) it calls
+        FrameComplete, which copies its layer to the front and composes
+        right away under LayerLock. Process () publishes the other dirty
+        layers and composes once every IM_COMPOSITOR_REFRESH_MS. The
+        compositor never sees a layer that is half written. The ESP8266 has
+        no tasks, so the front copy is the layer itself.
+    */
+    uint8_t       * LayerBuffer[InputChannelId_End];   ///< Layer owned by each channel. nullptr if not layered
+    uint8_t       * LayerFront[InputChannelId_End];    ///< What the compositor reads. Same as LayerBuffer on the ESP8266
+    uint8_t       * DriverBuffer[InputChannelId_End];  ///< Buffer each driver was last given
+    bool            LayerHasData[InputChannelId_End];
+    bool            LayerDirty[InputChannelId_End];    ///< New data since the layer was last published
+    uint32_t        LayerLastDataTime[InputChannelId_End];
+    uint32_t        LayerBufferSize = 0;
+    bool            LayersInUse     = false;
+    volatile bool   LayersChanged   = false;           ///< Layers or settings changed outside of RestartBlankTimer
+    uint32_t        LastComposeTime = 0;
+    uint8_t         CompositorMode  = CompositorMode_Default;
+    uint8_t         CompositorAlpha = 255;
+#ifdef ARDUINO_ARCH_ESP32
+    SemaphoreHandle_t LayerLock     = NULL;            ///< Held while the layers are published, composed or replaced
+#endif // def ARDUINO_ARCH_ESP32
+
+#define IM_COMPOSITOR_REFRESH_MS    25   // compose at least this often so layers that go idle are noticed
+#define IM_LAYER_IDLE_TIMEOUT_MS    5000 // a layer with no new data is inactive after this long when blanking is off
+
 #define IM_JSON_SIZE (5 * 1024)
 
 }; // c_InputMgr
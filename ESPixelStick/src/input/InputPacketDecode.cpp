@@ -0,0 +1,328 @@
+/*
+* InputPacketDecode.cpp - Decode and copy helpers for the network protocols
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   Fields are read a byte at a time at fixed offsets. That keeps the code
+*   independent of structure packing, alignment and host byte order.
+*/
+
+#include "InputPacketDecode.hpp"
+#include <string.h>
+
+static const uint8_t E131_ACN_ID[12] = { 0x41, 0x53, 0x43, 0x2d, 0x45, 0x31, 0x2e, 0x31, 0x37, 0x00, 0x00, 0x00 };
+static const uint8_t ARTNET_ID[8]    = { 'A', 'r', 't', '-', 'N', 'e', 't', 0x00 };
+
+// E1.31 data packet field offsets
+#define E131_OFFSET_ACN_ID          4
+#define E131_OFFSET_ROOT_VECTOR     18
+#define E131_OFFSET_CID             22
+#define E131_OFFSET_FRAME_VECTOR    40
+#define E131_OFFSET_PRIORITY        108
+#define E131_OFFSET_SYNC_ADDRESS    109
+#define E131_OFFSET_SEQUENCE        111
+#define E131_OFFSET_OPTIONS         112
+#define E131_OFFSET_UNIVERSE        113
+#define E131_OFFSET_DMP_VECTOR      117
+#define E131_OFFSET_VALUE_COUNT     123
+#define E131_OFFSET_START_CODE      125
+
+// E1.31 sync packet field offsets
+#define E131_OFFSET_SYNC_SYNC_ADDRESS   45
+
+// E1.31 universe discovery packet field offsets
+#define E131_OFFSET_DISCOVERY_SOURCE_NAME   44
+#define E131_OFFSET_DISCOVERY_VECTOR        114
+#define E131_OFFSET_DISCOVERY_PAGE          118
+#define E131_OFFSET_DISCOVERY_LAST_PAGE     119
+#define E131_DISCOVERY_MAX_UNIVERSES        512
+
+// Art-Net field offsets
+#define ARTNET_OFFSET_OPCODE        8
+#define ARTNET_OFFSET_SEQUENCE      12
+#define ARTNET_OFFSET_SUBUNI        14
+#define ARTNET_OFFSET_NET           15
+#define ARTNET_OFFSET_LENGTH        16
+
+// DDP field offsets
+#define DDP_OFFSET_FLAGS1           0
+#define DDP_OFFSET_FLAGS2           1
+#define DDP_OFFSET_TYPE             2
+#define DDP_OFFSET_ID               3
+#define DDP_OFFSET_CHANNEL_OFFSET   4
+#define DDP_OFFSET_DATA_LENGTH      8
+
+//-----------------------------------------------------------------------------
+static inline uint16_t ReadBE16 (const uint8_t * Data) { return uint16_t ((uint16_t (Data[0]) << 8) | Data[1]); }
+static inline uint16_t ReadLE16 (const uint8_t * Data) { return uint16_t ((uint16_t (Data[1]) << 8) | Data[0]); }
+static inline uint32_t ReadBE32 (const uint8_t * Data)
+{
+    return (uint32_t (Data[0]) << 24) | (uint32_t (Data[1]) << 16) | (uint32_t (Data[2]) << 8) | uint32_t (Data[3]);
+} // ReadBE32
+
+//-----------------------------------------------------------------------------
+bool DecodeE131Data (const uint8_t * Packet, size_t PacketLength, E131DataFrame_t & Frame)
+{
+    bool Response = false;
+
+    do // once
+    {
+        if ((nullptr == Packet) || (PacketLength < E131_HEADER_SIZE))
+        {
+            // too short
+            break;
+        }
+
+        if (0 != memcmp (&Packet[E131_OFFSET_ACN_ID], E131_ACN_ID, sizeof (E131_ACN_ID)))
+        {
+            // not an ACN packet
+            break;
+        }
+
+        if ((E131_VECTOR_ROOT_DATA        != ReadBE32 (&Packet[E131_OFFSET_ROOT_VECTOR]))  ||
+            (E131_VECTOR_FRAME_DATA       != ReadBE32 (&Packet[E131_OFFSET_FRAME_VECTOR])) ||
+            (E131_VECTOR_DMP_SET_PROPERTY != Packet[E131_OFFSET_DMP_VECTOR]))
+        {
+            // unsupported vector
+            break;
+        }
+
+        uint16_t PropertyValueCount = ReadBE16 (&Packet[E131_OFFSET_VALUE_COUNT]);
+        if ((E131_DMX_START_CODE != Packet[E131_OFFSET_START_CODE]) || (0 == PropertyValueCount))
+        {
+            // not DMX data
+            break;
+        }
+
+        Frame.cid         = &Packet[E131_OFFSET_CID];
+        Frame.priority    = Packet[E131_OFFSET_PRIORITY];
+        Frame.syncAddress = ReadBE16 (&Packet[E131_OFFSET_SYNC_ADDRESS]);
+        Frame.sequence    = Packet[E131_OFFSET_SEQUENCE];
+        Frame.options     = Packet[E131_OFFSET_OPTIONS];
+        Frame.universe    = ReadBE16 (&Packet[E131_OFFSET_UNIVERSE]);
+        Frame.slots       = &Packet[E131_HEADER_SIZE];
+
+        // only trust the slot count as far as the datagram actually goes
+        uint32_t ClaimedSlots = uint32_t (PropertyValueCount) - 1;
+        uint32_t ActualSlots  = uint32_t (PacketLength - E131_HEADER_SIZE);
+        Frame.numSlots = (ClaimedSlots < ActualSlots) ? ClaimedSlots : ActualSlots;
+
+        Response = true;
+
+    } while (false);
+
+    return Response;
+
+} // DecodeE131Data
+
+//-----------------------------------------------------------------------------
+bool DecodeE131Sync (const uint8_t * Packet, size_t PacketLength, uint16_t & SyncAddress)
+{
+    bool Response = false;
+
+    do // once
+    {
+        if ((nullptr == Packet) || (PacketLength < E131_SYNC_PACKET_SIZE))
+        {
+            // too short
+            break;
+        }
+
+        if (0 != memcmp (&Packet[E131_OFFSET_ACN_ID], E131_ACN_ID, sizeof (E131_ACN_ID)))
+        {
+            // not an ACN packet
+            break;
+        }
+
+        if ((E131_VECTOR_ROOT_EXTENDED != ReadBE32 (&Packet[E131_OFFSET_ROOT_VECTOR])) ||
+            (E131_VECTOR_EXTENDED_SYNC != ReadBE32 (&Packet[E131_OFFSET_FRAME_VECTOR])))
+        {
+            // not a sync packet
+            break;
+        }
+
+        SyncAddress = ReadBE16 (&Packet[E131_OFFSET_SYNC_SYNC_ADDRESS]);
+        Response = true;
+
+    } while (false);
+
+    return Response;
+
+} // DecodeE131Sync
+
+//-----------------------------------------------------------------------------
+bool DecodeE131Discovery (const uint8_t * Packet, size_t PacketLength, E131DiscoveryFrame_t & Frame)
+{
+    bool Response = false;
+
+    do // once
+    {
+        if ((nullptr == Packet) || (PacketLength < E131_DISCOVERY_HEADER_SIZE))
+        {
+            // too short
+            break;
+        }
+
+        if (0 != memcmp (&Packet[E131_OFFSET_ACN_ID], E131_ACN_ID, sizeof (E131_ACN_ID)))
+        {
+            // not an ACN packet
+            break;
+        }
+
+        if ((E131_VECTOR_ROOT_EXTENDED      != ReadBE32 (&Packet[E131_OFFSET_ROOT_VECTOR]))  ||
+            (E131_VECTOR_EXTENDED_DISCOVERY != ReadBE32 (&Packet[E131_OFFSET_FRAME_VECTOR])) ||
+            (E131_VECTOR_DISCOVERY_LIST     != ReadBE32 (&Packet[E131_OFFSET_DISCOVERY_VECTOR])))
+        {
+            // not a universe discovery packet
+            break;
+        }
+
+        Frame.cid          = &Packet[E131_OFFSET_CID];
+        Frame.sourceName   = &Packet[E131_OFFSET_DISCOVERY_SOURCE_NAME];
+        Frame.page         = Packet[E131_OFFSET_DISCOVERY_PAGE];
+        Frame.lastPage     = Packet[E131_OFFSET_DISCOVERY_LAST_PAGE];
+        Frame.universeList = &Packet[E131_DISCOVERY_HEADER_SIZE];
+
+        // a page lists at most 512 universes. A trailing odd byte is ignored.
+        uint32_t ListEntries = uint32_t (PacketLength - E131_DISCOVERY_HEADER_SIZE) / 2;
+        Frame.numUniverses = (ListEntries < E131_DISCOVERY_MAX_UNIVERSES) ? ListEntries : E131_DISCOVERY_MAX_UNIVERSES;
+
+        Response = true;
+
+    } while (false);
+
+    return Response;
+
+} // DecodeE131Discovery
+
+//-----------------------------------------------------------------------------
+uint16_t E131DiscoveryUniverse (const E131DiscoveryFrame_t & Frame, uint32_t Index)
+{
+    return (Index < Frame.numUniverses) ? ReadBE16 (&Frame.universeList[Index * 2]) : 0;
+
+} // E131DiscoveryUniverse
+
+//-----------------------------------------------------------------------------
+uint16_t DecodeArtnetOpCode (const uint8_t * Packet, size_t PacketLength)
+{
+    uint16_t Response = ARTNET_OP_NONE;
+
+    if ((nullptr != Packet) &&
+        (PacketLength >= ARTNET_HEADER_SIZE) &&
+        (0 == memcmp (Packet, ARTNET_ID, sizeof (ARTNET_ID))))
+    {
+        Response = ReadLE16 (&Packet[ARTNET_OFFSET_OPCODE]);
+    }
+
+    return Response;
+
+} // DecodeArtnetOpCode
+
+//-----------------------------------------------------------------------------
+bool DecodeArtDmx (const uint8_t * Packet, size_t PacketLength, ArtDmxFrame_t & Frame)
+{
+    bool Response = false;
+
+    do // once
+    {
+        if ((nullptr == Packet) || (PacketLength < ARTNET_DMX_HEADER_SIZE))
+        {
+            // too short
+            break;
+        }
+
+        Frame.sequence = Packet[ARTNET_OFFSET_SEQUENCE];
+        Frame.universe = uint16_t ((uint16_t (Packet[ARTNET_OFFSET_NET] & 0x7f) << 8) | Packet[ARTNET_OFFSET_SUBUNI]);
+        Frame.slots    = &Packet[ARTNET_DMX_HEADER_SIZE];
+
+        // the length field is big endian. Trust it only as far as the datagram goes.
+        uint32_t ClaimedSlots = ReadBE16 (&Packet[ARTNET_OFFSET_LENGTH]);
+        uint32_t ActualSlots  = uint32_t (PacketLength - ARTNET_DMX_HEADER_SIZE);
+        Frame.numSlots = (ClaimedSlots < ActualSlots) ? ClaimedSlots : ActualSlots;
+
+        Response = true;
+
+    } while (false);
+
+    return Response;
+
+} // DecodeArtDmx
+
+//-----------------------------------------------------------------------------
+bool DecodeDdp (const uint8_t * Packet, size_t PacketLength, DdpFrame_t & Frame)
+{
+    bool Response = false;
+
+    do // once
+    {
+        if ((nullptr == Packet) || (PacketLength < DDP_HEADER_SIZE))
+        {
+            // too short
+            break;
+        }
+
+        Frame.flags1 = Packet[DDP_OFFSET_FLAGS1];
+        if ((Frame.flags1 & DDP_FLAGS1_VERMASK) != DDP_FLAGS1_VER1)
+        {
+            // unsupported version
+            break;
+        }
+
+        Frame.headerLength = DDP_HEADER_SIZE;
+        if (Frame.flags1 & DDP_FLAGS1_TIME)
+        {
+            Frame.headerLength += DDP_TIMECODE_SIZE;
+            if (PacketLength < Frame.headerLength)
+            {
+                // too short for its time code
+                break;
+            }
+        }
+
+        Frame.flags2        = Packet[DDP_OFFSET_FLAGS2];
+        Frame.type          = Packet[DDP_OFFSET_TYPE];
+        Frame.id            = Packet[DDP_OFFSET_ID];
+        Frame.channelOffset = ReadBE32 (&Packet[DDP_OFFSET_CHANNEL_OFFSET]);
+        Frame.data          = &Packet[Frame.headerLength];
+
+        // what the datagram really holds. dataLen is only a claim.
+        uint32_t ClaimedLength = ReadBE16 (&Packet[DDP_OFFSET_DATA_LENGTH]);
+        uint32_t PayloadLength = uint32_t (PacketLength - Frame.headerLength);
+        Frame.dataTruncated    = (ClaimedLength > PayloadLength);
+        Frame.dataLength       = Frame.dataTruncated ? PayloadLength : ClaimedLength;
+
+        Response = true;
+
+    } while (false);
+
+    return Response;
+
+} // DecodeDdp
+
+//-----------------------------------------------------------------------------
+uint32_t CopySlots (uint8_t * Destination, const uint8_t * Slots, uint32_t NumSlots, uint32_t SourceOffset, uint32_t BytesToCopy)
+{
+    uint32_t Response = 0;
+
+    if ((nullptr != Destination) && (nullptr != Slots) && (NumSlots > SourceOffset))
+    {
+        uint32_t SlotsAvailable = NumSlots - SourceOffset;
+        Response = (BytesToCopy < SlotsAvailable) ? BytesToCopy : SlotsAvailable;
+        memcpy (Destination, &Slots[SourceOffset], Response);
+    }
+
+    return Response;
+
+} // CopySlots
@@ -0,0 +1,131 @@
+#pragma once
+/*
+* InputPacketDecode.hpp - Decode and copy helpers for the network protocols
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   Everything needed to turn a received E1.31, Art-Net or DDP datagram into
+*   a description of its slot data. Nothing in here depends on the Arduino
+*   framework so it can be built and exercised on a host.
+*
+*   The decoders never read past PacketLength. Every length in a decoded
+*   frame has already been clamped to what the datagram actually holds.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// E1.31
+//-----------------------------------------------------------------------------
+#define E131_VECTOR_ROOT_DATA           0x00000004
+#define E131_VECTOR_ROOT_EXTENDED       0x00000008
+#define E131_VECTOR_FRAME_DATA          0x00000002
+#define E131_VECTOR_EXTENDED_SYNC       0x00000001
+#define E131_VECTOR_EXTENDED_DISCOVERY  0x00000002
+#define E131_VECTOR_DISCOVERY_LIST      0x00000001
+#define E131_VECTOR_DMP_SET_PROPERTY    0x02
+#define E131_DMX_START_CODE             0x00
+#define E131_CID_SIZE                   16
+#define E131_HEADER_SIZE                126     // everything up to and including the DMX start code
+#define E131_SYNC_PACKET_SIZE           49
+#define E131_DISCOVERY_HEADER_SIZE      120     // everything up to the universe list
+#define E131_DISCOVERY_UNIVERSE         64214   // sources announce their universes here
+#define E131_SOURCE_NAME_SIZE           64
+
+typedef struct
+{
+    const uint8_t * cid;            ///< E131_CID_SIZE bytes
+    uint8_t         priority;
+    uint16_t        syncAddress;
+    uint8_t         sequence;
+    uint8_t         options;
+    uint16_t        universe;
+    const uint8_t * slots;          ///< First slot after the start code
+    uint32_t        numSlots;
+} E131DataFrame_t;
+
+bool DecodeE131Data (const uint8_t * Packet, size_t PacketLength, E131DataFrame_t & Frame);
+typedef struct
+{
+    const uint8_t * cid;            ///< E131_CID_SIZE bytes
+    const uint8_t * sourceName;     ///< E131_SOURCE_NAME_SIZE bytes. Not always null terminated
+    uint8_t         page;
+    uint8_t         lastPage;
+    const uint8_t * universeList;   ///< numUniverses big endian universe numbers
+    uint32_t        numUniverses;
+} E131DiscoveryFrame_t;
+
+bool     DecodeE131Sync      (const uint8_t * Packet, size_t PacketLength, uint16_t & SyncAddress);
+bool     DecodeE131Discovery (const uint8_t * Packet, size_t PacketLength, E131DiscoveryFrame_t & Frame);
+uint16_t E131DiscoveryUniverse (const E131DiscoveryFrame_t & Frame, uint32_t Index);
+
+//-----------------------------------------------------------------------------
+// Art-Net
+//-----------------------------------------------------------------------------
+#define ARTNET_HEADER_SIZE          10
+#define ARTNET_DMX_HEADER_SIZE      18
+#define ARTNET_SYNC_PACKET_SIZE     14
+#define ARTNET_OP_NONE              0x0000
+
+typedef struct
+{
+    uint8_t         sequence;
+    uint16_t        universe;       ///< 15 bit port address
+    const uint8_t * slots;
+    uint32_t        numSlots;
+} ArtDmxFrame_t;
+
+uint16_t DecodeArtnetOpCode (const uint8_t * Packet, size_t PacketLength);  ///< ARTNET_OP_NONE if not Art-Net
+bool     DecodeArtDmx       (const uint8_t * Packet, size_t PacketLength, ArtDmxFrame_t & Frame);
+
+//-----------------------------------------------------------------------------
+// DDP
+//-----------------------------------------------------------------------------
+#define DDP_HEADER_SIZE     10
+#define DDP_TIMECODE_SIZE   4
+
+#define DDP_FLAGS1_VERMASK  0xc0   // version mask
+#define DDP_FLAGS1_VER1     0x40   // version=1
+#define DDP_FLAGS1_PUSH     0x01
+#define DDP_FLAGS1_QUERY    0x02
+#define DDP_FLAGS1_REPLY    0x04
+#define DDP_FLAGS1_STORAGE  0x08
+#define DDP_FLAGS1_TIME     0x10
+#define DDP_FLAGS1_DATAMASK (DDP_FLAGS1_QUERY | DDP_FLAGS1_REPLY | DDP_FLAGS1_STORAGE | DDP_FLAGS1_TIME)
+#define DDP_FLAGS1_DATA     0x00
+
+typedef struct
+{
+    uint8_t         flags1;
+    uint8_t         flags2;
+    uint8_t         type;
+    uint8_t         id;
+    uint32_t        channelOffset;
+    uint32_t        headerLength;   ///< Includes the time code if there is one
+    uint32_t        dataLength;     ///< dataLen clamped to the payload
+    bool            dataTruncated;  ///< dataLen claimed more than the datagram holds
+    const uint8_t * data;
+} DdpFrame_t;
+
+bool DecodeDdp (const uint8_t * Packet, size_t PacketLength, DdpFrame_t & Frame);
+
+//-----------------------------------------------------------------------------
+/*
+    Copy the part of a universe that lands in the output. SourceOffset is
+    the first slot we use and BytesToCopy is the room left in the
+    destination for this universe. Returns the number of bytes copied.
+*/
+uint32_t CopySlots (uint8_t * Destination, const uint8_t * Slots, uint32_t NumSlots, uint32_t SourceOffset, uint32_t BytesToCopy);
@@ -0,0 +1,174 @@
+/*
+* UniverseLoss.cpp - What to do with a universe that stops receiving data
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "UniverseLoss.hpp"
+
+//-----------------------------------------------------------------------------
+void c_UniverseLoss::GetConfig (JsonObject & jsonConfig)
+{
+    // DEBUG_START;
+
+    jsonConfig[CN_loss_action]  = LossAction;
+    jsonConfig[CN_loss_timeout] = TimeoutMS;
+    jsonConfig[CN_loss_fade]    = FadeTimeMS;
+
+    // DEBUG_END;
+
+} // GetConfig
+
+//-----------------------------------------------------------------------------
+bool c_UniverseLoss::SetConfig (JsonObject & jsonConfig)
+{
+    // DEBUG_START;
+
+    setFromJSON (LossAction, jsonConfig, CN_loss_action);
+    setFromJSON (TimeoutMS,  jsonConfig, CN_loss_timeout);
+    setFromJSON (FadeTimeMS, jsonConfig, CN_loss_fade);
+
+    if (LossAction >= LossAction_End)
+    {
+        logcon (String (F ("* Invalid universe loss action. Using hold.")));
+        LossAction = LossAction_Default;
+    }
+
+    TimeoutMS  = max (TimeoutMS, uint32_t (UNIVERSE_LOSS_MIN_TIMEOUT_MS));
+    FadeTimeMS = min (FadeTimeMS, uint32_t (UNIVERSE_LOSS_MAX_FADE_MS));
+
+    // DEBUG_END;
+
+    return true;
+
+} // SetConfig
+
+//-----------------------------------------------------------------------------
+void c_UniverseLoss::Reset (UniverseLoss_t & Universe)
+{
+    // DEBUG_START;
+
+    Universe.LastDataTime = millis ();
+    Universe.State        = LossState_NoData;
+    Universe.LastFadeStep = 0;
+    Universe.Losses       = 0;
+
+    // DEBUG_END;
+
+} // Reset
+
+//-----------------------------------------------------------------------------
+/*
+    Called from the driver's Process () for every universe. Data is the
+    universe in the input buffer. BackData is the same universe in a sync
+    back buffer (nullptr if there is none) so a later latch does not bring
+    stale data back.
+
+    The fade scales what is in the buffer by remaining / previously
+    remaining each step. That needs no copy of the last good frame and
+    lands on black at the end of the fade.
+*/
+void c_UniverseLoss::Poll (UniverseLoss_t & Universe, uint8_t * Data, uint8_t * BackData, uint32_t Length, uint32_t now)
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        uint32_t LastDataTime = Universe.LastDataTime;
+        uint8_t  State        = Universe.State;
+        uint32_t QuietTime    = now - LastDataTime;
+
+        if ((LossState_Live == State) && (QuietTime > TimeoutMS))
+        {
+            ++Universe.Losses;
+            Universe.LastFadeStep = 0;
+
+            if (LossAction_Hold == LossAction)
+            {
+                State = LossState_Held;
+            }
+            else if ((LossAction_Fade == LossAction) && (0 != FadeTimeMS))
+            {
+                State = LossState_Fading;
+            }
+            else
+            {
+                Scale (Data, Length, 0);
+                Scale (BackData, Length, 0);
+                State = LossState_Dark;
+            }
+        }
+        else if ((LossState_Fading == State) && (QuietTime > TimeoutMS))
+        {
+            uint32_t FadeElapsed = QuietTime - TimeoutMS;
+            if (FadeElapsed >= FadeTimeMS)
+            {
+                Scale (Data, Length, 0);
+                Scale (BackData, Length, 0);
+                State = LossState_Dark;
+            }
+            else if ((FadeElapsed - Universe.LastFadeStep) >= UNIVERSE_LOSS_FADE_STEP_MS)
+            {
+                uint32_t Factor = ((FadeTimeMS - FadeElapsed) << 16) / (FadeTimeMS - Universe.LastFadeStep);
+                Scale (Data, Length, Factor);
+                Scale (BackData, Length, Factor);
+                Universe.LastFadeStep = FadeElapsed;
+            }
+        }
+        else
+        {
+            // nothing changed
+            break;
+        }
+
+        // the receive path may have refreshed the universe while we were working
+        if (LastDataTime == Universe.LastDataTime)
+        {
+            Universe.State = State;
+        }
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // Poll
+
+//-----------------------------------------------------------------------------
+/*
+    Factor is 16.16 fixed point and never more than 1.0
+*/
+void c_UniverseLoss::Scale (uint8_t * Data, uint32_t Length, uint32_t Factor)
+{
+    // DEBUG_START;
+
+    if (nullptr != Data)
+    {
+        if (0 == Factor)
+        {
+            memset (Data, 0x00, Length);
+        }
+        else
+        {
+            for (uint32_t Index = 0; Index < Length; ++Index)
+            {
+                Data[Index] = uint8_t ((uint32_t (Data[Index]) * Factor) >> 16);
+            }
+        }
+    }
+
+    // DEBUG_END;
+
+} // Scale
@@ -0,0 +1,97 @@
+#pragma once
+/*
+* UniverseLoss.hpp - What to do with a universe that stops receiving data
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   Shared by the universe based inputs. Each universe carries a
+*   UniverseLoss_t. The receive path stamps it and the driver's Process ()
+*   polls it. A universe that has been quiet for the loss timeout is stale
+*   and, depending on the configured action, keeps its last good frame,
+*   fades to black or is blanked right away. Only the stale universe is
+*   touched. The rest of the buffer keeps running.
+*
+*   A blanked or faded universe lets a lower layer (for example an effect
+*   on the secondary input) show through the input compositor.
+*/
+
+#include "../ESPixelStick.h"
+
+class c_UniverseLoss
+{
+public:
+
+    enum e_LossAction
+    {
+        LossAction_Hold = 0,    ///< Keep the last good frame
+        LossAction_Fade,        ///< Fade to black over FadeTimeMS
+        LossAction_Blank,       ///< Go to black right away
+        LossAction_End,
+        LossAction_Default = LossAction_Hold,
+    };
+
+    enum e_LossState
+    {
+        LossState_NoData = 0,   ///< Nothing received since the last reset
+        LossState_Live,
+        LossState_Held,         ///< Stale. Last good frame is being held
+        LossState_Fading,
+        LossState_Dark,         ///< Stale. Faded or blanked
+    };
+
+    typedef struct
+    {
+        volatile uint32_t LastDataTime;     ///< millis () of the last data for this universe
+        volatile uint8_t  State;            ///< e_LossState
+        uint32_t          LastFadeStep;     ///< ms into the fade at the last step
+        uint32_t          Losses;           ///< Times this universe has gone stale
+    } UniverseLoss_t;
+
+    c_UniverseLoss () {}
+    virtual ~c_UniverseLoss () {}
+
+    void GetConfig (JsonObject & jsonConfig);
+    bool SetConfig (JsonObject & jsonConfig);
+    void Reset     (UniverseLoss_t & Universe);
+    void Poll      (UniverseLoss_t & Universe, uint8_t * Data, uint8_t * BackData, uint32_t Length, uint32_t now);
+    void GetDriverName (String & Name) { Name = "UniverseLoss"; }
+
+    /// Call from the receive path after the universe has been written
+    inline void DataArrived (UniverseLoss_t & Universe, uint32_t now)
+    {
+        Universe.LastDataTime = now;
+        Universe.State        = LossState_Live;
+    }
+
+    inline bool IsStale (UniverseLoss_t & Universe)
+    {
+        return LossState_Live != Universe.State;
+    }
+
+private:
+
+#define UNIVERSE_LOSS_DEFAULT_TIMEOUT_MS    2500    // E131_NETWORK_DATA_LOSS_TIMEOUT
+#define UNIVERSE_LOSS_MIN_TIMEOUT_MS        100
+#define UNIVERSE_LOSS_DEFAULT_FADE_MS       2000
+#define UNIVERSE_LOSS_MAX_FADE_MS           60000
+#define UNIVERSE_LOSS_FADE_STEP_MS          20
+
+    uint8_t     LossAction  = LossAction_Default;
+    uint32_t    TimeoutMS   = UNIVERSE_LOSS_DEFAULT_TIMEOUT_MS;
+    uint32_t    FadeTimeMS  = UNIVERSE_LOSS_DEFAULT_FADE_MS;
+
+    void Scale (uint8_t * Data, uint32_t Length, uint32_t Factor);
+
+}; // c_UniverseLoss
@@ -0,0 +1,309 @@
+/*
+* UdpRxTask.cpp - Receive pipeline for UDP based inputs
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "UdpRxTask.hpp"
+
+#ifdef ARDUINO_ARCH_ESP32
+//----------------------------------------------------------------------------
+static void UdpRxTaskHandler (void * pvParameters)
+{
+    c_UdpRxTask * pUdpRxTask = reinterpret_cast <c_UdpRxTask*> (pvParameters);
+
+    do
+    {
+        // sleep until Enqueue says there is work
+        ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+        pUdpRxTask->ProcessQueue ();
+
+    } while (true);
+
+} // UdpRxTaskHandler
+#endif // def ARDUINO_ARCH_ESP32
+
+//-----------------------------------------------------------------------------
+c_UdpRxTask::c_UdpRxTask ()
+{
+    memset ((void*)&EnqueueStats, 0x00, sizeof (EnqueueStats));
+    memset ((void*)&ProcessStats, 0x00, sizeof (ProcessStats));
+
+#ifdef ARDUINO_ARCH_ESP32
+    HandlerLock = xSemaphoreCreateMutex ();
+#endif // def ARDUINO_ARCH_ESP32
+
+} // c_UdpRxTask
+
+//-----------------------------------------------------------------------------
+c_UdpRxTask::~c_UdpRxTask ()
+{
+    // DEBUG_START;
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (NULL != RxTaskHandle)
+    {
+        vTaskDelete (RxTaskHandle);
+        RxTaskHandle = NULL;
+    }
+
+    if (nullptr != Queue)
+    {
+        // give the buffers that are still queued back to lwIP
+        for (uint32_t Index = QueueTail; Index != QueueHead; Index = (Index + 1) % UDP_RX_QUEUE_SIZE)
+        {
+            Queue[Index].RxBuffer->~AsyncUDPPacket ();
+        }
+        free (Queue);
+        Queue = nullptr;
+    }
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // ~c_UdpRxTask
+
+//-----------------------------------------------------------------------------
+void c_UdpRxTask::Begin ()
+{
+    // DEBUG_START;
+
+#ifdef ARDUINO_ARCH_ESP32
+    do // once
+    {
+        if (nullptr != Queue)
+        {
+            // already running
+            break;
+        }
+
+        Queue = (RxDescriptor_t *)malloc (sizeof (RxDescriptor_t) * UDP_RX_QUEUE_SIZE);
+        if (nullptr == Queue)
+        {
+            logcon (String (F ("ERROR: Could not allocate the UDP receive queue. Packets will be processed in the callback.")));
+            break;
+        }
+        memset ((void*)Queue, 0x00, sizeof (RxDescriptor_t) * UDP_RX_QUEUE_SIZE);
+
+        xTaskCreatePinnedToCore (UdpRxTaskHandler, "UdpRxTask", UDP_RX_TASK_STACK, this, ESP_TASK_PRIO_MIN + 4, &RxTaskHandle, UDP_RX_TASK_CORE);
+        if (NULL == RxTaskHandle)
+        {
+            logcon (String (F ("ERROR: Could not start the UDP receive task. Packets will be processed in the callback.")));
+            free (Queue);
+            Queue = nullptr;
+        }
+
+    } while (false);
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // Begin
+
+//-----------------------------------------------------------------------------
+void c_UdpRxTask::GetStatus (JsonObject & json)
+{
+    // DEBUG_START;
+
+    JsonObject RxStatus = json.createNestedObject (F ("udprx"));
+
+    uint32_t Packets = ProcessStats.Packets;
+
+    RxStatus[F ("packets")]      = Packets;
+    RxStatus[F ("dropped")]      = EnqueueStats.Dropped;
+    RxStatus[F ("maxdepth")]     = EnqueueStats.MaxDepth;
+    RxStatus[F ("maxprocessus")] = ProcessStats.MaxProcessUS;
+    RxStatus[F ("avgprocessus")] = (0 == Packets) ? 0 : uint32_t (ProcessStats.TotalProcessUS / Packets);
+
+    // DEBUG_END;
+
+} // GetStatus
+
+//-----------------------------------------------------------------------------
+/*
+    Called from the AsyncUDP callback. Keep this short. Take a reference on
+    the lwIP buffer and notify the receive task. The data is not copied.
+*/
+void c_UdpRxTask::Enqueue (UdpRxHandler_t Handler, void * Context, AsyncUDPPacket & Packet)
+{
+    // DEBUG_START;
+
+    uint32_t ArrivalUS = micros ();
+
+    do // once
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        if (nullptr != Queue)
+        {
+            uint32_t Head     = QueueHead.load (std::memory_order_relaxed);
+            uint32_t NextHead = (Head + 1) % UDP_RX_QUEUE_SIZE;
+            uint32_t Tail     = QueueTail.load (std::memory_order_acquire);
+            if (NextHead == Tail)
+            {
+                // the task is not keeping up
+                ++EnqueueStats.Dropped;
+                break;
+            }
+
+            RxDescriptor_t & Descriptor = Queue[Head];
+
+            // the copy constructor takes a reference on the pbuf. The
+            // destructor releases it once the handler is done with it.
+            Descriptor.RxBuffer = new (Descriptor.RxBufferStorage) AsyncUDPPacket (Packet);
+
+            Descriptor.Context            = Context;
+            Descriptor.Packet.data        = Descriptor.RxBuffer->data ();
+            Descriptor.Packet.length      = Descriptor.RxBuffer->length ();
+            Descriptor.Packet.remoteIP    = Packet.remoteIP ();
+            Descriptor.Packet.remotePort  = Packet.remotePort ();
+            Descriptor.Packet.isBroadcast = Packet.isBroadcast () || Packet.isMulticast ();
+            Descriptor.Packet.arrivalUS   = ArrivalUS;
+            Descriptor.Handler.store (Handler, std::memory_order_relaxed);
+
+            // publish the entry
+            QueueHead.store (NextHead, std::memory_order_release);
+
+            uint32_t Depth = (NextHead + UDP_RX_QUEUE_SIZE - Tail) % UDP_RX_QUEUE_SIZE;
+            EnqueueStats.MaxDepth = max (EnqueueStats.MaxDepth, Depth);
+
+            xTaskNotifyGive (RxTaskHandle);
+            break;
+        }
+#endif // def ARDUINO_ARCH_ESP32
+
+        // no receive task. Process it right here.
+        UdpRxPacket_t RxPacket;
+        RxPacket.data        = Packet.data ();
+        RxPacket.length      = Packet.length ();
+        RxPacket.remoteIP    = Packet.remoteIP ();
+        RxPacket.remotePort  = Packet.remotePort ();
+        RxPacket.isBroadcast = Packet.isBroadcast () || Packet.isMulticast ();
+        RxPacket.arrivalUS   = ArrivalUS;
+
+        Lock ();
+        RunHandler (Handler, Context, RxPacket);
+        Unlock ();
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // Enqueue
+
+//-----------------------------------------------------------------------------
+///< Call with the lock held
+void c_UdpRxTask::RunHandler (UdpRxHandler_t Handler, void * Context, UdpRxPacket_t & Packet)
+{
+    uint32_t StartTimeUS = micros ();
+    Handler (Context, Packet);
+    uint32_t ProcessTimeUS = micros () - StartTimeUS;
+
+    ProcessStats.TotalProcessUS += ProcessTimeUS;
+    ProcessStats.MaxProcessUS = max (ProcessStats.MaxProcessUS, ProcessTimeUS);
+    ++ProcessStats.Packets;
+
+} // RunHandler
+
+#ifdef ARDUINO_ARCH_ESP32
+//-----------------------------------------------------------------------------
+void c_UdpRxTask::ProcessQueue ()
+{
+    uint32_t Tail = QueueTail.load (std::memory_order_relaxed);
+
+    while (Tail != QueueHead.load (std::memory_order_acquire))
+    {
+        RxDescriptor_t & Descriptor = Queue[Tail];
+
+        // read the handler under the lock. Once Purge () has been through
+        // the lock a purged entry can no longer be picked up.
+        Lock ();
+        UdpRxHandler_t Handler = Descriptor.Handler.load ();
+        if (nullptr != Handler)
+        {
+            RunHandler (Handler, Descriptor.Context, Descriptor.Packet);
+        }
+        Unlock ();
+
+        // hand the buffer back to lwIP
+        Descriptor.RxBuffer->~AsyncUDPPacket ();
+        Descriptor.RxBuffer = nullptr;
+
+        // release the slot
+        Tail = (Tail + 1) % UDP_RX_QUEUE_SIZE;
+        QueueTail.store (Tail, std::memory_order_release);
+    }
+
+} // ProcessQueue
+#endif // def ARDUINO_ARCH_ESP32
+
+//-----------------------------------------------------------------------------
+/*
+    Called by an object that registered a handler before it is deleted. The
+    socket must already be closed so no new packets can arrive for it.
+*/
+void c_UdpRxTask::Purge (void * Context)
+{
+    // DEBUG_START;
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (nullptr != Queue)
+    {
+        uint32_t Head = QueueHead.load (std::memory_order_acquire);
+        for (uint32_t Index = QueueTail.load (std::memory_order_acquire); Index != Head; Index = (Index + 1) % UDP_RX_QUEUE_SIZE)
+        {
+            if (Context == Queue[Index].Context)
+            {
+                Queue[Index].Handler.store (nullptr);
+            }
+        }
+
+        // wait for a handler that is already running to finish. Handlers
+        // are looked up under the lock, so none of the purged ones can start
+        // after this.
+        Lock ();
+        Unlock ();
+    }
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // Purge
+
+//-----------------------------------------------------------------------------
+/*
+    Keeps every handler out until Unlock (). Only the ESP32 needs it. The
+    ESP8266 runs the handlers from the SYS context, which never preempts
+    loop ().
+*/
+void c_UdpRxTask::Lock ()
+{
+#ifdef ARDUINO_ARCH_ESP32
+    xSemaphoreTake (HandlerLock, portMAX_DELAY);
+#endif // def ARDUINO_ARCH_ESP32
+
+} // Lock
+
+//-----------------------------------------------------------------------------
+void c_UdpRxTask::Unlock ()
+{
+#ifdef ARDUINO_ARCH_ESP32
+    xSemaphoreGive (HandlerLock);
+#endif // def ARDUINO_ARCH_ESP32
+
+} // Unlock
+
+// create a global instance of the UDP receive pipeline
+c_UdpRxTask UdpRxTask;
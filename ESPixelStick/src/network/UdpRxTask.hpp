@@ -0,0 +1,123 @@
+#pragma once
+/*
+* UdpRxTask.hpp - Receive pipeline for UDP based inputs
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   The AsyncUDP callbacks take a reference on the packet buffer lwIP
+*   received the datagram into and put it in a slot of a single producer /
+*   single consumer ring. Nothing is copied. A task pinned to the network
+*   core drains the ring, calls the protocol handler for each packet and
+*   then hands the buffer back to lwIP.
+*
+*   Handlers run with HandlerLock held. An input that has to replace
+*   something its handler uses (a buffer, a table) takes the lock with
+*   Lock (), swaps in the new object and releases the lock before freeing
+*   the old one.
+*
+*   On the ESP32 every AsyncUDP callback runs on the async_udp task, so all
+*   sockets together are still a single producer. Each statistic has a
+*   single writer: the callback counts what it could not queue, the task
+*   counts what it processed.
+*
+*   The ESP8266 has no tasks. The handler is called directly from Enqueue.
+*/
+
+#include "../ESPixelStick.h"
+
+#ifdef ESP32
+#   include <AsyncUDP.h>
+#   include <atomic>
+#elif defined (ESP8266)
+#   include <ESPAsyncUDP.h>
+#endif
+
+/// What a protocol handler gets to see of a received datagram
+typedef struct
+{
+    uint8_t   * data;
+    size_t      length;
+    IPAddress   remoteIP;
+    uint16_t    remotePort;
+    bool        isBroadcast;    ///< Broadcast or multicast
+    uint32_t    arrivalUS;      ///< micros () when the AsyncUDP callback saw it
+} UdpRxPacket_t;
+
+typedef void (*UdpRxHandler_t) (void * Context, UdpRxPacket_t & Packet);
+
+class c_UdpRxTask
+{
+public:
+    c_UdpRxTask ();
+    virtual ~c_UdpRxTask ();
+
+    void Begin     ();
+    void GetStatus (JsonObject & json);
+    void Enqueue   (UdpRxHandler_t Handler, void * Context, AsyncUDPPacket & Packet); ///< Call from the AsyncUDP callback
+    void Purge     (void * Context);                    ///< Forget queued packets for an object that is going away
+    void Lock      ();                                  ///< No handler runs until Unlock (). Do not call Purge while holding it
+    void Unlock    ();
+    void GetDriverName (String & Name) { Name = "UdpRxTask"; }
+
+#ifdef ARDUINO_ARCH_ESP32
+    void ProcessQueue ();                               ///< Runs on the receive task
+#endif // def ARDUINO_ARCH_ESP32
+
+private:
+
+#define UDP_RX_QUEUE_SIZE       8       // each queued packet holds one WiFi / lwIP receive buffer
+#define UDP_RX_TASK_CORE        0       // same core as the lwIP task
+#define UDP_RX_TASK_STACK       4096
+
+    /// Written by the AsyncUDP callback only
+    typedef struct
+    {
+        uint32_t    Dropped;        ///< Ring was full
+        uint32_t    MaxDepth;       ///< High water mark of the ring
+    } RxEnqueueStats_t;
+
+    /// Written by whoever runs the handlers only
+    typedef struct
+    {
+        uint32_t    Packets;
+        uint32_t    MaxProcessUS;   ///< Longest time spent in a handler
+        uint64_t    TotalProcessUS;
+    } RxProcessStats_t;
+
+    RxEnqueueStats_t        EnqueueStats;
+    RxProcessStats_t        ProcessStats;
+
+    void RunHandler (UdpRxHandler_t Handler, void * Context, UdpRxPacket_t & Packet);
+
+#ifdef ARDUINO_ARCH_ESP32
+    typedef struct
+    {
+        std::atomic<UdpRxHandler_t> Handler;
+        void          * Context;
+        UdpRxPacket_t   Packet;
+        AsyncUDPPacket * RxBuffer;  ///< Holds the reference on the lwIP buffer that Packet.data points into
+        alignas (AsyncUDPPacket) uint8_t RxBufferStorage[sizeof (AsyncUDPPacket)];
+    } RxDescriptor_t;
+
+    RxDescriptor_t        * Queue = nullptr;
+    std::atomic<uint32_t>   QueueHead {0};          ///< Next slot Enqueue fills. Written by the callback
+    std::atomic<uint32_t>   QueueTail {0};          ///< Next slot the task reads. Written by the task
+    TaskHandle_t            RxTaskHandle = NULL;
+    SemaphoreHandle_t       HandlerLock = NULL;
+#endif // def ARDUINO_ARCH_ESP32
+
+}; // c_UdpRxTask
+
+extern c_UdpRxTask UdpRxTask;
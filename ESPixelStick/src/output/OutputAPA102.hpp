@@ -42,7 +42,7 @@ public:
             void         GetDriverName (String & sDriverName) { sDriverName = String (F ("APA102")); }
     c_OutputMgr::e_OutputType GetOutputType () {return c_OutputMgr::e_OutputType::OutputType_APA102;} ///< Have the instance report its type.
     virtual void         GetStatus (ArduinoJson::JsonObject& jsonStatus);
-    virtual void         SetOutputBufferSize (uint16_t NumChannelsAvailable);
+    virtual void         SetOutputBufferSize (uint32_t NumChannelsAvailable);
 
 protected:
 
@@ -22,6 +22,7 @@
 
 #include "../ESPixelStick.h"
 #include "OutputCommon.hpp"
+#include "../service/LatencyTracker.hpp"
 
 extern "C" {
 #ifdef ARDUINO_ARCH_ESP8266
@@ -318,6 +319,8 @@ void c_OutputCommon::ReportNewFrame ()
 
     FrameCount++;
 
+    LatencyTracker.FrameStarted ();
+
     // DEBUG_END;
 
 } // ReportNewFrame
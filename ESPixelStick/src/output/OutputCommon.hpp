@@ -54,12 +54,12 @@ public:
     virtual void         GetDriverName (String & sDriverName) = 0;             ///< get the name for the instantiated driver
             OID_t        GetOutputChannelId () { return OutputChannelId; }     ///< return the output channel number
             uint8_t    * GetBufferAddress ()   { return pOutputBuffer;}        ///< Get the address of the buffer into which the E1.31 handler will stuff data
-            uint16_t     GetBufferUsedSize ()  { return OutputBufferSize;}     ///< Get the address of the buffer into which the E1.31 handler will stuff data
+            uint32_t     GetBufferUsedSize ()  { return OutputBufferSize;}     ///< Get the address of the buffer into which the E1.31 handler will stuff data
             OTYPE_t      GetOutputType ()      { return OutputType; }          ///< Have the instance report its type.
     virtual void         GetStatus (ArduinoJson::JsonObject & jsonStatus);
             void         SetOutputBufferAddress (uint8_t* pNewOutputBuffer) { pOutputBuffer = pNewOutputBuffer; }
-    virtual void         SetOutputBufferSize (uint16_t NewOutputBufferSize)  { OutputBufferSize = NewOutputBufferSize; };
-    virtual uint16_t     GetNumChannelsNeeded () = 0;
+    virtual void         SetOutputBufferSize (uint32_t NewOutputBufferSize)  { OutputBufferSize = NewOutputBufferSize; };
+    virtual uint32_t     GetNumChannelsNeeded () = 0;
     virtual void         PauseOutput () {}
 
 protected:
@@ -72,7 +72,7 @@ protected:
     bool        HasBeenInitialized         = false;
     uint32_t    FrameMinDurationInMicroSec = 20000;
     uint8_t   * pOutputBuffer              = nullptr;
-    uint16_t    OutputBufferSize           = 0;
+    uint32_t    OutputBufferSize           = 0;
     uint32_t    FrameCount                 = 0;
 
 #ifdef ARDUINO_ARCH_ESP8266
@@ -948,7 +948,7 @@ void c_OutputMgr::UpdateDisplayBufferReferences (void)
 {
     // DEBUG_START;
 
-    uint16_t OutputBufferOffset = 0;
+    uint32_t OutputBufferOffset = 0;
 
     // DEBUG_V (String ("        BufferSize: ") + String (sizeof(OutputBuffer)));
     // DEBUG_V (String ("OutputBufferOffset: ") + String (OutputBufferOffset));
@@ -956,9 +956,9 @@ void c_OutputMgr::UpdateDisplayBufferReferences (void)
     for (c_OutputCommon* pOutputChannel : pOutputChannelDrivers)
     {
         pOutputChannel->SetOutputBufferAddress (&OutputBuffer[OutputBufferOffset]);
-        uint16_t ChannelsNeeded     = pOutputChannel->GetNumChannelsNeeded ();
-        uint16_t AvailableChannels  = sizeof(OutputBuffer) - OutputBufferOffset;
-        uint16_t ChannelsToAllocate = min (ChannelsNeeded, AvailableChannels);
+        uint32_t ChannelsNeeded     = pOutputChannel->GetNumChannelsNeeded ();
+        uint32_t AvailableChannels  = sizeof(OutputBuffer) - OutputBufferOffset;
+        uint32_t ChannelsToAllocate = min (ChannelsNeeded, AvailableChannels);
 
         // DEBUG_V (String ("    ChannelsNeeded: ") + String (ChannelsNeeded));
         // DEBUG_V (String (" AvailableChannels: ") + String (AvailableChannels));
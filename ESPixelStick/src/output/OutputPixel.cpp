@@ -82,7 +82,7 @@ void c_OutputPixel::GetStatus (ArduinoJson::JsonObject& jsonStatus)
 } // GetStatus
 
 //----------------------------------------------------------------------------
-void c_OutputPixel::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputPixel::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
        // DEBUG_V (String ("NumChannelsAvailable: ") + String (NumChannelsAvailable));
@@ -45,8 +45,8 @@ public:
     virtual void         GetDriverName (String& sDriverName) = 0;
     virtual c_OutputMgr::e_OutputType GetOutputType () = 0;
     virtual void         GetStatus (ArduinoJson::JsonObject& jsonStatus);
-    uint16_t             GetNumChannelsNeeded () { return (pixel_count * NumIntensityBytesPerPixel); };
-    virtual void         SetOutputBufferSize (uint16_t NumChannelsAvailable);
+    uint32_t             GetNumChannelsNeeded () { return (pixel_count * NumIntensityBytesPerPixel); };
+    virtual void         SetOutputBufferSize (uint32_t NumChannelsAvailable);
     bool                 MoreDataToSend () { return _MoreDataToSend; }
     IRAM_ATTR void       StartNewFrame ();
     IRAM_ATTR uint8_t    GetNextIntensityToSend ();
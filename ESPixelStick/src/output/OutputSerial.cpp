@@ -404,7 +404,7 @@ void c_OutputSerial::GetStatus (ArduinoJson::JsonObject& jsonStatus)
 } // GetStatus
 
 //----------------------------------------------------------------------------
-void c_OutputSerial::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputSerial::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
     // DEBUG_V (String ("NumChannelsAvailable: ") + String (NumChannelsAvailable));
@@ -52,8 +52,8 @@ public:
     void Render ();                                        ///< Call from loop(),  renders output data
     void GetDriverName (String & sDriverName);
     void GetStatus (ArduinoJson::JsonObject& jsonStatus);
-    uint16_t GetNumChannelsNeeded () { return Num_Channels; }
-    void SetOutputBufferSize (uint16_t NumChannelsAvailable);
+    uint32_t GetNumChannelsNeeded () { return Num_Channels; }
+    void SetOutputBufferSize (uint32_t NumChannelsAvailable);
 
 #define GS_CHANNEL_LIMIT 2048
 
@@ -94,7 +94,7 @@ private:
     uint16_t        Num_Channels              = DEFAULT_NUM_CHANNELS;      // Number of data channels to transmit
 
     // non config data
-    volatile uint16_t        RemainingDataCount;
+    volatile uint32_t        RemainingDataCount;
     volatile uint8_t       * pNextChannelToSend;
     String                   OutputName;
 
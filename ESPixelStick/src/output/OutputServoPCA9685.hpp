@@ -52,7 +52,7 @@ public:
     void Render ();                                        ///< Call from loop(),  renders output data
     void GetDriverName (String& sDriverName);
     void GetStatus (ArduinoJson::JsonObject & jsonStatus) { c_OutputCommon::GetStatus (jsonStatus); }
-    uint16_t GetNumChannelsNeeded () { return Num_Channels; }
+    uint32_t GetNumChannelsNeeded () { return Num_Channels; }
 
 private:
 #   define OM_SERVO_PCA9685_CHANNEL_LIMIT           16
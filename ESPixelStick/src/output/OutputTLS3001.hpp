@@ -43,7 +43,7 @@ public:
     void                 GetDriverName (String& sDriverName) { sDriverName = String (F ("TLS3001")); }
     c_OutputMgr::e_OutputType GetOutputType () { return c_OutputMgr::e_OutputType::OutputType_TLS3001; } ///< Have the instance report its type.
     virtual void         GetStatus (ArduinoJson::JsonObject& jsonStatus);
-    virtual void         SetOutputBufferSize (uint16_t NumChannelsAvailable);
+    virtual void         SetOutputBufferSize (uint32_t NumChannelsAvailable);
 
 protected:
 
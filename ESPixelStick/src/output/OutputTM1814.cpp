@@ -73,7 +73,7 @@ void c_OutputTM1814::GetStatus (ArduinoJson::JsonObject& jsonStatus)
 } // GetStatus
 
 //----------------------------------------------------------------------------
-void c_OutputTM1814::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputTM1814::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
 
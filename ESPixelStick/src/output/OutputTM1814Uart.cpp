@@ -156,7 +156,7 @@ bool c_OutputTM1814Uart::SetConfig (ArduinoJson::JsonObject& jsonConfig)
 } // SetConfig
 
 //----------------------------------------------------------------------------
-void c_OutputTM1814Uart::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputTM1814Uart::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
 
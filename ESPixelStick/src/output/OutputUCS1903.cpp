@@ -77,7 +77,7 @@ void c_OutputUCS1903::GetStatus (ArduinoJson::JsonObject& jsonStatus)
 } // GetStatus
 
 //----------------------------------------------------------------------------
-void c_OutputUCS1903::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputUCS1903::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
 
@@ -46,7 +46,7 @@ public:
             void         GetDriverName (String & sDriverName) { sDriverName = String (F ("UCS1903")); }
     c_OutputMgr::e_OutputType GetOutputType () {return c_OutputMgr::e_OutputType::OutputType_UCS1903;} ///< Have the instance report its type.
     virtual void         GetStatus (ArduinoJson::JsonObject& jsonStatus);
-    virtual void         SetOutputBufferSize (uint16_t NumChannelsAvailable);
+    virtual void         SetOutputBufferSize (uint32_t NumChannelsAvailable);
 
 protected:
 
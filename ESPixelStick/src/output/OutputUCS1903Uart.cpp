@@ -187,7 +187,7 @@ bool c_OutputUCS1903Uart::SetConfig (ArduinoJson::JsonObject& jsonConfig)
 } // SetConfig
 
 //----------------------------------------------------------------------------
-void c_OutputUCS1903Uart::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputUCS1903Uart::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
     // DEBUG_V (String ("NumChannelsAvailable: ") + String (NumChannelsAvailable));
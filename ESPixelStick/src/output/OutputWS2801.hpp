@@ -40,7 +40,7 @@ public:
             void         GetDriverName (String & sDriverName) { sDriverName = String (F ("WS2801")); }
     c_OutputMgr::e_OutputType GetOutputType () {return c_OutputMgr::e_OutputType::OutputType_WS2801;} ///< Have the instance report its type.
     virtual void         GetStatus (ArduinoJson::JsonObject& jsonStatus);
-    virtual void         SetOutputBufferSize (uint16_t NumChannelsAvailable);
+    virtual void         SetOutputBufferSize (uint32_t NumChannelsAvailable);
 
 protected:
 #define WS2801_BIT_RATE                 (APB_CLK_FREQ/80)
@@ -75,7 +75,7 @@ void c_OutputWS2811::GetStatus (ArduinoJson::JsonObject& jsonStatus)
 } // GetStatus
 
 //----------------------------------------------------------------------------
-void c_OutputWS2811::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputWS2811::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
 
@@ -186,7 +186,7 @@ bool c_OutputWS2811Uart::SetConfig (ArduinoJson::JsonObject& jsonConfig)
 } // SetConfig
 
 //----------------------------------------------------------------------------
-void c_OutputWS2811Uart::SetOutputBufferSize (uint16_t NumChannelsAvailable)
+void c_OutputWS2811Uart::SetOutputBufferSize (uint32_t NumChannelsAvailable)
 {
     // DEBUG_START;
     // DEBUG_V (String ("NumChannelsAvailable: ") + String (NumChannelsAvailable));
@@ -22,10 +22,17 @@
 
 #include <Int64String.h>
 #include "../FileMgr.hpp"
+#include "FseqIndex.hpp"
 #include "../output/OutputMgr.hpp"
 #include "../network/NetworkMgr.hpp"
 #include <time.h>
 
+//-----------------------------------------------------------------------------
+static void FPPDiscoveryRxHandler (void * Context, UdpRxPacket_t & Packet)
+{
+    reinterpret_cast <c_FPPDiscovery*> (Context)->ProcessReceivedUdpPacket (Packet);
+} // FPPDiscoveryRxHandler
+
 #ifdef ARDUINO_ARCH_ESP32
 #   define FPP_TYPE_ID          0xC3
 #   define FPP_VARIANT_NAME     (String(CN_ESPixelStick) + "-ESP32")
@@ -100,7 +107,7 @@ void c_FPPDiscovery::NetworkStateChanged (bool NewNetworkState)
         if (!fail)
             logcon (String (F ("Listening on port ")) + String(FPP_DISCOVERY_PORT));
 
-        udp.onPacket (std::bind (&c_FPPDiscovery::ProcessReceivedUdpPacket, this, std::placeholders::_1));
+        udp.onPacket ([this] (AsyncUDPPacket & Packet) { UdpRxTask.Enqueue (&FPPDiscoveryRxHandler, this, Packet); });
 
         sendPingPacket ();
 
@@ -157,7 +164,7 @@ void c_FPPDiscovery::GetStatus (JsonObject & jsonStatus)
 } // GetStatus
 
 //-----------------------------------------------------------------------------
-void c_FPPDiscovery::ReadNextFrame (uint8_t * CurrentOutputBuffer, uint16_t CurrentOutputBufferSize)
+void c_FPPDiscovery::ReadNextFrame (uint8_t * CurrentOutputBuffer, uint32_t CurrentOutputBufferSize)
 {
     // DEBUG_START;
 
@@ -170,7 +177,7 @@ void c_FPPDiscovery::ReadNextFrame (uint8_t * CurrentOutputBuffer, uint16_t Curr
 } // ReadNextFrame
 
 //-----------------------------------------------------------------------------
-void c_FPPDiscovery::ProcessReceivedUdpPacket (AsyncUDPPacket UDPpacket)
+void c_FPPDiscovery::ProcessReceivedUdpPacket (UdpRxPacket_t & UDPpacket)
 {
     // DEBUG_START;
     do // once
@@ -182,9 +189,9 @@ void c_FPPDiscovery::ProcessReceivedUdpPacket (AsyncUDPPacket UDPpacket)
             break;
         }
 
-        FPPPacket* fppPacket = reinterpret_cast<FPPPacket*>(UDPpacket.data ());
-        // DEBUG_V (String ("Received UDP packet from: ") + UDPpacket.remoteIP ().toString ());
-        // DEBUG_V (String ("                 Sent to: ") + UDPpacket.localIP ().toString ());
+        FPPPacket* fppPacket = reinterpret_cast<FPPPacket*>(UDPpacket.data);
+        // DEBUG_V (String ("Received UDP packet from: ") + UDPpacket.remoteIP.toString ());
+        // DEBUG_V (String ("                 Sent to: ") + (UDPpacket.isBroadcast ? F ("broadcast / multicast") : F ("unicast")));
         // DEBUG_V (String ("         FPP packet_type: ") + String(fppPacket->packet_type));
 
         if ((fppPacket->header[0] != 'F') ||
@@ -213,14 +220,14 @@ void c_FPPDiscovery::ProcessReceivedUdpPacket (AsyncUDPPacket UDPpacket)
 
             case CTRL_PKT_SYNC:
             {
-                FPPMultiSyncPacket* msPacket = reinterpret_cast<FPPMultiSyncPacket*>(UDPpacket.data ());
+                FPPMultiSyncPacket* msPacket = reinterpret_cast<FPPMultiSyncPacket*>(UDPpacket.data);
                 // DEBUG_V (String (F ("msPacket->sync_type: ")) + String(msPacket->sync_type));
 
                 if (msPacket->sync_type == SYNC_FILE_SEQ)
                 {
                     // FSEQ type, not media
                     // DEBUG_V (String (F ("Received FPP FSEQ sync packet")));
-                    FppRemoteIp = UDPpacket.remoteIP ();
+                    FppRemoteIp = UDPpacket.remoteIP;
                     ProcessSyncPacket (msPacket->sync_action, String (msPacket->filename), msPacket->seconds_elapsed);
                 }
                 else if (msPacket->sync_type == SYNC_FILE_MEDIA)
@@ -255,7 +262,7 @@ void c_FPPDiscovery::ProcessReceivedUdpPacket (AsyncUDPPacket UDPpacket)
                 // DEBUG_V (String (F ("Ping Packet")));
 
                 MultiSyncStats.pktPing++;
-                FPPPingPacket* pingPacket = reinterpret_cast<FPPPingPacket*>(UDPpacket.data ());
+                FPPPingPacket* pingPacket = reinterpret_cast<FPPPingPacket*>(UDPpacket.data);
 
                 // DEBUG_V (String (F ("Ping Packet subtype: ")) + String (pingPacket->ping_subtype));
                 // DEBUG_V (String (F ("Ping Packet packet.versionMajor: ")) + String (pingPacket->versionMajor));
@@ -267,7 +274,7 @@ void c_FPPDiscovery::ProcessReceivedUdpPacket (AsyncUDPPacket UDPpacket)
                 {
                     // DEBUG_V (String (F ("FPP Ping discovery packet")));
                     // received a discover ping packet, need to send a ping out
-                    if (UDPpacket.isBroadcast () || UDPpacket.isMulticast ())
+                    if (UDPpacket.isBroadcast)
                     {
                         // DEBUG_V ("Broadcast Ping Response");
                         sendPingPacket ();
@@ -275,7 +282,7 @@ void c_FPPDiscovery::ProcessReceivedUdpPacket (AsyncUDPPacket UDPpacket)
                     else
                     {
                         // DEBUG_V ("Unicast Ping Response");
-                        sendPingPacket (UDPpacket.remoteIP ());
+                        sendPingPacket (UDPpacket.remoteIP);
                     }
                 }
                 else
@@ -402,7 +409,7 @@ void c_FPPDiscovery::ProcessBlankPacket ()
 
     if (IsEnabled)
     {
-        memset (OutputMgr.GetBufferAddress(), 0x0, OutputMgr.GetBufferUsedSize ());
+        InputMgr.ClearLayers ();
     }
     // DEBUG_END;
 } // ProcessBlankPacket
@@ -492,14 +499,14 @@ void c_FPPDiscovery::BuildFseqResponse (String fname, c_FileMgr::FileId fseq, St
     JsonObject JsonData = JsonDoc.to<JsonObject> ();
 
     FSEQRawHeader fsqHeader;
-    FileMgr.ReadSdFile (fseq, (byte*)&fsqHeader, sizeof (fsqHeader), 0);
+    FseqIndex.ReadHeader (fname, fseq, (byte*)&fsqHeader, sizeof (fsqHeader), 0);
 
     JsonData[F ("Name")]            = fname;
     JsonData[CN_Version]            = String (fsqHeader.majorVersion) + "." + String (fsqHeader.minorVersion);
     JsonData[F ("ID")]              = int64String (read64 (fsqHeader.id, 0));
     JsonData[F ("StepTime")]        = String (fsqHeader.stepTime);
     JsonData[F ("NumFrames")]       = String (read32 (fsqHeader.TotalNumberOfFramesInSequence, 0));
-    JsonData[F ("CompressionType")] = fsqHeader.compressionType;
+    JsonData[F ("CompressionType")] = FseqCompressionType (fsqHeader);
 
     char timeStr[32];
     memset (timeStr, 0, sizeof (timeStr));
@@ -534,11 +541,16 @@ void c_FPPDiscovery::BuildFseqResponse (String fname, c_FileMgr::FileId fseq, St
 
         uint8_t* RangeDataBuffer = (uint8_t*)malloc (sizeof(FSEQRawRangeEntry) * fsqHeader.numSparseRanges);
         FSEQRawRangeEntry* CurrentFSEQRangeEntry = (FSEQRawRangeEntry*)RangeDataBuffer;
+        int NumRangesRead = 0;
 
-        FileMgr.ReadSdFile (fseq, RangeDataBuffer, sizeof (FSEQRawRangeEntry), fsqHeader.numCompressedBlocks * 8 + 32);
+        if (nullptr != RangeDataBuffer)
+        {
+            size_t TableSize = sizeof (FSEQRawRangeEntry) * fsqHeader.numSparseRanges;
+            NumRangesRead = FseqIndex.ReadHeader (fname, fseq, RangeDataBuffer, TableSize, FseqNumCompressedBlocks (fsqHeader) * sizeof (FSEQRawCompressedBlockEntry) + sizeof (FSEQRawHeader)) / sizeof (FSEQRawRangeEntry);
+        }
 
         for (int CurrentRangeIndex = 0;
-             CurrentRangeIndex < fsqHeader.numSparseRanges;
+             CurrentRangeIndex < NumRangesRead;
              CurrentRangeIndex++, CurrentFSEQRangeEntry++)
         {
             uint32_t RangeStart  = read24 (CurrentFSEQRangeEntry->Start);
@@ -576,7 +588,7 @@ void c_FPPDiscovery::BuildFseqResponse (String fname, c_FileMgr::FileId fseq, St
 
         while (FileOffsetToCurrentHeaderRecord < FileOffsetToStartOfSequenceData)
         {
-            FileMgr.ReadSdFile (fseq, (byte*)FSEQVariableDataHeaderBuffer, sizeof (FSEQRawVariableDataHeader), FileOffsetToCurrentHeaderRecord);
+            FseqIndex.ReadHeader (fname, fseq, (byte*)FSEQVariableDataHeaderBuffer, sizeof (FSEQRawVariableDataHeader), FileOffsetToCurrentHeaderRecord);
 
             int VariableDataHeaderTotalLength = read16 ((uint8_t*)&(pCurrentVariableHeader->length));
             int VariableDataHeaderDataLength  = VariableDataHeaderTotalLength - sizeof (FSEQRawVariableDataHeader);
@@ -588,7 +600,7 @@ void c_FPPDiscovery::BuildFseqResponse (String fname, c_FileMgr::FileId fseq, St
                 char * VariableDataHeaderDataBuffer = (char*)malloc (VariableDataHeaderDataLength + 1);
                 memset (VariableDataHeaderDataBuffer, 0x00, VariableDataHeaderDataLength + 1);
 
-                FileMgr.ReadSdFile (fseq, (byte*)VariableDataHeaderDataBuffer, VariableDataHeaderDataLength, FileOffsetToCurrentHeaderRecord);
+                FseqIndex.ReadHeader (fname, fseq, (byte*)VariableDataHeaderDataBuffer, VariableDataHeaderDataLength, FileOffsetToCurrentHeaderRecord);
 
                 JsonObject JsonDataHeader = JsonDataHeaders.createNestedObject ();
                 JsonDataHeader[HeaderTypeCode] = String (VariableDataHeaderDataBuffer);
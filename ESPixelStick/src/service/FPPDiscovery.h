@@ -34,13 +34,13 @@
 #endif
 
 #include <ESPAsyncWebServer.h>
+#include "../network/UdpRxTask.hpp"
 
 class c_FPPDiscovery
 {
 private:
 
     AsyncUDP udp;
-    void ProcessReceivedUdpPacket (AsyncUDPPacket _packet);
     void ProcessSyncPacket (uint8_t action, String filename, float seconds_elapsed);
     void ProcessBlankPacket ();
     bool PlayingFile () 
@@ -103,6 +103,7 @@ private:
 #   define CTRL_PKT_FPPCOMMAND  6
 
 public:
+    void ProcessReceivedUdpPacket (UdpRxPacket_t & Packet);   ///< Called by the UDP receive task
     c_FPPDiscovery ();
 
     void begin ();
@@ -112,7 +113,7 @@ public:
     void ProcessPOST      (AsyncWebServerRequest* request);
     void ProcessFile      (AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final);
     void ProcessBody      (AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total);
-    void ReadNextFrame    (uint8_t* outputBuffer, uint16_t outputBufferSize);
+    void ReadNextFrame    (uint8_t* outputBuffer, uint32_t outputBufferSize);
     void sendPingPacket   (IPAddress destination = IPAddress(255, 255, 255, 255));
     void PlayFile         (String & FileToPlay);
     void Enable           (void);
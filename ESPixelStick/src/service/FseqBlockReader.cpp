@@ -0,0 +1,406 @@
+/*
+* FseqBlockReader.cpp - Read frames out of a compressed v2 FSEQ file
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "FseqBlockReader.hpp"
+#include "FseqIndex.hpp"
+
+//-----------------------------------------------------------------------------
+c_FseqBlockReader::c_FseqBlockReader ()
+{
+    // DEBUG_START;
+    // DEBUG_END;
+} // c_FseqBlockReader
+
+//-----------------------------------------------------------------------------
+c_FseqBlockReader::~c_FseqBlockReader ()
+{
+    // DEBUG_START;
+
+    Close ();
+
+    // DEBUG_END;
+
+} // ~c_FseqBlockReader
+
+//-----------------------------------------------------------------------------
+/*
+    Read the block index and get the inflate buffers ready. The file stays
+    owned by the caller.
+*/
+bool c_FseqBlockReader::Open (const String & FileName, c_FileMgr::FileId _FileHandle, FSEQRawHeader & RawHeader, String & ErrorMsg)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    Close ();
+
+    do // once
+    {
+        uint8_t Compression = FseqCompressionType (RawHeader);
+        if (FSEQ_COMPRESSION_ZSTD == Compression)
+        {
+            ErrorMsg = F ("zstd compressed sequences are not supported. Export the sequence with zlib compression.");
+            break;
+        }
+
+        if (FSEQ_COMPRESSION_ZLIB != Compression)
+        {
+            ErrorMsg = String (F ("Unknown compression type: ")) + String (Compression);
+            break;
+        }
+
+#ifndef ARDUINO_ARCH_ESP32
+        ErrorMsg = F ("Compressed sequences need an ESP32.");
+        break;
+#else
+        uint32_t NumIndexEntries = FseqNumCompressedBlocks (RawHeader);
+        if (0 == NumIndexEntries)
+        {
+            ErrorMsg = F ("Compressed sequence has no block index.");
+            break;
+        }
+
+        BlockIndex   = (Block_t *)malloc (NumIndexEntries * sizeof (Block_t));
+        Decompressor = (tinfl_decompressor *)malloc (sizeof (tinfl_decompressor));
+        Window       = (uint8_t *)malloc (FSEQ_BLOCK_WINDOW_SIZE);
+        InputBuffer  = (uint8_t *)malloc (FSEQ_BLOCK_INPUT_SIZE);
+        if ((nullptr == BlockIndex) || (nullptr == Decompressor) || (nullptr == Window) || (nullptr == InputBuffer))
+        {
+            ErrorMsg = F ("Not enough memory to inflate a compressed sequence.");
+            Close ();
+            break;
+        }
+
+        FileHandle       = _FileHandle;
+        ChannelsPerFrame = read32 (RawHeader.channelCount, 0);
+        TotalFrames      = read32 (RawHeader.TotalNumberOfFramesInSequence, 0);
+
+        // the blocks follow each other starting at the channel data offset
+        uint32_t FileOffset    = read16 (RawHeader.dataOffset);
+        uint32_t IndexPosition = sizeof (FSEQRawHeader);
+        bool     IndexIsValid  = true;
+        FSEQRawCompressedBlockEntry RawEntries[FSEQ_BLOCK_INDEX_CHUNK];
+
+        for (uint32_t EntryIndex = 0; IndexIsValid && (EntryIndex < NumIndexEntries); )
+        {
+            uint32_t EntriesToRead = min (uint32_t (FSEQ_BLOCK_INDEX_CHUNK), NumIndexEntries - EntryIndex);
+            size_t   BytesToRead   = EntriesToRead * sizeof (FSEQRawCompressedBlockEntry);
+            if (BytesToRead != FseqIndex.ReadHeader (FileName, FileHandle, (uint8_t*)&RawEntries[0], BytesToRead, IndexPosition))
+            {
+                IndexIsValid = false;
+                break;
+            }
+            IndexPosition += BytesToRead;
+
+            for (uint32_t ChunkIndex = 0; ChunkIndex < EntriesToRead; ++ChunkIndex, ++EntryIndex)
+            {
+                uint32_t FirstFrame = read32 (RawEntries[ChunkIndex].FirstFrame, 0);
+                uint32_t Length     = read32 (RawEntries[ChunkIndex].Length, 0);
+                if (0 == Length)
+                {
+                    // the index is allocated before the blocks are written. Unused entries are zero.
+                    continue;
+                }
+
+                bool OutOfOrder = (0 == NumBlocks) ? (0 != FirstFrame) : (FirstFrame <= BlockIndex[NumBlocks - 1].FirstFrame);
+                if (OutOfOrder || (FirstFrame >= TotalFrames))
+                {
+                    IndexIsValid = false;
+                    break;
+                }
+
+                BlockIndex[NumBlocks].FirstFrame = FirstFrame;
+                BlockIndex[NumBlocks].FileOffset = FileOffset;
+                BlockIndex[NumBlocks].Length     = Length;
+                ++NumBlocks;
+                FileOffset += Length;
+            }
+        }
+
+        if (!IndexIsValid || (0 == NumBlocks))
+        {
+            ErrorMsg = F ("Compressed block index is not valid.");
+            Close ();
+            break;
+        }
+
+        if (FileOffset > FileMgr.GetSdFileSize (FileHandle))
+        {
+            ErrorMsg = F ("File is shorter than its compressed blocks.");
+            Close ();
+            break;
+        }
+
+        // DEBUG_V (String ("NumBlocks: ") + String (NumBlocks));
+        Response = true;
+#endif // ndef ARDUINO_ARCH_ESP32
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // Open
+
+//-----------------------------------------------------------------------------
+void c_FseqBlockReader::Close ()
+{
+    // DEBUG_START;
+
+    NumBlocks    = 0;
+    CurrentBlock = FSEQ_BLOCK_NONE;
+
+    if (nullptr != BlockIndex)
+    {
+        free (BlockIndex);
+        BlockIndex = nullptr;
+    }
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (nullptr != Decompressor)
+    {
+        free (Decompressor);
+        Decompressor = nullptr;
+    }
+#endif // def ARDUINO_ARCH_ESP32
+
+    if (nullptr != Window)
+    {
+        free (Window);
+        Window = nullptr;
+    }
+
+    if (nullptr != InputBuffer)
+    {
+        free (InputBuffer);
+        InputBuffer = nullptr;
+    }
+
+    // DEBUG_END;
+
+} // Close
+
+//-----------------------------------------------------------------------------
+void c_FseqBlockReader::GetStatus (JsonObject & json)
+{
+    // DEBUG_START;
+
+    JsonObject Status = json.createNestedObject (F ("compressed"));
+    Status[F ("blocks")]      = NumBlocks;
+    Status[F ("blockstarts")] = BlockStarts;
+    Status[F ("inflatedkb")]  = uint32_t (BytesInflated / 1024);
+    Status[CN_errors]         = InflateErrors;
+
+    // DEBUG_END;
+
+} // GetStatus
+
+//-----------------------------------------------------------------------------
+/*
+    Copy Length bytes starting at FrameOffset within frame FrameId to
+    Destination. Returns the number of bytes copied.
+*/
+size_t c_FseqBlockReader::Read (uint32_t FrameId, uint32_t FrameOffset, uint8_t * Destination, size_t Length)
+{
+    // xDEBUG_START;
+
+    size_t Copied = 0;
+
+    do // once
+    {
+        if (!IsOpen () || (FrameId >= TotalFrames))
+        {
+            break;
+        }
+
+        uint32_t Block    = FindBlock (FrameId);
+        uint32_t Position = ((FrameId - BlockIndex[Block].FirstFrame) * ChannelsPerFrame) + FrameOffset;
+
+        // the window only holds the most recent output
+        uint32_t OldestAvailable = (OutputTotal > FSEQ_BLOCK_WINDOW_SIZE) ? (OutputTotal - FSEQ_BLOCK_WINDOW_SIZE) : 0;
+        if ((Block != CurrentBlock) || (Position < OldestAvailable))
+        {
+            StartBlock (Block);
+        }
+
+        while (Copied < Length)
+        {
+            if (Position < OutputTotal)
+            {
+                uint32_t WindowOffset = Position & (FSEQ_BLOCK_WINDOW_SIZE - 1);
+                uint32_t BytesToCopy  = min (uint32_t (Length - Copied), OutputTotal - Position);
+                BytesToCopy = min (BytesToCopy, uint32_t (FSEQ_BLOCK_WINDOW_SIZE) - WindowOffset);
+
+                memcpy (&Destination[Copied], &Window[WindowOffset], BytesToCopy);
+                Copied   += BytesToCopy;
+                Position += BytesToCopy;
+                continue;
+            }
+
+            if (!Inflate ())
+            {
+                // end of the block or a bad block
+                break;
+            }
+        }
+
+    } while (false);
+
+    // xDEBUG_END;
+
+    return Copied;
+
+} // Read
+
+//-----------------------------------------------------------------------------
+uint32_t c_FseqBlockReader::FindBlock (uint32_t FrameId)
+{
+    uint32_t Response = 0;
+
+    do // once
+    {
+        // playback stays in the same block most of the time
+        if ((FSEQ_BLOCK_NONE != CurrentBlock) &&
+            (FrameId >= BlockIndex[CurrentBlock].FirstFrame) &&
+            (((CurrentBlock + 1) == NumBlocks) || (FrameId < BlockIndex[CurrentBlock + 1].FirstFrame)))
+        {
+            Response = CurrentBlock;
+            break;
+        }
+
+        // last block that starts at or before the frame
+        uint32_t Low  = 0;
+        uint32_t High = NumBlocks - 1;
+        while (Low < High)
+        {
+            uint32_t Middle = (Low + High + 1) / 2;
+            if (BlockIndex[Middle].FirstFrame <= FrameId)
+            {
+                Low = Middle;
+            }
+            else
+            {
+                High = Middle - 1;
+            }
+        }
+        Response = Low;
+
+    } while (false);
+
+    return Response;
+
+} // FindBlock
+
+//-----------------------------------------------------------------------------
+void c_FseqBlockReader::StartBlock (uint32_t Block)
+{
+    // xDEBUG_START;
+
+#ifdef ARDUINO_ARCH_ESP32
+    tinfl_init (Decompressor);
+#endif // def ARDUINO_ARCH_ESP32
+
+    CurrentBlock     = Block;
+    NextFilePosition = BlockIndex[Block].FileOffset;
+    BlockBytesLeft   = BlockIndex[Block].Length;
+    InputUsed        = 0;
+    InputLength      = 0;
+    OutputTotal      = 0;
+    BlockDone        = false;
+    ++BlockStarts;
+
+    // xDEBUG_END;
+
+} // StartBlock
+
+//-----------------------------------------------------------------------------
+/*
+    Run the inflater once. Output goes to the window at the position that
+    matches OutputTotal. Returns false when no more output can be made.
+*/
+bool c_FseqBlockReader::Inflate ()
+{
+    bool Response = false;
+
+#ifdef ARDUINO_ARCH_ESP32
+    do // once
+    {
+        if (BlockDone)
+        {
+            break;
+        }
+
+        if ((InputUsed == InputLength) && (0 != BlockBytesLeft))
+        {
+            uint32_t BytesToRead = min (uint32_t (FSEQ_BLOCK_INPUT_SIZE), BlockBytesLeft);
+            if (BytesToRead != FileMgr.ReadSdFile (FileHandle, InputBuffer, BytesToRead, NextFilePosition))
+            {
+                ++InflateErrors;
+                BlockDone = true;
+                break;
+            }
+
+            NextFilePosition += BytesToRead;
+            BlockBytesLeft   -= BytesToRead;
+            InputUsed         = 0;
+            InputLength       = BytesToRead;
+        }
+
+        uint32_t WindowOffset = OutputTotal & (FSEQ_BLOCK_WINDOW_SIZE - 1);
+        size_t   InputSize    = InputLength - InputUsed;
+        size_t   OutputSize   = FSEQ_BLOCK_WINDOW_SIZE - WindowOffset;
+        mz_uint32 Flags       = TINFL_FLAG_PARSE_ZLIB_HEADER | ((0 != BlockBytesLeft) ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+
+        tinfl_status Status = tinfl_decompress (Decompressor,
+                                                &InputBuffer[InputUsed], &InputSize,
+                                                Window, &Window[WindowOffset], &OutputSize,
+                                                Flags);
+        InputUsed     += InputSize;
+        OutputTotal   += OutputSize;
+        BytesInflated += OutputSize;
+
+        if (Status < TINFL_STATUS_DONE)
+        {
+            ++InflateErrors;
+            BlockDone = true;
+            break;
+        }
+
+        if (TINFL_STATUS_DONE == Status)
+        {
+            BlockDone = true;
+        }
+        else if ((0 == InputSize) && (0 == OutputSize) && (0 == BlockBytesLeft))
+        {
+            // wants more input than the block has
+            ++InflateErrors;
+            BlockDone = true;
+            break;
+        }
+
+        Response = (0 != OutputSize) || !BlockDone;
+
+    } while (false);
+#endif // def ARDUINO_ARCH_ESP32
+
+    return Response;
+
+} // Inflate
@@ -0,0 +1,100 @@
+#pragma once
+/*
+* FseqBlockReader.hpp - Read frames out of a compressed v2 FSEQ file
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   A compressed sequence is a list of independently compressed blocks of
+*   whole frames. The block index in the header says which frame each block
+*   starts with and how long it is.
+*
+*   Each block is inflated as a stream into a 32K circular window, so the
+*   memory used does not depend on the block size. Playback moves forward
+*   through a block. Going backwards further than the window, or jumping to
+*   another block, restarts the stream at the start of that block.
+*
+*   zlib blocks are inflated with the miniz inflater in the ESP32 ROM.
+*   Neither core ships a zstd decoder, so zstd files are refused with a
+*   message asking for a zlib export.
+*/
+
+#include "../ESPixelStick.h"
+#include "../FileMgr.hpp"
+#include "fseq.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#   if __has_include("esp32/rom/miniz.h")
+#       include "esp32/rom/miniz.h"
+#   else
+#       include "rom/miniz.h"
+#   endif
+#endif // def ARDUINO_ARCH_ESP32
+
+class c_FseqBlockReader
+{
+public:
+    c_FseqBlockReader ();
+    virtual ~c_FseqBlockReader ();
+
+    bool   Open          (const String & FileName, c_FileMgr::FileId FileHandle, FSEQRawHeader & RawHeader, String & ErrorMsg);
+    void   Close         ();
+    size_t Read          (uint32_t FrameId, uint32_t FrameOffset, uint8_t * Destination, size_t Length);
+    bool   IsOpen        () { return nullptr != BlockIndex; }
+    void   GetStatus     (JsonObject & json);
+    void   GetDriverName (String & Name) { Name = "FseqBlockReader"; }
+
+private:
+
+#define FSEQ_BLOCK_NONE             0xffffffff
+#define FSEQ_BLOCK_INPUT_SIZE       2048    // compressed bytes read from the file at a time
+#define FSEQ_BLOCK_INDEX_CHUNK      32      // index entries read from the file at a time
+#define FSEQ_BLOCK_WINDOW_SIZE      32768   // TINFL_LZ_DICT_SIZE. Must be a power of two
+
+    typedef struct
+    {
+        uint32_t FirstFrame;
+        uint32_t FileOffset;
+        uint32_t Length;
+    } Block_t;
+
+    Block_t           * BlockIndex       = nullptr;
+    uint32_t            NumBlocks        = 0;
+    c_FileMgr::FileId   FileHandle       = 0;
+    uint32_t            ChannelsPerFrame = 0;
+    uint32_t            TotalFrames      = 0;
+
+    /// inflate state for the block being read
+#ifdef ARDUINO_ARCH_ESP32
+    tinfl_decompressor * Decompressor    = nullptr;
+#endif // def ARDUINO_ARCH_ESP32
+    uint8_t           * Window           = nullptr;  ///< Last FSEQ_BLOCK_WINDOW_SIZE bytes inflated
+    uint8_t           * InputBuffer      = nullptr;
+    uint32_t            InputUsed        = 0;
+    uint32_t            InputLength      = 0;
+    uint32_t            CurrentBlock     = FSEQ_BLOCK_NONE;
+    uint32_t            NextFilePosition = 0;
+    uint32_t            BlockBytesLeft   = 0;        ///< Compressed bytes not yet read from the file
+    uint32_t            OutputTotal      = 0;        ///< Bytes inflated since the start of the block
+    bool                BlockDone        = false;
+
+    uint32_t            BlockStarts      = 0;
+    uint32_t            InflateErrors    = 0;
+    uint64_t            BytesInflated    = 0;
+
+    uint32_t FindBlock  (uint32_t FrameId);
+    void     StartBlock (uint32_t Block);
+    bool     Inflate    ();
+
+}; // c_FseqBlockReader
@@ -0,0 +1,410 @@
+/*
+* FseqCache.cpp - Keep recently played sequences in RAM
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "FseqCache.hpp"
+
+//-----------------------------------------------------------------------------
+c_FseqCache::c_FseqCache ()
+{
+    // DEBUG_START;
+    // DEBUG_END;
+
+} // c_FseqCache
+
+//-----------------------------------------------------------------------------
+c_FseqCache::~c_FseqCache ()
+{
+    // DEBUG_START;
+
+    for (Entry_t & Entry : Entries)
+    {
+        Evict (Entry);
+    }
+
+    // DEBUG_END;
+
+} // ~c_FseqCache
+
+//-----------------------------------------------------------------------------
+/*
+    Returns the entry that holds the file, or FSEQ_CACHE_NO_HANDLE if it is
+    not cached and cannot be. A new entry is empty until LoadChunk () has
+    read all of it. Every handle must be handed back to Release ().
+*/
+c_FseqCache::Handle_t c_FseqCache::Acquire (const String & FileName, size_t FileSize)
+{
+    // DEBUG_START;
+
+    Handle_t Response = FSEQ_CACHE_NO_HANDLE;
+
+    do // once
+    {
+        DropStaleEntries ();
+
+        bool BeingLoaded = false;
+        for (Handle_t Handle = 0; Handle < FSEQ_CACHE_MAX_ENTRIES; ++Handle)
+        {
+            Entry_t & Entry = Entries[Handle];
+            if ((nullptr != Entry.Data) &&
+                (Entry.Generation == FileGeneration) &&
+                (Entry.Size == FileSize) &&
+                (Entry.FileName == FileName))
+            {
+                if (Entry.Loaded != Entry.Size)
+                {
+                    // someone else is still reading it in
+                    BeingLoaded = true;
+                    break;
+                }
+
+                ++Entry.Users;
+                Entry.LastUsed = ++UseClock;
+                Response = Handle;
+                break;
+            }
+        }
+
+        if (FSEQ_CACHE_NO_HANDLE != Response)
+        {
+            ++Hits;
+            break;
+        }
+
+        ++Misses;
+
+        if (BeingLoaded || (0 == FileSize) || (FileSize > BudgetBytes) || !MakeRoom (FileSize))
+        {
+            break;
+        }
+
+        Entry_t * Entry = FreeEntry ();
+        if (nullptr == Entry)
+        {
+            break;
+        }
+
+        Entry->Data = Allocate (FileSize);
+        if (nullptr == Entry->Data)
+        {
+            break;
+        }
+
+        Entry->FileName      = FileName;
+        Entry->Size          = FileSize;
+        Entry->Generation    = FileGeneration;
+        Entry->LastUsed      = ++UseClock;
+        Entry->Users         = 1;
+        Entry->Loaded        = 0;
+        Entry->LoadFailed    = false;
+        Entry->LoadStartTime = millis ();
+        UsedBytes           += FileSize;
+
+        Response = Handle_t (Entry - Entries);
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // Acquire
+
+//-----------------------------------------------------------------------------
+///< The whole file, or nullptr until LoadChunk () has read all of it
+const uint8_t * c_FseqCache::GetData (Handle_t Handle)
+{
+    const uint8_t * Response = nullptr;
+
+    if ((FSEQ_CACHE_NO_HANDLE != Handle) && (Entries[Handle].Loaded == Entries[Handle].Size))
+    {
+        Response = Entries[Handle].Data;
+    }
+
+    return Response;
+
+} // GetData
+
+//-----------------------------------------------------------------------------
+/*
+    Read the next FSEQ_CACHE_CHUNK_SIZE bytes of the file into the entry.
+    Only the holder of the handle may call this, from the task that reads
+    the file. Returns true once the whole file is in memory.
+*/
+bool c_FseqCache::LoadChunk (Handle_t Handle, c_FileMgr::FileId FileHandle)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
+    {
+        if (FSEQ_CACHE_NO_HANDLE == Handle)
+        {
+            break;
+        }
+
+        Entry_t & Entry = Entries[Handle];
+        if (Entry.LoadFailed)
+        {
+            break;
+        }
+
+        size_t FilePosition = Entry.Loaded;
+        size_t ChunkEnd     = min (Entry.Size, FilePosition + FSEQ_CACHE_CHUNK_SIZE);
+        while (FilePosition < ChunkEnd)
+        {
+            size_t BytesToRead = min (size_t (FSEQ_CACHE_READ_SIZE), ChunkEnd - FilePosition);
+            if (BytesToRead != FileMgr.ReadSdFile (FileHandle, &Entry.Data[FilePosition], BytesToRead, FilePosition))
+            {
+                logcon (String (F ("Could not read '")) + Entry.FileName + F ("' into the cache"));
+                Entry.LoadFailed = true;
+                break;
+            }
+
+            FilePosition += BytesToRead;
+        }
+
+        if (Entry.LoadFailed)
+        {
+            break;
+        }
+
+        // publish the bytes that have been read
+        Entry.Loaded = FilePosition;
+        Response = (Entry.Loaded == Entry.Size);
+
+        if (Response)
+        {
+            ++Loads;
+            logcon (String (F ("Cached '")) + Entry.FileName + F ("' (") + String (Entry.Size / 1024) +
+                    F ("KB) in ") + String (millis () - Entry.LoadStartTime) + F ("ms"));
+        }
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // LoadChunk
+
+//-----------------------------------------------------------------------------
+void c_FseqCache::Release (Handle_t Handle)
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        if (FSEQ_CACHE_NO_HANDLE == Handle)
+        {
+            break;
+        }
+
+        Entry_t & Entry = Entries[Handle];
+        if (Entry.Users)
+        {
+            --Entry.Users;
+        }
+
+        if ((0 == Entry.Users) && (Entry.Loaded != Entry.Size))
+        {
+            // the load did not finish. Nobody else can use it.
+            Evict (Entry);
+        }
+
+    } while (false);
+
+    DropStaleEntries ();
+    MakeRoom (0);
+
+    // DEBUG_END;
+
+} // Release
+
+//-----------------------------------------------------------------------------
+/*
+    Only stores the new budget. Entries over budget are evicted from the
+    task that plays files the next time it uses the cache.
+*/
+void c_FseqCache::SetBudget (uint32_t BudgetKB)
+{
+    // DEBUG_START;
+
+    BudgetBytes = BudgetKB * 1024;
+
+    // DEBUG_END;
+
+} // SetBudget
+
+//-----------------------------------------------------------------------------
+void c_FseqCache::GetStatus (JsonObject & json)
+{
+    // DEBUG_START;
+
+    uint32_t NumEntries = 0;
+    for (Entry_t & Entry : Entries)
+    {
+        NumEntries += (nullptr != Entry.Data) ? 1 : 0;
+    }
+
+    JsonObject CacheStatus = json.createNestedObject (F ("cache"));
+    CacheStatus[F ("budgetKB")] = BudgetBytes / 1024;
+    CacheStatus[F ("usedKB")]   = UsedBytes / 1024;
+    CacheStatus[F ("files")]    = NumEntries;
+    CacheStatus[F ("hits")]     = Hits;
+    CacheStatus[F ("misses")]   = Misses;
+    CacheStatus[F ("loads")]    = Loads;
+
+    // DEBUG_END;
+
+} // GetStatus
+
+//-----------------------------------------------------------------------------
+void c_FseqCache::DropStaleEntries ()
+{
+    // DEBUG_START;
+
+    uint32_t CurrentGeneration = FileGeneration;
+
+    for (Entry_t & Entry : Entries)
+    {
+        if ((nullptr != Entry.Data) && (0 == Entry.Users) && (Entry.Generation != CurrentGeneration))
+        {
+            Evict (Entry);
+        }
+    }
+
+    // DEBUG_END;
+
+} // DropStaleEntries
+
+//-----------------------------------------------------------------------------
+/*
+    Evict the least recently used entries that are not playing until Size
+    more bytes fit in the budget and there is a free entry.
+*/
+bool c_FseqCache::MakeRoom (size_t Size)
+{
+    // DEBUG_START;
+
+    bool Response = true;
+
+    while (((UsedBytes + Size) > BudgetBytes) || ((0 != Size) && (nullptr == FreeEntry ())))
+    {
+        Entry_t * Oldest = nullptr;
+        for (Entry_t & Entry : Entries)
+        {
+            if ((nullptr != Entry.Data) && (0 == Entry.Users) &&
+                ((nullptr == Oldest) || (Entry.LastUsed < Oldest->LastUsed)))
+            {
+                Oldest = &Entry;
+            }
+        }
+
+        if (nullptr == Oldest)
+        {
+            // everything left is playing
+            Response = false;
+            break;
+        }
+
+        Evict (*Oldest);
+    }
+
+    // DEBUG_END;
+
+    return Response;
+
+} // MakeRoom
+
+//-----------------------------------------------------------------------------
+c_FseqCache::Entry_t * c_FseqCache::FreeEntry ()
+{
+    Entry_t * Response = nullptr;
+
+    for (Entry_t & Entry : Entries)
+    {
+        if (nullptr == Entry.Data)
+        {
+            Response = &Entry;
+            break;
+        }
+    }
+
+    return Response;
+
+} // FreeEntry
+
+//-----------------------------------------------------------------------------
+uint8_t * c_FseqCache::Allocate (size_t Size)
+{
+    // DEBUG_START;
+
+    uint8_t * Response = nullptr;
+
+    do // once
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        if (psramFound ())
+        {
+            Response = (uint8_t *)ps_malloc (Size);
+            break;
+        }
+#endif // def ARDUINO_ARCH_ESP32
+
+        if (ESP.getFreeHeap () < (Size + FSEQ_CACHE_MIN_FREE_HEAP))
+        {
+            // the rest of the system needs it more
+            break;
+        }
+
+        Response = (uint8_t *)malloc (Size);
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // Allocate
+
+//-----------------------------------------------------------------------------
+void c_FseqCache::Evict (Entry_t & Entry)
+{
+    // DEBUG_START;
+
+    if (nullptr != Entry.Data)
+    {
+        free (Entry.Data);
+        Entry.Data = nullptr;
+        UsedBytes -= Entry.Size;
+    }
+
+    Entry.FileName   = String ();
+    Entry.Size       = 0;
+    Entry.Users      = 0;
+    Entry.Loaded     = 0;
+    Entry.LoadFailed = false;
+
+    // DEBUG_END;
+
+} // Evict
+
+// create a global instance of the sequence cache
+c_FseqCache FseqCache;
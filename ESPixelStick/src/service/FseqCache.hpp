@@ -0,0 +1,97 @@
+#pragma once
+/*
+* FseqCache.hpp - Keep recently played sequences in RAM
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   A sequence that fits in the budget is read into memory the first time
+*   it is opened and played from there after that. The player reads it in
+*   a chunk at a time with LoadChunk () from its read ahead task and plays
+*   from the SD card until the last chunk is in. When room is needed, the
+*   sequence that was opened longest ago and is not playing goes first.
+*
+*   PSRAM is used when the board has it. Otherwise a sequence is only
+*   cached if enough heap is left over for everything else.
+*
+*   Any file opened for writing marks the whole cache out of date. Cached
+*   copies are dropped the next time they would be used.
+*/
+
+#include "../ESPixelStick.h"
+#include "../FileMgr.hpp"
+
+class c_FseqCache
+{
+public:
+    c_FseqCache ();
+    virtual ~c_FseqCache ();
+
+    typedef int32_t Handle_t;
+#define FSEQ_CACHE_NO_HANDLE        (-1)
+
+    Handle_t        Acquire   (const String & FileName, size_t FileSize);
+    const uint8_t * GetData   (Handle_t Handle);
+    bool            LoadChunk (Handle_t Handle, c_FileMgr::FileId FileHandle);
+    void            Release   (Handle_t Handle);
+    void     SetBudget        (uint32_t BudgetKB);
+    uint32_t GetBudget        () { return BudgetBytes / 1024; }
+    void     FilesChanged     () { ++FileGeneration; }   ///< Safe to call from any task
+    void     GetStatus        (JsonObject & json);
+    void     GetDriverName    (String & Name) { Name = "FseqCache"; }
+
+private:
+
+#define FSEQ_CACHE_MAX_ENTRIES      8
+#define FSEQ_CACHE_READ_SIZE        4096
+#define FSEQ_CACHE_MIN_FREE_HEAP    (60 * 1024)     // Heap left over when there is no PSRAM
+#ifdef ARDUINO_ARCH_ESP32
+#   define FSEQ_CACHE_DEFAULT_KB    1024
+#   define FSEQ_CACHE_CHUNK_SIZE    (16 * 1024)     // Read by each LoadChunk ()
+#else
+#   define FSEQ_CACHE_DEFAULT_KB    0
+#   define FSEQ_CACHE_CHUNK_SIZE    FSEQ_CACHE_READ_SIZE
+#endif // def ARDUINO_ARCH_ESP32
+
+    struct Entry_t
+    {
+        String     FileName;
+        uint8_t  * Data       = nullptr;
+        size_t     Size       = 0;
+        uint32_t   LastUsed   = 0;
+        uint32_t   Generation = 0;
+        uint32_t   Users      = 0;
+        volatile size_t Loaded = 0;         ///< Bytes read in so far. Complete when it reaches Size
+        bool       LoadFailed = false;
+        uint32_t   LoadStartTime = 0;
+    };
+
+    Entry_t           Entries[FSEQ_CACHE_MAX_ENTRIES];
+    uint32_t          BudgetBytes    = FSEQ_CACHE_DEFAULT_KB * 1024;
+    uint32_t          UsedBytes      = 0;
+    uint32_t          UseClock       = 0;
+    volatile uint32_t FileGeneration = 0;
+    uint32_t          Hits           = 0;
+    uint32_t          Misses         = 0;
+    uint32_t          Loads          = 0;
+
+    void      DropStaleEntries ();
+    bool      MakeRoom         (size_t Size);
+    Entry_t * FreeEntry        ();
+    uint8_t * Allocate         (size_t Size);
+    void      Evict            (Entry_t & Entry);
+
+}; // c_FseqCache
+
+extern c_FseqCache FseqCache;
@@ -0,0 +1,368 @@
+/*
+* FseqExtractor.cpp - Cut this controller's channels out of an FSEQ upload
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "FseqExtractor.hpp"
+#include <Int64String.h>
+
+//-----------------------------------------------------------------------------
+c_FseqExtractor::c_FseqExtractor ()
+{
+    // DEBUG_START;
+    // DEBUG_END;
+
+} // c_FseqExtractor
+
+//-----------------------------------------------------------------------------
+c_FseqExtractor::~c_FseqExtractor ()
+{
+    // DEBUG_START;
+
+    FreeHeader ();
+
+    // DEBUG_END;
+
+} // ~c_FseqExtractor
+
+//-----------------------------------------------------------------------------
+void c_FseqExtractor::Begin (uint32_t _FirstChannel, uint32_t _NumChannels, Writer_t _Writer)
+{
+    // DEBUG_START;
+
+    Abort ();
+
+    do // once
+    {
+        Writer       = _Writer;
+        FirstChannel = _FirstChannel;
+        NumChannels  = _NumChannels;
+        BytesIn      = 0;
+        BytesOut     = 0;
+
+        HeaderBuffer = (uint8_t *)malloc (sizeof (FSEQRawHeader));
+        if (nullptr == HeaderBuffer)
+        {
+            PassThrough (String (F ("Not enough memory.")));
+            break;
+        }
+
+        HeaderSize = sizeof (FSEQRawHeader);
+        HeaderUsed = 0;
+        State      = State_Header;
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // Begin
+
+//-----------------------------------------------------------------------------
+void c_FseqExtractor::Write (uint8_t * Data, size_t Length)
+{
+    // DEBUG_START;
+
+    BytesIn += Length;
+
+    while (Length)
+    {
+        if (State_Header == State)
+        {
+            size_t BytesToCopy = min (Length, size_t (HeaderSize - HeaderUsed));
+            memcpy (&HeaderBuffer[HeaderUsed], Data, BytesToCopy);
+            HeaderUsed += BytesToCopy;
+            Data       += BytesToCopy;
+            Length     -= BytesToCopy;
+
+            if (HeaderUsed == HeaderSize)
+            {
+                ProcessHeader ();
+            }
+        }
+        else if (State_Frames == State)
+        {
+            ExtractFrames (Data, Length);
+            break;
+        }
+        else
+        {
+            Output (Data, Length);
+            break;
+        }
+    }
+
+    // DEBUG_END;
+
+} // Write
+
+//-----------------------------------------------------------------------------
+void c_FseqExtractor::End ()
+{
+    // DEBUG_START;
+
+    if (State_Header == State)
+    {
+        // too short to be a sequence. Keep what we got
+        Output (HeaderBuffer, HeaderUsed);
+    }
+    else if (State_Frames == State)
+    {
+        logcon (String (F ("Kept channels ")) + String (WindowStart + 1) +
+                F ("-") + String (WindowEnd) +
+                F (" of ") + String (InputChannelsPerFrame) +
+                F (". Wrote ") + int64String (BytesOut) +
+                F (" of ") + int64String (BytesIn) + F (" bytes"));
+    }
+
+    Abort ();
+
+    // DEBUG_END;
+
+} // End
+
+//-----------------------------------------------------------------------------
+void c_FseqExtractor::Abort ()
+{
+    // DEBUG_START;
+
+    FreeHeader ();
+    State = State_Idle;
+
+    // DEBUG_END;
+
+} // Abort
+
+//-----------------------------------------------------------------------------
+/*
+    Called each time the header buffer fills. The first time it holds the
+    fixed header, which says whether the file can be cut down and how long
+    the whole header is. The second time it holds everything up to the
+    channel data.
+*/
+void c_FseqExtractor::ProcessHeader ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        FSEQRawHeader & RawHeader = *((FSEQRawHeader *)HeaderBuffer);
+        uint32_t DataOffset = read16 (RawHeader.dataOffset);
+
+        if (HeaderSize == sizeof (FSEQRawHeader))
+        {
+            uint32_t ChannelCount = read32 (RawHeader.channelCount, 0);
+
+            if (0 != memcmp (RawHeader.header, "PSEQ", sizeof (RawHeader.header)))
+            {
+                PassThrough (String (F ("Not an FSEQ file.")));
+                break;
+            }
+
+            if (2 != RawHeader.majorVersion)
+            {
+                PassThrough (String (F ("Not a v2 sequence.")));
+                break;
+            }
+
+            if (FSEQ_COMPRESSION_NONE != FseqCompressionType (RawHeader))
+            {
+                PassThrough (String (F ("Sequence is compressed.")));
+                break;
+            }
+
+            if (0 != RawHeader.numSparseRanges)
+            {
+                PassThrough (String (F ("Sequence already has sparse ranges.")));
+                break;
+            }
+
+            if ((DataOffset < sizeof (FSEQRawHeader)) || ((DataOffset + sizeof (FSEQRawRangeEntry)) > 0xffff))
+            {
+                PassThrough (String (F ("Invalid header size.")));
+                break;
+            }
+
+            if (FirstChannel >= ChannelCount)
+            {
+                PassThrough (String (F ("Sequence does not reach our channels.")));
+                break;
+            }
+
+            if ((0 == FirstChannel) && (NumChannels >= ChannelCount))
+            {
+                PassThrough (String (F ("Sequence only has our channels.")));
+                break;
+            }
+
+            InputChannelsPerFrame = ChannelCount;
+            WindowStart           = FirstChannel;
+            WindowEnd             = FirstChannel + min (NumChannels, ChannelCount - FirstChannel);
+
+            // collect the rest of the header
+            uint8_t * NewBuffer = (uint8_t *)realloc (HeaderBuffer, DataOffset);
+            if (nullptr == NewBuffer)
+            {
+                PassThrough (String (F ("Not enough memory.")));
+                break;
+            }
+
+            HeaderBuffer = NewBuffer;
+            HeaderSize   = DataOffset;
+
+            if (HeaderUsed < HeaderSize)
+            {
+                break;
+            }
+        }
+
+        WriteHeader ();
+        FreeHeader ();
+        FrameOffset = 0;
+        State       = State_Frames;
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // ProcessHeader
+
+//-----------------------------------------------------------------------------
+/*
+    The new header has one sparse range for the window and no compression
+    block index. Variable headers (media name, producer) are kept.
+*/
+void c_FseqExtractor::WriteHeader ()
+{
+    // DEBUG_START;
+
+    FSEQRawHeader & RawHeader = *((FSEQRawHeader *)HeaderBuffer);
+    uint32_t DataOffset        = read16 (RawHeader.dataOffset);
+    uint32_t VariableHdrOffset = read16 (RawHeader.VariableHdrOffset);
+
+    if ((VariableHdrOffset < sizeof (FSEQRawHeader)) || (VariableHdrOffset > DataOffset))
+    {
+        // no usable variable headers
+        VariableHdrOffset = DataOffset;
+    }
+
+    uint32_t VariableHdrLength = DataOffset - VariableHdrOffset;
+
+    FSEQRawHeader NewHeader;
+    memcpy ((void*)&NewHeader, HeaderBuffer, sizeof (NewHeader));
+    write16 (NewHeader.VariableHdrOffset, sizeof (FSEQRawHeader) + sizeof (FSEQRawRangeEntry));
+    write16 (NewHeader.dataOffset, sizeof (FSEQRawHeader) + sizeof (FSEQRawRangeEntry) + VariableHdrLength);
+    write32 (NewHeader.channelCount, WindowEnd - WindowStart);
+    NewHeader.compressionType     = FSEQ_COMPRESSION_NONE;
+    NewHeader.numCompressedBlocks = 0;
+    NewHeader.numSparseRanges     = 1;
+
+    FSEQRawRangeEntry Range;
+    write24 (Range.Start,  WindowStart);
+    write24 (Range.Length, WindowEnd - WindowStart);
+
+    Output ((uint8_t *)&NewHeader, sizeof (NewHeader));
+    Output ((uint8_t *)&Range, sizeof (Range));
+    Output (&HeaderBuffer[VariableHdrOffset], VariableHdrLength);
+
+    // DEBUG_END;
+
+} // WriteHeader
+
+//-----------------------------------------------------------------------------
+void c_FseqExtractor::PassThrough (const String & Reason)
+{
+    // DEBUG_START;
+
+    logcon (String (F ("Keeping the whole file. ")) + Reason);
+
+    if (nullptr != HeaderBuffer)
+    {
+        Output (HeaderBuffer, HeaderUsed);
+    }
+
+    FreeHeader ();
+    State = State_PassThrough;
+
+    // DEBUG_END;
+
+} // PassThrough
+
+//-----------------------------------------------------------------------------
+/*
+    Frames arrive split across upload chunks in any way. FrameOffset keeps
+    our place in the current frame from one chunk to the next.
+*/
+void c_FseqExtractor::ExtractFrames (uint8_t * Data, size_t Length)
+{
+    // DEBUG_START;
+
+    while (Length)
+    {
+        size_t BytesToSkip;
+
+        if (FrameOffset < WindowStart)
+        {
+            BytesToSkip = min (Length, size_t (WindowStart - FrameOffset));
+        }
+        else if (FrameOffset < WindowEnd)
+        {
+            BytesToSkip = min (Length, size_t (WindowEnd - FrameOffset));
+            Output (Data, BytesToSkip);
+        }
+        else
+        {
+            BytesToSkip = min (Length, size_t (InputChannelsPerFrame - FrameOffset));
+        }
+
+        Data        += BytesToSkip;
+        Length      -= BytesToSkip;
+        FrameOffset += BytesToSkip;
+
+        if (FrameOffset >= InputChannelsPerFrame)
+        {
+            FrameOffset = 0;
+        }
+    }
+
+    // DEBUG_END;
+
+} // ExtractFrames
+
+//-----------------------------------------------------------------------------
+void c_FseqExtractor::Output (uint8_t * Data, size_t Length)
+{
+    if (Length && Writer)
+    {
+        Writer (Data, Length);
+        BytesOut += Length;
+    }
+
+} // Output
+
+//-----------------------------------------------------------------------------
+void c_FseqExtractor::FreeHeader ()
+{
+    if (nullptr != HeaderBuffer)
+    {
+        free (HeaderBuffer);
+        HeaderBuffer = nullptr;
+    }
+
+    HeaderSize = 0;
+    HeaderUsed = 0;
+
+} // FreeHeader
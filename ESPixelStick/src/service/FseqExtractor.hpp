@@ -0,0 +1,80 @@
+#pragma once
+/*
+* FseqExtractor.hpp - Cut this controller's channels out of an FSEQ upload
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   Sits between the upload handler and the file. The upload is passed
+*   through Write () as it arrives and only the header and the channel
+*   window of each frame come out the other side. The result is a v2 FSEQ
+*   with one sparse range, so players that know about ranges still put the
+*   channels in the right place.
+*
+*   Only the header is buffered. Files that cannot be cut down (compressed,
+*   already sparse, not an FSEQ) are passed through unchanged.
+*/
+
+#include "../ESPixelStick.h"
+#include "fseq.h"
+
+class c_FseqExtractor
+{
+public:
+    typedef std::function<void (uint8_t * Data, size_t Length)> Writer_t;
+
+    c_FseqExtractor ();
+    virtual ~c_FseqExtractor ();
+
+    void Begin         (uint32_t FirstChannel, uint32_t NumChannels, Writer_t Writer);  ///< FirstChannel is 0 based
+    void Write         (uint8_t * Data, size_t Length);
+    void End           ();
+    void Abort         ();
+    bool IsActive      () { return State_Idle != State; }
+    void GetDriverName (String & Name) { Name = "FseqExtractor"; }
+
+private:
+
+    enum e_State
+    {
+        State_Idle = 0,
+        State_Header,       ///< Collecting the header
+        State_Frames,       ///< Copying the channel window of each frame
+        State_PassThrough,  ///< Writing the upload as it is
+    };
+
+    Writer_t    Writer;
+    e_State     State                 = State_Idle;
+    uint32_t    FirstChannel          = 0;
+    uint32_t    NumChannels           = 0;
+
+    uint8_t   * HeaderBuffer          = nullptr;
+    uint32_t    HeaderSize            = 0;      ///< Header bytes needed before we can go on
+    uint32_t    HeaderUsed            = 0;
+
+    uint32_t    InputChannelsPerFrame = 0;
+    uint32_t    WindowStart           = 0;      ///< First byte of each frame that is kept
+    uint32_t    WindowEnd             = 0;      ///< One past the last byte kept
+    uint32_t    FrameOffset           = 0;      ///< Where the next byte lands in its frame
+    uint64_t    BytesIn               = 0;
+    uint64_t    BytesOut              = 0;
+
+    void ProcessHeader ();
+    void WriteHeader   ();
+    void PassThrough   (const String & Reason);
+    void ExtractFrames (uint8_t * Data, size_t Length);
+    void Output        (uint8_t * Data, size_t Length);
+    void FreeHeader    ();
+
+}; // c_FseqExtractor
@@ -0,0 +1,579 @@
+/*
+* FseqIndex.cpp - Remember the headers of the sequences on the SD card
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "FseqIndex.hpp"
+
+//-----------------------------------------------------------------------------
+c_FseqIndex::c_FseqIndex ()
+{
+    // DEBUG_START;
+
+#ifdef ARDUINO_ARCH_ESP32
+    IndexLock = xSemaphoreCreateMutex ();
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // c_FseqIndex
+
+//-----------------------------------------------------------------------------
+c_FseqIndex::~c_FseqIndex ()
+{
+    // DEBUG_START;
+
+    EndScan ();
+    Clear ();
+
+    // DEBUG_END;
+
+} // ~c_FseqIndex
+
+//-----------------------------------------------------------------------------
+/*
+    Answer a read of the header area from the index. Anything the index
+    cannot answer is read from the file.
+*/
+size_t c_FseqIndex::ReadHeader (const String & FileName, c_FileMgr::FileId FileHandle, uint8_t * Destination, size_t Length, size_t Offset)
+{
+    // DEBUG_START;
+
+    size_t Response = 0;
+    bool   Found    = false;
+    bool   Stale    = true;
+
+    uint32_t Size    = FileMgr.GetSdFileSize (FileHandle);
+    uint32_t ModTime = FileMgr.GetSdFileTime (FileHandle);
+
+    Lock ();
+
+    auto Entry = Index.find (BaseName (FileName));
+    if (Entry != Index.end ())
+    {
+        Stale = (Entry->second.Size != Size) || (Entry->second.ModTime != ModTime);
+
+        if (!Stale && ((Offset + Length) <= Entry->second.HeaderLength))
+        {
+            memcpy (Destination, &Entry->second.Header[Offset], Length);
+            Response = Length;
+            Found    = true;
+        }
+    }
+
+    Unlock ();
+
+    if (Found)
+    {
+        ++Hits;
+    }
+    else
+    {
+        ++Misses;
+        Response = FileMgr.ReadSdFile (FileHandle, Destination, Length, Offset);
+
+        if (Stale)
+        {
+            // new or changed since the last scan
+            Rescan ();
+        }
+    }
+
+    // DEBUG_END;
+
+    return Response;
+
+} // ReadHeader
+
+//-----------------------------------------------------------------------------
+/*
+    Without a clock the card may give a rewritten file the same time it
+    had before, so writes drop the entry rather than rely on the scan.
+*/
+void c_FseqIndex::Forget (const String & FileName)
+{
+    // DEBUG_START;
+
+    Lock ();
+
+    auto Entry = Index.find (BaseName (FileName));
+    if (Entry != Index.end ())
+    {
+        IndexBytes -= Entry->second.HeaderLength;
+        FreeEntry (Entry->second);
+        Index.erase (Entry);
+        Dirty = true;
+    }
+
+    Unlock ();
+
+    Rescan ();
+
+    // DEBUG_END;
+
+} // Forget
+
+//-----------------------------------------------------------------------------
+bool c_FseqIndex::IsIndexFile (const String & FileName)
+{
+    return BaseName (FileName) == String (F (FSEQ_INDEX_FILE_NAME));
+
+} // IsIndexFile
+
+//-----------------------------------------------------------------------------
+void c_FseqIndex::GetStatus (JsonObject & json)
+{
+    // DEBUG_START;
+
+    JsonObject IndexStatus = json.createNestedObject (F ("index"));
+    IndexStatus[F ("files")]  = Index.size ();
+    IndexStatus[F ("bytes")]  = IndexBytes;
+    IndexStatus[F ("hits")]   = Hits;
+    IndexStatus[F ("misses")] = Misses;
+
+    // DEBUG_END;
+
+} // GetStatus
+
+//-----------------------------------------------------------------------------
+void c_FseqIndex::Poll ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        if (LoadRequested)
+        {
+            LoadRequested = false;
+            EndScan ();
+            LoadIndexFile ();
+            RescanRequested = true;
+            break;
+        }
+
+        if (!FileMgr.SdCardIsInstalled ())
+        {
+            break;
+        }
+
+        if (!Scanning)
+        {
+            if (!RescanRequested)
+            {
+                break;
+            }
+            RescanRequested = false;
+
+            ScanDir = FileMgr.GetSdFileSystem ().open (FileMgr.SdPath (String ()), CN_r);
+            if (!ScanDir)
+            {
+                break;
+            }
+
+            Lock ();
+            for (auto & CurrentEntry : Index)
+            {
+                CurrentEntry.second.Seen = false;
+            }
+            Unlock ();
+
+            Scanning = true;
+        }
+
+        ScanNextFile ();
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // Poll
+
+//-----------------------------------------------------------------------------
+/*
+    One directory entry per poll so a card full of sequences does not
+    hold up the main loop.
+*/
+void c_FseqIndex::ScanNextFile ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        fs::File SeqFile = ScanDir.openNextFile ();
+
+        if (!SeqFile)
+        {
+            // scan is done. Forget files that are gone
+            EndScan ();
+
+            Lock ();
+            for (auto CurrentEntry = Index.begin (); CurrentEntry != Index.end ();)
+            {
+                if (CurrentEntry->second.Seen)
+                {
+                    ++CurrentEntry;
+                    continue;
+                }
+
+                IndexBytes -= CurrentEntry->second.HeaderLength;
+                FreeEntry (CurrentEntry->second);
+                CurrentEntry = Index.erase (CurrentEntry);
+                Dirty = true;
+            }
+            Unlock ();
+
+            if (Dirty)
+            {
+                Save ();
+            }
+            break;
+        }
+
+        String FileName = BaseName (String (SeqFile.name ()));
+        String LowerCaseName = FileName;
+        LowerCaseName.toLowerCase ();
+
+        if (SeqFile.isDirectory () || !LowerCaseName.endsWith (String (F (".fseq"))))
+        {
+            SeqFile.close ();
+            break;
+        }
+
+        Entry_t NewEntry;
+        NewEntry.Size    = SeqFile.size ();
+        NewEntry.ModTime = SeqFile.getLastWrite ();
+        NewEntry.Seen    = true;
+
+        bool Known = false;
+
+        Lock ();
+        auto CurrentEntry = Index.find (FileName);
+        if ((CurrentEntry != Index.end ()) &&
+            (CurrentEntry->second.Size == NewEntry.Size) &&
+            (CurrentEntry->second.ModTime == NewEntry.ModTime))
+        {
+            CurrentEntry->second.Seen = true;
+            Known = true;
+        }
+        Unlock ();
+
+        if (!Known)
+        {
+            ReadFileHeader (SeqFile, NewEntry);
+            Insert (FileName, NewEntry);
+            Dirty = true;
+        }
+
+        SeqFile.close ();
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // ScanNextFile
+
+//-----------------------------------------------------------------------------
+void c_FseqIndex::EndScan ()
+{
+    // DEBUG_START;
+
+    if (ScanDir)
+    {
+        ScanDir.close ();
+    }
+    Scanning = false;
+
+    // DEBUG_END;
+
+} // EndScan
+
+//-----------------------------------------------------------------------------
+/*
+    Copy everything in front of the channel data. Files that are not
+    sequences, or whose header is too big, are remembered without a header
+    so they are not read again on every scan.
+*/
+bool c_FseqIndex::ReadFileHeader (fs::File & SeqFile, Entry_t & Entry)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
+    {
+        FSEQRawHeader RawHeader;
+        if (sizeof (RawHeader) != SeqFile.read ((uint8_t*)&RawHeader, sizeof (RawHeader)))
+        {
+            break;
+        }
+
+        if (0 != memcmp (RawHeader.header, "PSEQ", sizeof (RawHeader.header)))
+        {
+            break;
+        }
+
+        uint32_t DataOffset = read16 (RawHeader.dataOffset);
+        if ((DataOffset < sizeof (RawHeader)) || (DataOffset > FSEQ_INDEX_MAX_HEADER) || (DataOffset > Entry.Size))
+        {
+            break;
+        }
+
+        Entry.Header = (uint8_t*)malloc (DataOffset);
+        if (nullptr == Entry.Header)
+        {
+            break;
+        }
+
+        memcpy (Entry.Header, &RawHeader, sizeof (RawHeader));
+        size_t BytesToRead = DataOffset - sizeof (RawHeader);
+        if (BytesToRead != SeqFile.read (&Entry.Header[sizeof (RawHeader)], BytesToRead))
+        {
+            FreeEntry (Entry);
+            break;
+        }
+
+        Entry.HeaderLength = DataOffset;
+        Entry.Checksum     = CalculateChecksum (Entry.Header, Entry.HeaderLength);
+        Response           = true;
+
+    } while (false);
+
+    // DEBUG_END;
+
+    return Response;
+
+} // ReadFileHeader
+
+//-----------------------------------------------------------------------------
+/*
+    Takes ownership of the header. Over the memory limit, only the file
+    size and time are kept.
+*/
+void c_FseqIndex::Insert (const String & FileName, Entry_t & Entry)
+{
+    // DEBUG_START;
+
+    Lock ();
+
+    auto CurrentEntry = Index.find (FileName);
+    if (CurrentEntry != Index.end ())
+    {
+        IndexBytes -= CurrentEntry->second.HeaderLength;
+        FreeEntry (CurrentEntry->second);
+    }
+
+    if ((IndexBytes + Entry.HeaderLength) > FSEQ_INDEX_MAX_BYTES)
+    {
+        FreeEntry (Entry);
+    }
+
+    IndexBytes     += Entry.HeaderLength;
+    Index[FileName] = Entry;
+
+    Unlock ();
+
+    // DEBUG_END;
+
+} // Insert
+
+//-----------------------------------------------------------------------------
+void c_FseqIndex::FreeEntry (Entry_t & Entry)
+{
+    if (nullptr != Entry.Header)
+    {
+        free (Entry.Header);
+        Entry.Header = nullptr;
+    }
+
+    Entry.HeaderLength = 0;
+    Entry.Checksum     = 0;
+
+} // FreeEntry
+
+//-----------------------------------------------------------------------------
+void c_FseqIndex::Clear ()
+{
+    // DEBUG_START;
+
+    Lock ();
+
+    for (auto & CurrentEntry : Index)
+    {
+        FreeEntry (CurrentEntry.second);
+    }
+    Index.clear ();
+    IndexBytes = 0;
+    Dirty      = false;
+
+    Unlock ();
+
+    // DEBUG_END;
+
+} // Clear
+
+//-----------------------------------------------------------------------------
+void c_FseqIndex::LoadIndexFile ()
+{
+    // DEBUG_START;
+
+    Clear ();
+
+    do // once
+    {
+        if (!FileMgr.SdCardIsInstalled ())
+        {
+            break;
+        }
+
+        fs::File IndexFile = FileMgr.GetSdFileSystem ().open (FileMgr.SdPath (String (F (FSEQ_INDEX_FILE_NAME))), CN_r);
+        if (!IndexFile)
+        {
+            // first time on this card. The scan builds it
+            break;
+        }
+
+        uint32_t Version = 0;
+        if ((sizeof (Version) != IndexFile.read ((uint8_t*)&Version, sizeof (Version))) || (FSEQ_INDEX_VERSION != Version))
+        {
+            logcon (String (F ("Sequence index is from another version. Rebuilding it.")));
+            IndexFile.close ();
+            break;
+        }
+
+        FileRecord_t Record;
+        char         NameBuffer[256];
+
+        while (sizeof (Record) == IndexFile.read ((uint8_t*)&Record, sizeof (Record)))
+        {
+            if ((Record.NameLength >= sizeof (NameBuffer)) || (Record.HeaderLength > FSEQ_INDEX_MAX_HEADER))
+            {
+                logcon (String (F ("Sequence index is damaged. Rebuilding it.")));
+                break;
+            }
+
+            if (Record.NameLength != IndexFile.read ((uint8_t*)NameBuffer, Record.NameLength))
+            {
+                break;
+            }
+            NameBuffer[Record.NameLength] = '\0';
+
+            Entry_t NewEntry;
+            NewEntry.Size     = Record.Size;
+            NewEntry.ModTime  = Record.ModTime;
+            NewEntry.Checksum = Record.Checksum;
+
+            if (Record.HeaderLength)
+            {
+                NewEntry.Header = (uint8_t*)malloc (Record.HeaderLength);
+                if (nullptr == NewEntry.Header)
+                {
+                    break;
+                }
+
+                if ((Record.HeaderLength != IndexFile.read (NewEntry.Header, Record.HeaderLength)) ||
+                    (Record.Checksum != CalculateChecksum (NewEntry.Header, Record.HeaderLength)))
+                {
+                    // the scan reads this one again
+                    logcon (String (F ("Sequence index entry for '")) + NameBuffer + F ("' is damaged"));
+                    FreeEntry (NewEntry);
+                    break;
+                }
+                NewEntry.HeaderLength = Record.HeaderLength;
+            }
+
+            Insert (String (NameBuffer), NewEntry);
+        }
+
+        IndexFile.close ();
+
+        logcon (String (F ("Loaded the headers of ")) + String (Index.size ()) + F (" sequences"));
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // LoadIndexFile
+
+//-----------------------------------------------------------------------------
+void c_FseqIndex::Save ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        fs::File IndexFile = FileMgr.GetSdFileSystem ().open (FileMgr.SdPath (String (F (FSEQ_INDEX_FILE_NAME))), "w");
+        if (!IndexFile)
+        {
+            logcon (String (F ("ERROR: Could not save the sequence index")));
+            break;
+        }
+
+        uint32_t Version = FSEQ_INDEX_VERSION;
+        IndexFile.write ((uint8_t*)&Version, sizeof (Version));
+
+        Lock ();
+        for (auto & CurrentEntry : Index)
+        {
+            FileRecord_t Record;
+            Record.Size         = CurrentEntry.second.Size;
+            Record.ModTime      = CurrentEntry.second.ModTime;
+            Record.Checksum     = CurrentEntry.second.Checksum;
+            Record.HeaderLength = CurrentEntry.second.HeaderLength;
+            Record.NameLength   = min (uint32_t (CurrentEntry.first.length ()), uint32_t (255));
+
+            IndexFile.write ((uint8_t*)&Record, sizeof (Record));
+            IndexFile.write ((uint8_t*)CurrentEntry.first.c_str (), Record.NameLength);
+            if (Record.HeaderLength)
+            {
+                IndexFile.write (CurrentEntry.second.Header, Record.HeaderLength);
+            }
+        }
+        Unlock ();
+
+        IndexFile.close ();
+        Dirty = false;
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // Save
+
+//-----------------------------------------------------------------------------
+String c_FseqIndex::BaseName (const String & FileName)
+{
+    return FileName.substring (FileName.lastIndexOf ('/') + 1);
+
+} // BaseName
+
+//-----------------------------------------------------------------------------
+uint32_t c_FseqIndex::CalculateChecksum (const uint8_t * Data, size_t Length)
+{
+    // FNV-1a
+    uint32_t Response = 2166136261;
+
+    while (Length--)
+    {
+        Response = (Response ^ *Data++) * 16777619;
+    }
+
+    return Response;
+
+} // CalculateChecksum
+
+// create a global instance of the sequence index
+c_FseqIndex FseqIndex;
@@ -0,0 +1,114 @@
+#pragma once
+/*
+* FseqIndex.hpp - Remember the headers of the sequences on the SD card
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   The index keeps a copy of everything in front of the channel data of
+*   each FSEQ file: the fixed header, the compression block table, the
+*   sparse ranges and the variable headers. Header reads are answered from
+*   the copy, so the existing parsers run unchanged without touching the
+*   card. An entry is only used while the file still has the size and
+*   modification time it had when it was indexed.
+*
+*   The index is saved on the card next to the sequences and loaded when
+*   the card is mounted. Poll () brings it up to date one file at a time
+*   after the card is mounted and after files are uploaded or deleted.
+*/
+
+#include "../ESPixelStick.h"
+#include "../FileMgr.hpp"
+#include "fseq.h"
+#include <map>
+
+class c_FseqIndex
+{
+public:
+    c_FseqIndex ();
+    virtual ~c_FseqIndex ();
+
+    void   Reload        () { LoadRequested = true; }       ///< Call when the card has been mounted
+    void   Poll          ();                ///< Call from loop ()
+    void   Rescan        () { RescanRequested = true; }     ///< Safe to call from any task
+    void   Forget        (const String & FileName);         ///< The file is about to change
+    size_t ReadHeader    (const String & FileName, c_FileMgr::FileId FileHandle, uint8_t * Destination, size_t Length, size_t Offset);
+    bool   IsIndexFile   (const String & FileName);
+    void   GetStatus     (JsonObject & json);
+    void   GetDriverName (String & Name) { Name = "FseqIndex"; }
+
+private:
+
+#define FSEQ_INDEX_FILE_NAME        "fseqindex.bin"
+#define FSEQ_INDEX_VERSION          1
+#define FSEQ_INDEX_MAX_HEADER       4096    // Larger headers are read from the file
+#ifdef ARDUINO_ARCH_ESP32
+#   define FSEQ_INDEX_MAX_BYTES     (32 * 1024)
+#else
+#   define FSEQ_INDEX_MAX_BYTES     (8 * 1024)
+#endif // def ARDUINO_ARCH_ESP32
+
+    struct Entry_t
+    {
+        uint32_t  Size         = 0;
+        uint32_t  ModTime      = 0;
+        uint32_t  Checksum     = 0;
+        uint16_t  HeaderLength = 0;         ///< 0 = known but not indexed
+        uint8_t * Header       = nullptr;
+        bool      Seen         = false;     ///< Found by the current scan
+    };
+
+    /// One record of the index file. Followed by the name and the header
+    struct FileRecord_t
+    {
+        uint32_t Size;
+        uint32_t ModTime;
+        uint32_t Checksum;
+        uint16_t HeaderLength;
+        uint16_t NameLength;
+    };
+
+    std::map<String, Entry_t> Index;
+    uint32_t      IndexBytes      = 0;
+    volatile bool LoadRequested   = false;
+    volatile bool RescanRequested = false;
+    bool          Scanning        = false;
+    bool          Dirty           = false;
+    fs::File      ScanDir;
+    uint32_t      Hits            = 0;
+    uint32_t      Misses          = 0;
+
+#ifdef ARDUINO_ARCH_ESP32
+    SemaphoreHandle_t IndexLock   = NULL;
+    void Lock   () { xSemaphoreTake (IndexLock, portMAX_DELAY); }
+    void Unlock () { xSemaphoreGive (IndexLock); }
+#else
+    void Lock   () {}
+    void Unlock () {}
+#endif // def ARDUINO_ARCH_ESP32
+
+    void     Clear        ();
+    void     LoadIndexFile ();
+    void     Save         ();
+    void     ScanNextFile ();
+    void     EndScan      ();
+    bool     ReadFileHeader (fs::File & SeqFile, Entry_t & Entry);
+    void     Insert       (const String & FileName, Entry_t & Entry);
+    void     FreeEntry    (Entry_t & Entry);
+    String   BaseName     (const String & FileName);
+    uint32_t CalculateChecksum (const uint8_t * Data, size_t Length);
+
+}; // c_FseqIndex
+
+extern c_FseqIndex FseqIndex;
@@ -0,0 +1,590 @@
+/*
+* FseqRecorder.cpp - Record the live frame buffer to an FSEQ file on the SD card
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "FseqRecorder.hpp"
+#include "fseq.h"
+#include "../output/OutputMgr.hpp"
+#include <time.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+//----------------------------------------------------------------------------
+static void FseqWriterTask (void * pvParameters)
+{
+    c_FseqRecorder * pRecorder = reinterpret_cast <c_FseqRecorder*> (pvParameters);
+
+    pRecorder->RunWriter ();
+    vTaskDelete (NULL);
+
+} // FseqWriterTask
+#endif // def ARDUINO_ARCH_ESP32
+
+//-----------------------------------------------------------------------------
+c_FseqRecorder::c_FseqRecorder ()
+{
+    memset ((void*)Blocks, 0x00, sizeof (Blocks));
+
+#ifdef ARDUINO_ARCH_ESP32
+    RequestLock = xSemaphoreCreateMutex ();
+#endif // def ARDUINO_ARCH_ESP32
+
+} // c_FseqRecorder
+
+//-----------------------------------------------------------------------------
+c_FseqRecorder::~c_FseqRecorder ()
+{
+    // DEBUG_START;
+
+    Stop ();
+
+    // DEBUG_END;
+
+} // ~c_FseqRecorder
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::RequestStart (const String & NewFileName, uint32_t NewStepTimeMS)
+{
+    // DEBUG_START;
+
+    Lock ();
+    RequestFileName   = NewFileName;
+    RequestStepTimeMS = NewStepTimeMS;
+    PendingRequest    = RequestStartRecording;
+    Unlock ();
+
+    // DEBUG_END;
+
+} // RequestStart
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::RequestStop ()
+{
+    // DEBUG_START;
+
+    Lock ();
+    PendingRequest = RequestStopRecording;
+    Unlock ();
+
+    // DEBUG_END;
+
+} // RequestStop
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::ProcessRequest ()
+{
+    // DEBUG_START;
+
+    Lock ();
+    Request_t Request     = PendingRequest;
+    String    NewFileName = RequestFileName;
+    uint32_t  NewStepTime = RequestStepTimeMS;
+    PendingRequest = RequestNone;
+    Unlock ();
+
+    if (RequestStopRecording == Request)
+    {
+        Stop ();
+    }
+    else if (RequestStartRecording == Request)
+    {
+        Start (NewFileName, NewStepTime);
+    }
+
+    // DEBUG_END;
+
+} // ProcessRequest
+
+//-----------------------------------------------------------------------------
+bool c_FseqRecorder::Start (const String & NewFileName, uint32_t NewStepTimeMS)
+{
+    // DEBUG_START;
+
+    bool Response = false;
+
+    do // once
+    {
+        if (Recording)
+        {
+            logcon (String (F ("Already recording to '")) + FileName + "'");
+            break;
+        }
+
+        if (!FileMgr.SdCardIsInstalled ())
+        {
+            logcon (String (F ("Cannot record. No SD card is installed.")));
+            break;
+        }
+
+        ChannelCount = OutputMgr.GetBufferUsedSize ();
+        if (0 == ChannelCount)
+        {
+            logcon (String (F ("Cannot record. No output channels are configured.")));
+            break;
+        }
+
+        StepTimeMS = max (uint32_t (FSEQ_RECORD_MIN_STEP_MS), min (NewStepTimeMS, uint32_t (FSEQ_RECORD_MAX_STEP_MS)));
+
+        // a block must hold at least one frame, rounded up to whole sectors
+        uint32_t BlockSize = max (uint32_t (FSEQ_RECORD_BLOCK_SIZE),
+                                  ((ChannelCount + FSEQ_RECORD_SECTOR_SIZE - 1) / FSEQ_RECORD_SECTOR_SIZE) * FSEQ_RECORD_SECTOR_SIZE);
+        BlockBufferSize = BlockSize;
+
+        bool AllocFailed = false;
+        for (WriteBlock_t & Block : Blocks)
+        {
+            Block.Used = 0;
+            Block.Full = false;
+            Block.Data = (uint8_t *)malloc (BlockSize);
+            AllocFailed |= (nullptr == Block.Data);
+        }
+
+        if (AllocFailed)
+        {
+            logcon (String (F ("ERROR: Could not allocate the record buffers.")));
+            FreeBlocks ();
+            break;
+        }
+
+        if (!FileMgr.OpenSdFile (NewFileName, c_FileMgr::FileMode::FileWrite, FileHandle))
+        {
+            logcon (String (F ("ERROR: Could not create '")) + NewFileName + "'");
+            FreeBlocks ();
+            break;
+        }
+
+        Lock ();
+        FileName         = NewFileName;
+        Unlock ();
+        ActiveBlock      = 0;
+        NextBlockToWrite = 0;
+        FramesRecorded   = 0;
+        FramesDropped    = 0;
+        BytesWritten     = 0;
+        WriteTimeUS      = 0;
+        MaxWriteTimeUS   = 0;
+        WriteError       = false;
+
+        // placeholder header. The frame count is filled in by Stop ()
+        WriteHeader ();
+
+#ifdef ARDUINO_ARCH_ESP32
+        if (NULL == BlockFreed)
+        {
+            BlockFreed = xSemaphoreCreateBinary ();
+        }
+
+        if (NULL == WriterDone)
+        {
+            WriterDone = xSemaphoreCreateBinary ();
+        }
+
+        if ((NULL == BlockFreed) || (NULL == WriterDone))
+        {
+            logcon (String (F ("ERROR: Could not create the record semaphore.")));
+            FileMgr.CloseSdFile (FileHandle);
+            FreeBlocks ();
+            break;
+        }
+
+        // forget a notice left over from the last recording
+        xSemaphoreTake (BlockFreed, 0);
+        WriterExit = false;
+
+        xTaskCreate (FseqWriterTask, "FseqRecTask", FSEQ_RECORD_TASK_STACK, this, ESP_TASK_PRIO_MIN + 3, &WriterTaskHandle);
+        if (NULL == WriterTaskHandle)
+        {
+            logcon (String (F ("ERROR: Could not start the record writer task.")));
+            FileMgr.CloseSdFile (FileHandle);
+            FreeBlocks ();
+            break;
+        }
+#endif // def ARDUINO_ARCH_ESP32
+
+        NextFrameTimeMS = millis ();
+        Recording = true;
+        Response = true;
+
+        logcon (String (F ("Recording ")) + String (ChannelCount) + F (" channels every ") + String (StepTimeMS) + F ("ms to '") + FileName + "'");
+
+    } while (false);
+
+    // DEBUG_END;
+    return Response;
+
+} // Start
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::Stop ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        if (!Recording)
+        {
+            break;
+        }
+
+        Recording = false;
+
+        // hand over the partial block
+        if (0 != Blocks[ActiveBlock].Used)
+        {
+            QueueActiveBlock ();
+        }
+
+#ifdef ARDUINO_ARCH_ESP32
+        bool Drained = WaitForWriter ();
+
+        // The writer may still be inside an SD write holding the file system
+        // lock. Ask it to end and wait until it has let go of the card.
+        WriterExit = true;
+        xTaskNotifyGive (WriterTaskHandle);
+        xSemaphoreTake (WriterDone, portMAX_DELAY);
+        WriterTaskHandle = NULL;
+
+        if (!Drained)
+        {
+            logcon (String (F ("ERROR: The SD card stopped accepting data. Discarding '")) + FileName + "'");
+            FileMgr.CloseSdFile (FileHandle);
+            FileMgr.DeleteSdFile (FileName);
+            FreeBlocks ();
+            break;
+        }
+#else
+        WriteFullBlocks ();
+#endif // def ARDUINO_ARCH_ESP32
+
+        WriteHeader ();
+        FileMgr.CloseSdFile (FileHandle);
+        FreeBlocks ();
+
+        uint32_t KBPerSec = (0 == WriteTimeUS) ? 0 : uint32_t ((BytesWritten * 1000000) / WriteTimeUS / 1024);
+        logcon (String (F ("Recorded ")) + String (FramesRecorded) + F (" frames to '") + FileName +
+                F ("'. Dropped: ") + String (FramesDropped) + F (". SD write rate: ") + String (KBPerSec) + F (" KB/s"));
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // Stop
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::Poll ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        if (RequestNone != PendingRequest)
+        {
+            ProcessRequest ();
+        }
+
+        if (!Recording)
+        {
+            break;
+        }
+
+#ifndef ARDUINO_ARCH_ESP32
+        // no writer task. Get the SD work out of the way first.
+        WriteFullBlocks ();
+#endif // ndef ARDUINO_ARCH_ESP32
+
+        if (WriteError)
+        {
+            logcon (String (F ("ERROR: SD write failed. Recording stopped.")));
+            Stop ();
+            break;
+        }
+
+        if (OutputMgr.GetBufferUsedSize () != ChannelCount)
+        {
+            logcon (String (F ("Output configuration changed. Recording stopped.")));
+            Stop ();
+            break;
+        }
+
+        uint32_t Now = millis ();
+        if (int32_t (Now - NextFrameTimeMS) > int32_t (FSEQ_RECORD_MAX_STEP_MS * 4))
+        {
+            // the loop stalled for a long time. Account for the gap and start over from now.
+            FramesDropped += (Now - NextFrameTimeMS) / StepTimeMS;
+            NextFrameTimeMS = Now;
+        }
+
+        // capture one frame for every step that has gone by so the file keeps time
+        while (int32_t (Now - NextFrameTimeMS) >= 0)
+        {
+            CaptureFrame ();
+            NextFrameTimeMS += StepTimeMS;
+        }
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // Poll
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::CaptureFrame ()
+{
+    // DEBUG_START;
+
+    do // once
+    {
+        WriteBlock_t & CurrentBlock = Blocks[ActiveBlock];
+        WriteBlock_t & NextBlock    = Blocks[(ActiveBlock + 1) % FSEQ_RECORD_NUM_BLOCKS];
+
+        uint32_t SpaceInCurrentBlock = BlockBufferSize - CurrentBlock.Used;
+        if (CurrentBlock.Full ||
+            ((SpaceInCurrentBlock < ChannelCount) && NextBlock.Full))
+        {
+            // the SD card is behind. Do not stall the input.
+            ++FramesDropped;
+            break;
+        }
+
+        uint8_t * FrameData = OutputMgr.GetBufferAddress ();
+        uint32_t  FirstPart = min (SpaceInCurrentBlock, ChannelCount);
+
+        memcpy (&CurrentBlock.Data[CurrentBlock.Used], FrameData, FirstPart);
+        CurrentBlock.Used += FirstPart;
+
+        if (CurrentBlock.Used == BlockBufferSize)
+        {
+            QueueActiveBlock ();
+        }
+
+        if (FirstPart < ChannelCount)
+        {
+            // the rest of the frame starts the next block
+            WriteBlock_t & NewBlock = Blocks[ActiveBlock];
+            memcpy (NewBlock.Data, &FrameData[FirstPart], ChannelCount - FirstPart);
+            NewBlock.Used = ChannelCount - FirstPart;
+        }
+
+        ++FramesRecorded;
+
+    } while (false);
+
+    // DEBUG_END;
+
+} // CaptureFrame
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::QueueActiveBlock ()
+{
+    // DEBUG_START;
+
+    Blocks[ActiveBlock].Full = true;
+    ActiveBlock = (ActiveBlock + 1) % FSEQ_RECORD_NUM_BLOCKS;
+
+#ifdef ARDUINO_ARCH_ESP32
+    xTaskNotifyGive (WriterTaskHandle);
+#endif // def ARDUINO_ARCH_ESP32
+
+    // DEBUG_END;
+
+} // QueueActiveBlock
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::WriteFullBlocks ()
+{
+    // DEBUG_START;
+
+    while (!WriterExit && Blocks[NextBlockToWrite].Full)
+    {
+        WriteBlock_t & Block = Blocks[NextBlockToWrite];
+        WriteBlock (Block);
+
+        // give the block back to Poll ()
+        Block.Used = 0;
+        Block.Full = false;
+        NextBlockToWrite = (NextBlockToWrite + 1) % FSEQ_RECORD_NUM_BLOCKS;
+
+#ifdef ARDUINO_ARCH_ESP32
+        xSemaphoreGive (BlockFreed);
+#endif // def ARDUINO_ARCH_ESP32
+    }
+
+    // DEBUG_END;
+
+} // WriteFullBlocks
+
+#ifdef ARDUINO_ARCH_ESP32
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::RunWriter ()
+{
+    // DEBUG_START;
+
+    while (!WriterExit)
+    {
+        // sleep until Poll () hands over a full block or Stop () ends the recording
+        ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+        WriteFullBlocks ();
+    }
+
+    // Stop () may now close the file and free the blocks
+    xSemaphoreGive (WriterDone);
+
+    // DEBUG_END;
+
+} // RunWriter
+
+//-----------------------------------------------------------------------------
+/*
+    Sleep until the writer has given every block back. Returns false if it
+    stops freeing blocks for FSEQ_RECORD_WAIT_MS.
+*/
+bool c_FseqRecorder::WaitForWriter ()
+{
+    // DEBUG_START;
+
+    bool Response = true;
+
+    for (WriteBlock_t & Block : Blocks)
+    {
+        while (Response && Block.Full)
+        {
+            Response = (pdTRUE == xSemaphoreTake (BlockFreed, pdMS_TO_TICKS (FSEQ_RECORD_WAIT_MS)));
+        }
+    }
+
+    // DEBUG_END;
+
+    return Response;
+
+} // WaitForWriter
+#endif // def ARDUINO_ARCH_ESP32
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::WriteBlock (WriteBlock_t & Block)
+{
+    // DEBUG_START;
+
+    uint32_t StartTimeUS = micros ();
+    size_t   WriteCount  = FileMgr.WriteSdFile (FileHandle, Block.Data, Block.Used);
+    uint32_t ElapsedUS   = micros () - StartTimeUS;
+
+    WriteTimeUS   += ElapsedUS;
+    MaxWriteTimeUS = max (MaxWriteTimeUS, ElapsedUS);
+    BytesWritten  += WriteCount;
+
+    if (WriteCount != Block.Used)
+    {
+        WriteError = true;
+    }
+
+    // DEBUG_END;
+
+} // WriteBlock
+
+//-----------------------------------------------------------------------------
+/*
+    Writes the first sector of the file. The space between the fixed header
+    and the channel data is filled with an 'sp' (sequence producer) variable
+    header so readers skip it cleanly.
+*/
+void c_FseqRecorder::WriteHeader ()
+{
+    // DEBUG_START;
+
+    uint8_t Header[FSEQ_RECORD_DATA_OFFSET];
+    memset (Header, 0x00, sizeof (Header));
+
+    FSEQRawHeader & RawHeader = *((FSEQRawHeader *)Header);
+    memcpy (RawHeader.header, "PSEQ", sizeof (RawHeader.header));
+    write16 (RawHeader.dataOffset, FSEQ_RECORD_DATA_OFFSET);
+    RawHeader.minorVersion = 0;
+    RawHeader.majorVersion = 2;
+    write16 (RawHeader.VariableHdrOffset, sizeof (FSEQRawHeader));
+    write32 (RawHeader.channelCount, ChannelCount);
+    write32 (RawHeader.TotalNumberOfFramesInSequence, FramesRecorded);
+    RawHeader.stepTime            = StepTimeMS;
+    RawHeader.flags               = 0;
+    RawHeader.compressionType     = 0;
+    RawHeader.numCompressedBlocks = 0;
+    RawHeader.numSparseRanges     = 0;
+    RawHeader.flags2              = 0;
+
+    uint64_t id = uint64_t (time (nullptr)) * 1000000;
+    for (uint32_t index = 0; index < sizeof (RawHeader.id); ++index)
+    {
+        RawHeader.id[index] = uint8_t (id >> (index * 8));
+    }
+
+    FSEQRawVariableDataHeader & Producer = *((FSEQRawVariableDataHeader *)&Header[sizeof (FSEQRawHeader)]);
+    write16 (Producer.length, FSEQ_RECORD_DATA_OFFSET - sizeof (FSEQRawHeader));
+    Producer.type[0] = 's';
+    Producer.type[1] = 'p';
+    String ProducerName = String (CN_ESPixelStick) + F (" v") + VERSION;
+    strncpy ((char *)&Producer.data, ProducerName.c_str (), FSEQ_RECORD_DATA_OFFSET - sizeof (FSEQRawHeader) - 5);
+
+    uint32_t StartTimeUS = micros ();
+    FileMgr.WriteSdFile (FileHandle, Header, sizeof (Header), 0);
+    WriteTimeUS += micros () - StartTimeUS;
+
+    // DEBUG_END;
+
+} // WriteHeader
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::FreeBlocks ()
+{
+    // DEBUG_START;
+
+    for (WriteBlock_t & Block : Blocks)
+    {
+        if (nullptr != Block.Data)
+        {
+            free (Block.Data);
+            Block.Data = nullptr;
+        }
+        Block.Used = 0;
+        Block.Full = false;
+    }
+
+    // DEBUG_END;
+
+} // FreeBlocks
+
+//-----------------------------------------------------------------------------
+void c_FseqRecorder::GetStatus (JsonObject & json)
+{
+    // DEBUG_START;
+
+    JsonObject RecordStatus = json.createNestedObject (F ("recorder"));
+
+    Lock ();
+    String CurrentFileName = FileName;
+    Unlock ();
+
+    RecordStatus[F ("recording")]   = Recording;
+    RecordStatus[CN_filename]       = CurrentFileName;
+    RecordStatus[F ("frames")]      = FramesRecorded;
+    RecordStatus[F ("dropped")]     = FramesDropped;
+    RecordStatus[F ("kbpersec")]    = (0 == WriteTimeUS) ? 0 : uint32_t ((BytesWritten * 1000000) / WriteTimeUS / 1024);
+    RecordStatus[F ("maxwriteus")]  = MaxWriteTimeUS;
+
+    // DEBUG_END;
+
+} // GetStatus
+
+// create a global instance of the recorder
+c_FseqRecorder FseqRecorder;
@@ -0,0 +1,132 @@
+#pragma once
+/*
+* FseqRecorder.hpp - Record the live frame buffer to an FSEQ file on the SD card
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   Poll () copies the output buffer into the active write block once per
+*   step time. Full blocks are handed to a writer task (ESP32) so the SD
+*   card never stalls the main loop. The ESP8266 has no tasks and writes
+*   the block from Poll ().
+*
+*   Recordings are started and stopped through RequestStart () and
+*   RequestStop (), which only post the request. Poll () carries it out so
+*   the recorder state is only ever changed from loop ().
+*
+*   The file is an uncompressed v2 FSEQ with no sparse ranges. The channel
+*   data starts on a sector boundary so every block write is sector aligned.
+*/
+
+#include "../ESPixelStick.h"
+#include "../FileMgr.hpp"
+
+class c_FseqRecorder
+{
+public:
+    c_FseqRecorder ();
+    virtual ~c_FseqRecorder ();
+
+    void RequestStart  (const String & FileName, uint32_t StepTimeMS); ///< Any task. Poll () starts the recording
+    void RequestStop   ();                      ///< Any task. Poll () stops the recording
+    void Poll          ();                      ///< Call from loop ()
+    void GetStatus     (JsonObject & json);
+    bool IsRecording   () { return Recording; }
+    void GetDriverName (String & Name) { Name = "FseqRecorder"; }
+
+#ifdef ARDUINO_ARCH_ESP32
+    void RunWriter     ();                      ///< Body of the writer task
+#endif // def ARDUINO_ARCH_ESP32
+
+private:
+
+#define FSEQ_RECORD_SECTOR_SIZE     512
+#define FSEQ_RECORD_DATA_OFFSET     FSEQ_RECORD_SECTOR_SIZE     // header + padding
+#define FSEQ_RECORD_MIN_STEP_MS     10
+#define FSEQ_RECORD_MAX_STEP_MS     255
+#define FSEQ_RECORD_NUM_BLOCKS      2
+#ifdef ARDUINO_ARCH_ESP32
+#   define FSEQ_RECORD_BLOCK_SIZE   (8 * FSEQ_RECORD_SECTOR_SIZE)
+#   define FSEQ_RECORD_TASK_STACK   4096
+#   define FSEQ_RECORD_WAIT_MS      2000    // longest Stop () waits for the writer to free a block
+#else
+#   define FSEQ_RECORD_BLOCK_SIZE   (2 * FSEQ_RECORD_SECTOR_SIZE)
+#endif // def ARDUINO_ARCH_ESP32
+
+    typedef struct
+    {
+        uint8_t         * Data;
+        uint32_t          Used;
+        volatile bool     Full;     ///< Owned by the writer until it is cleared
+    } WriteBlock_t;
+
+    WriteBlock_t        Blocks[FSEQ_RECORD_NUM_BLOCKS];
+    uint32_t            BlockBufferSize = 0;    ///< Bytes in each block. Whole sectors
+    uint32_t            ActiveBlock     = 0;    ///< Block Poll () is filling
+    uint32_t            NextBlockToWrite = 0;   ///< Block the writer takes next
+
+    typedef enum
+    {
+        RequestNone = 0,
+        RequestStartRecording,
+        RequestStopRecording,
+    } Request_t;
+
+    volatile Request_t  PendingRequest  = RequestNone;
+    String              RequestFileName;
+    uint32_t            RequestStepTimeMS = 25;
+
+    bool                Recording       = false;
+    c_FileMgr::FileId   FileHandle      = 0;
+    String              FileName;
+    uint32_t            StepTimeMS      = 25;
+    uint32_t            ChannelCount    = 0;
+    uint32_t            NextFrameTimeMS = 0;
+    uint32_t            FramesRecorded  = 0;
+    uint32_t            FramesDropped   = 0;    ///< Both blocks were waiting for the SD card
+    uint64_t            BytesWritten    = 0;
+    uint64_t            WriteTimeUS     = 0;    ///< Time spent inside SD writes
+    uint32_t            MaxWriteTimeUS  = 0;
+    bool                WriteError      = false;
+    volatile bool       WriterExit      = false; ///< Tells the writer to stop taking blocks
+
+#ifdef ARDUINO_ARCH_ESP32
+    SemaphoreHandle_t   RequestLock      = NULL; ///< Guards the request and FileName
+    void Lock   () { xSemaphoreTake (RequestLock, portMAX_DELAY); }
+    void Unlock () { xSemaphoreGive (RequestLock); }
+
+    TaskHandle_t        WriterTaskHandle = NULL;
+    SemaphoreHandle_t   BlockFreed       = NULL; ///< Given by the writer each time it frees a block
+    SemaphoreHandle_t   WriterDone       = NULL; ///< Given by the writer just before it ends
+
+    bool WaitForWriter    ();
+#else
+    void Lock   () {}
+    void Unlock () {}
+#endif // def ARDUINO_ARCH_ESP32
+
+    bool Start            (const String & FileName, uint32_t StepTimeMS);
+    void Stop             ();
+    void ProcessRequest   ();
+    void WriteFullBlocks  ();
+
+    void CaptureFrame     ();
+    void QueueActiveBlock ();
+    void WriteBlock       (WriteBlock_t & Block);
+    void WriteHeader      ();
+    void FreeBlocks       ();
+
+}; // c_FseqRecorder
+
+extern c_FseqRecorder FseqRecorder;
@@ -0,0 +1,226 @@
+/*
+* LatencyTracker.cpp - Measure the time from packet arrival to output start
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*/
+
+#include "LatencyTracker.hpp"
+
+//-----------------------------------------------------------------------------
+c_LatencyTracker::c_LatencyTracker ()
+{
+    memset ((void*)&Results, 0x00, sizeof (Results));
+} // c_LatencyTracker
+
+//-----------------------------------------------------------------------------
+/*
+    Works from tasks and from ISRs. The ESP8266 masks interrupts. The ESP32
+    takes the spinlock with the variant that matches the caller.
+*/
+uint32_t c_LatencyTracker::EnterCritical ()
+{
+    uint32_t SavedState = 0;
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (xPortInIsrContext ())
+    {
+        portENTER_CRITICAL_ISR (&ResultsLock);
+    }
+    else
+    {
+        portENTER_CRITICAL (&ResultsLock);
+    }
+#else
+    SavedState = xt_rsil (15);
+#endif // def ARDUINO_ARCH_ESP32
+
+    return SavedState;
+
+} // EnterCritical
+
+//-----------------------------------------------------------------------------
+void c_LatencyTracker::ExitCritical (uint32_t SavedState)
+{
+#ifdef ARDUINO_ARCH_ESP32
+    if (xPortInIsrContext ())
+    {
+        portEXIT_CRITICAL_ISR (&ResultsLock);
+    }
+    else
+    {
+        portEXIT_CRITICAL (&ResultsLock);
+    }
+#else
+    xt_wsr_ps (SavedState);
+#endif // def ARDUINO_ARCH_ESP32
+
+} // ExitCritical
+
+//-----------------------------------------------------------------------------
+/*
+    Only the oldest data that has not been output yet counts. Later packets
+    for the same frame do not move the start of the measurement.
+*/
+void c_LatencyTracker::DataArrived (uint32_t ArrivalTimeUS)
+{
+    uint32_t SavedState = EnterCritical ();
+
+    if (!ArrivalIsPending)
+    {
+        PendingArrivalUS = ArrivalTimeUS;
+        ArrivalIsPending = true;
+    }
+
+    ExitCritical (SavedState);
+
+} // DataArrived
+
+//-----------------------------------------------------------------------------
+void c_LatencyTracker::FrameStarted ()
+{
+    uint32_t Now = micros ();
+    uint32_t SavedState = EnterCritical ();
+
+    do // once
+    {
+        if (!ArrivalIsPending)
+        {
+            // nothing new since the last frame
+            break;
+        }
+
+        uint32_t LatencyUS = Now - PendingArrivalUS;
+        ArrivalIsPending = false;
+
+        uint32_t Bucket = min (uint32_t (LatencyUS / LATENCY_BUCKET_WIDTH_US), uint32_t (LATENCY_NUM_BUCKETS - 1));
+        ++Results.Histogram[Bucket];
+        ++Results.NumSamples;
+        Results.LastLatencyUS = LatencyUS;
+        Results.MaxLatencyUS  = max (Results.MaxLatencyUS, LatencyUS);
+
+    } while (false);
+
+    ExitCritical (SavedState);
+
+} // FrameStarted
+
+//-----------------------------------------------------------------------------
+void c_LatencyTracker::TakeSnapshot (Results_t & Snapshot)
+{
+    uint32_t SavedState = EnterCritical ();
+    memcpy ((void*)&Snapshot, (void*)&Results, sizeof (Snapshot));
+    ExitCritical (SavedState);
+
+} // TakeSnapshot
+
+//-----------------------------------------------------------------------------
+/*
+    Returns the upper edge of the bucket that holds the requested percentile.
+*/
+uint32_t c_LatencyTracker::Percentile (Results_t & Snapshot, uint32_t Percent)
+{
+    uint32_t Response = 0;
+
+    do // once
+    {
+        if (0 == Snapshot.NumSamples)
+        {
+            break;
+        }
+
+        // rank of the sample we are looking for. Round up.
+        uint32_t Target = (uint32_t (uint64_t (Snapshot.NumSamples) * Percent) + 99) / 100;
+        uint32_t Count  = 0;
+
+        for (uint32_t Bucket = 0; Bucket < LATENCY_NUM_BUCKETS; ++Bucket)
+        {
+            Count += Snapshot.Histogram[Bucket];
+            if (Count >= Target)
+            {
+                Response = min ((Bucket + 1) * LATENCY_BUCKET_WIDTH_US, Snapshot.MaxLatencyUS);
+                break;
+            }
+        }
+
+    } while (false);
+
+    return Response;
+
+} // Percentile
+
+//-----------------------------------------------------------------------------
+void c_LatencyTracker::AddSummary (JsonObject & LatencyStatus, Results_t & Snapshot)
+{
+    LatencyStatus[F ("samples")] = Snapshot.NumSamples;
+    LatencyStatus[F ("lastus")]  = Snapshot.LastLatencyUS;
+    LatencyStatus[F ("p50us")]   = Percentile (Snapshot, 50);
+    LatencyStatus[F ("p95us")]   = Percentile (Snapshot, 95);
+    LatencyStatus[F ("maxus")]   = Snapshot.MaxLatencyUS;
+
+} // AddSummary
+
+//-----------------------------------------------------------------------------
+void c_LatencyTracker::GetStatus (JsonObject & json)
+{
+    // DEBUG_START;
+
+    Results_t Snapshot;
+    TakeSnapshot (Snapshot);
+
+    JsonObject LatencyStatus = json.createNestedObject (F ("latency"));
+    AddSummary (LatencyStatus, Snapshot);
+
+    // DEBUG_END;
+
+} // GetStatus
+
+//-----------------------------------------------------------------------------
+void c_LatencyTracker::GetHistogram (JsonObject & json)
+{
+    // DEBUG_START;
+
+    // the summary and the buckets come from the same copy
+    Results_t Snapshot;
+    TakeSnapshot (Snapshot);
+
+    JsonObject LatencyStatus = json.createNestedObject (F ("latency"));
+    AddSummary (LatencyStatus, Snapshot);
+    LatencyStatus[F ("bucketus")] = LATENCY_BUCKET_WIDTH_US;
+
+    JsonArray Buckets = LatencyStatus.createNestedArray (F ("buckets"));
+    for (uint32_t Bucket = 0; Bucket < LATENCY_NUM_BUCKETS; ++Bucket)
+    {
+        Buckets.add (Snapshot.Histogram[Bucket]);
+    }
+
+    // DEBUG_END;
+
+} // GetHistogram
+
+//-----------------------------------------------------------------------------
+void c_LatencyTracker::Reset ()
+{
+    uint32_t SavedState = EnterCritical ();
+
+    memset ((void*)&Results, 0x00, sizeof (Results));
+    ArrivalIsPending = false;
+
+    ExitCritical (SavedState);
+
+} // Reset
+
+// create a global instance of the latency tracker
+c_LatencyTracker LatencyTracker;
@@ -0,0 +1,74 @@
+#pragma once
+/*
+* LatencyTracker.hpp - Measure the time from packet arrival to output start
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   The network inputs report when data that is about to be output arrived
+*   (for latched protocols, when the sync / push packet arrived). The next
+*   output frame that starts closes the measurement. Results are kept in a
+*   fixed bucket histogram so the percentiles cost no memory per frame.
+*
+*   FrameStarted () can be called from an output ISR, DataArrived () from
+*   the UDP receive task and the rest from the web server. Everything is
+*   updated in a short critical section and the status is built from a
+*   copy taken under the same lock.
+*/
+
+#include "../ESPixelStick.h"
+
+class c_LatencyTracker
+{
+public:
+    c_LatencyTracker ();
+    virtual ~c_LatencyTracker () {}
+
+    void DataArrived   (uint32_t ArrivalTimeUS);    ///< New data is in the input buffer
+    void FrameStarted  ();                          ///< An output has started sending a frame
+    void GetStatus     (JsonObject & json);         ///< Summary for the status page
+    void GetHistogram  (JsonObject & json);         ///< Summary plus all of the buckets
+    void Reset         ();
+    void GetDriverName (String & Name) { Name = "Latency"; }
+
+private:
+
+#define LATENCY_BUCKET_WIDTH_US     500
+#define LATENCY_NUM_BUCKETS         128     // last bucket collects everything over 63.5 ms
+
+    typedef struct
+    {
+        uint32_t    Histogram[LATENCY_NUM_BUCKETS];
+        uint32_t    NumSamples;
+        uint32_t    MaxLatencyUS;
+        uint32_t    LastLatencyUS;
+    } Results_t;
+
+    Results_t           Results;
+    uint32_t            PendingArrivalUS = 0;
+    bool                ArrivalIsPending = false;
+
+#ifdef ARDUINO_ARCH_ESP32
+    portMUX_TYPE        ResultsLock = portMUX_INITIALIZER_UNLOCKED;
+#endif // def ARDUINO_ARCH_ESP32
+
+    uint32_t EnterCritical ();
+    void     ExitCritical  (uint32_t SavedState);
+    void     TakeSnapshot  (Results_t & Snapshot);
+    void     AddSummary    (JsonObject & LatencyStatus, Results_t & Snapshot);
+    uint32_t Percentile    (Results_t & Snapshot, uint32_t Percent);
+
+}; // c_LatencyTracker
+
+extern c_LatencyTracker LatencyTracker;
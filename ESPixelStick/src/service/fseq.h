@@ -112,6 +112,19 @@ struct FSEQRawHeader
     uint8_t  id[8];
 } __attribute__ ((packed));
 
+// compressionType holds the type in the low nibble. v2.1 keeps the upper
+// four bits of the compressed block count in the high nibble.
+#define FSEQ_COMPRESSION_NONE   0
+#define FSEQ_COMPRESSION_ZSTD   1
+#define FSEQ_COMPRESSION_ZLIB   2
+
+struct FSEQRawCompressedBlockEntry
+{
+    uint8_t FirstFrame[4];
+    uint8_t Length[4];
+
+} __attribute__ ((packed));
+
 struct FSEQParsedHeader
 {
     uint8_t  header[4];    // PSEQ
@@ -166,3 +179,34 @@ inline uint16_t read16 (uint8_t* pData)
     return ((uint16_t)(pData[0]) |
         (uint16_t)(pData[1]) << 8);
 } // read16
+//-----------------------------------------------------------------------------
+inline uint8_t FseqCompressionType (const FSEQRawHeader & RawHeader)
+{
+    return RawHeader.compressionType & 0x0f;
+} // FseqCompressionType
+//-----------------------------------------------------------------------------
+inline uint32_t FseqNumCompressedBlocks (const FSEQRawHeader & RawHeader)
+{
+    return (uint32_t (RawHeader.compressionType & 0xf0) << 4) | uint32_t (RawHeader.numCompressedBlocks);
+} // FseqNumCompressedBlocks
+//-----------------------------------------------------------------------------
+inline void write16 (uint8_t* pData, uint16_t value)
+{
+    pData[0] = uint8_t (value);
+    pData[1] = uint8_t (value >> 8);
+} // write16
+//-----------------------------------------------------------------------------
+inline void write24 (uint8_t* pData, uint32_t value)
+{
+    pData[0] = uint8_t (value);
+    pData[1] = uint8_t (value >> 8);
+    pData[2] = uint8_t (value >> 16);
+} // write24
+//-----------------------------------------------------------------------------
+inline void write32 (uint8_t* pData, uint32_t value)
+{
+    pData[0] = uint8_t (value);
+    pData[1] = uint8_t (value >> 8);
+    pData[2] = uint8_t (value >> 16);
+    pData[3] = uint8_t (value >> 24);
+} // write32
@@ -0,0 +1,502 @@
+/*
+* test_main.cpp - Host tests for the E1.31, Art-Net and DDP decoders
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   pio test -e native -f test_packet_decode
+*/
+
+#include <unity.h>
+#include <string.h>
+#include "input/InputPacketDecode.hpp"
+
+static uint8_t Packet[1500];
+
+void setUp (void) {}
+void tearDown (void) {}
+
+//-----------------------------------------------------------------------------
+static void WriteBE16 (uint8_t * Data, uint16_t Value)
+{
+    Data[0] = uint8_t (Value >> 8);
+    Data[1] = uint8_t (Value);
+} // WriteBE16
+
+//-----------------------------------------------------------------------------
+static void WriteBE32 (uint8_t * Data, uint32_t Value)
+{
+    WriteBE16 (&Data[0], uint16_t (Value >> 16));
+    WriteBE16 (&Data[2], uint16_t (Value));
+} // WriteBE32
+
+//-----------------------------------------------------------------------------
+static void WriteE131Root (uint32_t RootVector, uint32_t FrameVector)
+{
+    static const uint8_t AcnId[12] = { 0x41, 0x53, 0x43, 0x2d, 0x45, 0x31, 0x2e, 0x31, 0x37, 0x00, 0x00, 0x00 };
+
+    memset (Packet, 0x00, sizeof (Packet));
+    memcpy (&Packet[4], AcnId, sizeof (AcnId));
+    WriteBE32 (&Packet[18], RootVector);
+    for (uint8_t Index = 0; Index < E131_CID_SIZE; ++Index)
+    {
+        Packet[22 + Index] = uint8_t (0xa0 + Index);
+    }
+    WriteBE32 (&Packet[40], FrameVector);
+} // WriteE131Root
+
+//-----------------------------------------------------------------------------
+/// Returns the length of a data packet carrying NumSlots slots
+static size_t BuildE131Data (uint16_t Universe, uint16_t NumSlots)
+{
+    WriteE131Root (E131_VECTOR_ROOT_DATA, E131_VECTOR_FRAME_DATA);
+    Packet[108] = 150;                          // priority
+    WriteBE16 (&Packet[109], 7);                // sync address
+    Packet[111] = 42;                           // sequence
+    Packet[112] = 0x00;                         // options
+    WriteBE16 (&Packet[113], Universe);
+    Packet[117] = E131_VECTOR_DMP_SET_PROPERTY;
+    WriteBE16 (&Packet[123], uint16_t (NumSlots + 1));
+    Packet[125] = E131_DMX_START_CODE;
+    for (uint16_t Slot = 0; Slot < NumSlots; ++Slot)
+    {
+        Packet[E131_HEADER_SIZE + Slot] = uint8_t (Slot);
+    }
+
+    return E131_HEADER_SIZE + NumSlots;
+
+} // BuildE131Data
+
+//-----------------------------------------------------------------------------
+static size_t BuildE131Sync (uint16_t SyncAddress)
+{
+    WriteE131Root (E131_VECTOR_ROOT_EXTENDED, E131_VECTOR_EXTENDED_SYNC);
+    WriteBE16 (&Packet[45], SyncAddress);
+
+    return E131_SYNC_PACKET_SIZE;
+
+} // BuildE131Sync
+
+//-----------------------------------------------------------------------------
+static size_t BuildE131Discovery (const uint16_t * Universes, uint32_t NumUniverses)
+{
+    WriteE131Root (E131_VECTOR_ROOT_EXTENDED, E131_VECTOR_EXTENDED_DISCOVERY);
+    memcpy (&Packet[44], "Test Source", 12);
+    WriteBE32 (&Packet[114], E131_VECTOR_DISCOVERY_LIST);
+    Packet[118] = 1;                            // page
+    Packet[119] = 2;                            // last page
+    for (uint32_t Index = 0; Index < NumUniverses; ++Index)
+    {
+        WriteBE16 (&Packet[E131_DISCOVERY_HEADER_SIZE + Index * 2], Universes[Index]);
+    }
+
+    return E131_DISCOVERY_HEADER_SIZE + NumUniverses * 2;
+
+} // BuildE131Discovery
+
+//-----------------------------------------------------------------------------
+static size_t BuildArtDmx (uint8_t Net, uint8_t SubUni, uint16_t NumSlots)
+{
+    static const uint8_t ArtnetId[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0x00 };
+
+    memset (Packet, 0x00, sizeof (Packet));
+    memcpy (Packet, ArtnetId, sizeof (ArtnetId));
+    Packet[8]  = 0x00;                          // OpDmx, little endian
+    Packet[9]  = 0x50;
+    WriteBE16 (&Packet[10], 14);                // ProtVer
+    Packet[12] = 9;                             // sequence
+    Packet[14] = SubUni;
+    Packet[15] = Net;
+    WriteBE16 (&Packet[16], NumSlots);
+    for (uint16_t Slot = 0; Slot < NumSlots; ++Slot)
+    {
+        Packet[ARTNET_DMX_HEADER_SIZE + Slot] = uint8_t (0xff - Slot);
+    }
+
+    return ARTNET_DMX_HEADER_SIZE + NumSlots;
+
+} // BuildArtDmx
+
+//-----------------------------------------------------------------------------
+static size_t BuildDdp (uint8_t Flags1, uint32_t ChannelOffset, uint16_t DataLength)
+{
+    memset (Packet, 0x00, sizeof (Packet));
+    Packet[0] = Flags1;
+    Packet[1] = 0x03;                           // sequence
+    Packet[2] = 0x01;                           // type
+    Packet[3] = 0x01;                           // id
+    WriteBE32 (&Packet[4], ChannelOffset);
+    WriteBE16 (&Packet[8], DataLength);
+
+    size_t HeaderLength = DDP_HEADER_SIZE + ((Flags1 & DDP_FLAGS1_TIME) ? DDP_TIMECODE_SIZE : 0);
+    for (uint16_t Index = 0; Index < DataLength; ++Index)
+    {
+        Packet[HeaderLength + Index] = uint8_t (Index * 3);
+    }
+
+    return HeaderLength + DataLength;
+
+} // BuildDdp
+
+//-----------------------------------------------------------------------------
+// E1.31 data
+//-----------------------------------------------------------------------------
+void test_e131_data_good (void)
+{
+    E131DataFrame_t Frame;
+    size_t Length = BuildE131Data (1234, 512);
+
+    TEST_ASSERT_TRUE (DecodeE131Data (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT16 (1234, Frame.universe);
+    TEST_ASSERT_EQUAL_UINT8 (150, Frame.priority);
+    TEST_ASSERT_EQUAL_UINT16 (7, Frame.syncAddress);
+    TEST_ASSERT_EQUAL_UINT8 (42, Frame.sequence);
+    TEST_ASSERT_EQUAL_PTR (&Packet[22], Frame.cid);
+    TEST_ASSERT_EQUAL_PTR (&Packet[E131_HEADER_SIZE], Frame.slots);
+    TEST_ASSERT_EQUAL_UINT32 (512, Frame.numSlots);
+} // test_e131_data_good
+
+void test_e131_data_truncated_header (void)
+{
+    E131DataFrame_t Frame;
+    BuildE131Data (1, 0);
+
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, E131_HEADER_SIZE - 1, Frame));
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, 0, Frame));
+    TEST_ASSERT_FALSE (DecodeE131Data (nullptr, E131_HEADER_SIZE, Frame));
+} // test_e131_data_truncated_header
+
+void test_e131_data_header_only (void)
+{
+    E131DataFrame_t Frame;
+    size_t Length = BuildE131Data (1, 0);
+
+    TEST_ASSERT_TRUE (DecodeE131Data (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (0, Frame.numSlots);
+} // test_e131_data_header_only
+
+void test_e131_data_slot_count_clamped (void)
+{
+    E131DataFrame_t Frame;
+    BuildE131Data (1, 512);
+
+    // the datagram ends 100 slots in but the header still claims 512
+    TEST_ASSERT_TRUE (DecodeE131Data (Packet, E131_HEADER_SIZE + 100, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (100, Frame.numSlots);
+
+    // the header claims fewer slots than the datagram holds
+    size_t Length = BuildE131Data (1, 512);
+    WriteBE16 (&Packet[123], 11);
+    TEST_ASSERT_TRUE (DecodeE131Data (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (10, Frame.numSlots);
+} // test_e131_data_slot_count_clamped
+
+void test_e131_data_zero_value_count (void)
+{
+    E131DataFrame_t Frame;
+    size_t Length = BuildE131Data (1, 10);
+    WriteBE16 (&Packet[123], 0);
+
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, Length, Frame));
+} // test_e131_data_zero_value_count
+
+void test_e131_data_bad_identifier (void)
+{
+    E131DataFrame_t Frame;
+    size_t Length = BuildE131Data (1, 10);
+    Packet[4] = 'X';
+
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, Length, Frame));
+} // test_e131_data_bad_identifier
+
+void test_e131_data_bad_vectors (void)
+{
+    E131DataFrame_t Frame;
+    size_t Length = BuildE131Data (1, 10);
+    WriteBE32 (&Packet[18], E131_VECTOR_ROOT_EXTENDED);
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, Length, Frame));
+
+    Length = BuildE131Data (1, 10);
+    WriteBE32 (&Packet[40], 0x00000003);
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, Length, Frame));
+
+    Length = BuildE131Data (1, 10);
+    Packet[117] = 0x01;
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, Length, Frame));
+} // test_e131_data_bad_vectors
+
+void test_e131_data_bad_start_code (void)
+{
+    E131DataFrame_t Frame;
+    size_t Length = BuildE131Data (1, 10);
+    Packet[125] = 0xcc;
+
+    TEST_ASSERT_FALSE (DecodeE131Data (Packet, Length, Frame));
+} // test_e131_data_bad_start_code
+
+//-----------------------------------------------------------------------------
+// E1.31 sync and discovery
+//-----------------------------------------------------------------------------
+void test_e131_sync (void)
+{
+    uint16_t SyncAddress = 0;
+    size_t Length = BuildE131Sync (0x1234);
+
+    TEST_ASSERT_TRUE (DecodeE131Sync (Packet, Length, SyncAddress));
+    TEST_ASSERT_EQUAL_UINT16 (0x1234, SyncAddress);
+    TEST_ASSERT_FALSE (DecodeE131Sync (Packet, Length - 1, SyncAddress));
+
+    // a data packet is not a sync packet
+    Length = BuildE131Data (1, 10);
+    TEST_ASSERT_FALSE (DecodeE131Sync (Packet, Length, SyncAddress));
+} // test_e131_sync
+
+void test_e131_discovery (void)
+{
+    static const uint16_t Universes[] = { 1, 2, 0x8001 };
+    E131DiscoveryFrame_t Frame;
+    size_t Length = BuildE131Discovery (Universes, 3);
+
+    // a trailing odd byte is not a universe
+    TEST_ASSERT_TRUE (DecodeE131Discovery (Packet, Length + 1, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (3, Frame.numUniverses);
+    TEST_ASSERT_EQUAL_UINT8 (1, Frame.page);
+    TEST_ASSERT_EQUAL_UINT8 (2, Frame.lastPage);
+    TEST_ASSERT_EQUAL_STRING ("Test Source", (const char *)Frame.sourceName);
+    TEST_ASSERT_EQUAL_UINT16 (2, E131DiscoveryUniverse (Frame, 1));
+    TEST_ASSERT_EQUAL_UINT16 (0x8001, E131DiscoveryUniverse (Frame, 2));
+    TEST_ASSERT_EQUAL_UINT16 (0, E131DiscoveryUniverse (Frame, 3));
+
+    TEST_ASSERT_FALSE (DecodeE131Discovery (Packet, E131_DISCOVERY_HEADER_SIZE - 1, Frame));
+
+    WriteBE32 (&Packet[114], 0x00000002);
+    TEST_ASSERT_FALSE (DecodeE131Discovery (Packet, Length, Frame));
+} // test_e131_discovery
+
+void test_e131_discovery_list_limit (void)
+{
+    E131DiscoveryFrame_t Frame;
+    BuildE131Discovery (nullptr, 0);
+
+    // more than a page can hold
+    TEST_ASSERT_TRUE (DecodeE131Discovery (Packet, E131_DISCOVERY_HEADER_SIZE + 600 * 2, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (512, Frame.numUniverses);
+} // test_e131_discovery_list_limit
+
+//-----------------------------------------------------------------------------
+// Art-Net
+//-----------------------------------------------------------------------------
+void test_artnet_opcode (void)
+{
+    size_t Length = BuildArtDmx (0, 0, 0);
+
+    TEST_ASSERT_EQUAL_HEX16 (0x5000, DecodeArtnetOpCode (Packet, Length));
+    TEST_ASSERT_EQUAL_HEX16 (ARTNET_OP_NONE, DecodeArtnetOpCode (Packet, ARTNET_HEADER_SIZE - 1));
+    TEST_ASSERT_EQUAL_HEX16 (ARTNET_OP_NONE, DecodeArtnetOpCode (nullptr, Length));
+
+    Packet[7] = 'x';
+    TEST_ASSERT_EQUAL_HEX16 (ARTNET_OP_NONE, DecodeArtnetOpCode (Packet, Length));
+} // test_artnet_opcode
+
+void test_artnet_dmx_good (void)
+{
+    ArtDmxFrame_t Frame;
+    size_t Length = BuildArtDmx (0x02, 0x34, 512);
+
+    TEST_ASSERT_TRUE (DecodeArtDmx (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT16 (0x0234, Frame.universe);
+    TEST_ASSERT_EQUAL_UINT8 (9, Frame.sequence);
+    TEST_ASSERT_EQUAL_PTR (&Packet[ARTNET_DMX_HEADER_SIZE], Frame.slots);
+    TEST_ASSERT_EQUAL_UINT32 (512, Frame.numSlots);
+    TEST_ASSERT_EQUAL_UINT8 (0xff, Frame.slots[0]);
+} // test_artnet_dmx_good
+
+void test_artnet_dmx_port_address (void)
+{
+    ArtDmxFrame_t Frame;
+
+    // the port address is 15 bits
+    size_t Length = BuildArtDmx (0xff, 0xff, 2);
+    TEST_ASSERT_TRUE (DecodeArtDmx (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT16 (0x7fff, Frame.universe);
+} // test_artnet_dmx_port_address
+
+void test_artnet_dmx_truncated (void)
+{
+    ArtDmxFrame_t Frame;
+    BuildArtDmx (0, 1, 512);
+
+    TEST_ASSERT_FALSE (DecodeArtDmx (Packet, ARTNET_DMX_HEADER_SIZE - 1, Frame));
+
+    // header only
+    TEST_ASSERT_TRUE (DecodeArtDmx (Packet, ARTNET_DMX_HEADER_SIZE, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (0, Frame.numSlots);
+
+    // the length field claims 512
+    TEST_ASSERT_TRUE (DecodeArtDmx (Packet, ARTNET_DMX_HEADER_SIZE + 100, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (100, Frame.numSlots);
+} // test_artnet_dmx_truncated
+
+void test_artnet_dmx_short_length_field (void)
+{
+    ArtDmxFrame_t Frame;
+    size_t Length = BuildArtDmx (0, 1, 512);
+    WriteBE16 (&Packet[16], 24);
+
+    TEST_ASSERT_TRUE (DecodeArtDmx (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (24, Frame.numSlots);
+
+    WriteBE16 (&Packet[16], 0);
+    TEST_ASSERT_TRUE (DecodeArtDmx (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (0, Frame.numSlots);
+} // test_artnet_dmx_short_length_field
+
+//-----------------------------------------------------------------------------
+// DDP
+//-----------------------------------------------------------------------------
+void test_ddp_good (void)
+{
+    DdpFrame_t Frame;
+    size_t Length = BuildDdp (DDP_FLAGS1_VER1 | DDP_FLAGS1_PUSH, 0x01020304, 300);
+
+    TEST_ASSERT_TRUE (DecodeDdp (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_HEX8 (DDP_FLAGS1_VER1 | DDP_FLAGS1_PUSH, Frame.flags1);
+    TEST_ASSERT_EQUAL_UINT32 (0x01020304, Frame.channelOffset);
+    TEST_ASSERT_EQUAL_UINT32 (DDP_HEADER_SIZE, Frame.headerLength);
+    TEST_ASSERT_EQUAL_UINT32 (300, Frame.dataLength);
+    TEST_ASSERT_FALSE (Frame.dataTruncated);
+    TEST_ASSERT_EQUAL_PTR (&Packet[DDP_HEADER_SIZE], Frame.data);
+} // test_ddp_good
+
+void test_ddp_time_code (void)
+{
+    DdpFrame_t Frame;
+    size_t Length = BuildDdp (DDP_FLAGS1_VER1 | DDP_FLAGS1_TIME, 0, 30);
+
+    TEST_ASSERT_TRUE (DecodeDdp (Packet, Length, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (DDP_HEADER_SIZE + DDP_TIMECODE_SIZE, Frame.headerLength);
+    TEST_ASSERT_EQUAL_PTR (&Packet[DDP_HEADER_SIZE + DDP_TIMECODE_SIZE], Frame.data);
+    TEST_ASSERT_EQUAL_UINT32 (30, Frame.dataLength);
+
+    // room for the header but not its time code
+    TEST_ASSERT_FALSE (DecodeDdp (Packet, DDP_HEADER_SIZE + DDP_TIMECODE_SIZE - 1, Frame));
+} // test_ddp_time_code
+
+void test_ddp_truncated (void)
+{
+    DdpFrame_t Frame;
+    BuildDdp (DDP_FLAGS1_VER1, 0, 300);
+
+    TEST_ASSERT_FALSE (DecodeDdp (Packet, DDP_HEADER_SIZE - 1, Frame));
+    TEST_ASSERT_FALSE (DecodeDdp (nullptr, DDP_HEADER_SIZE, Frame));
+
+    // dataLen claims more than the datagram holds
+    TEST_ASSERT_TRUE (DecodeDdp (Packet, DDP_HEADER_SIZE + 100, Frame));
+    TEST_ASSERT_TRUE (Frame.dataTruncated);
+    TEST_ASSERT_EQUAL_UINT32 (100, Frame.dataLength);
+
+    // header only
+    TEST_ASSERT_TRUE (DecodeDdp (Packet, DDP_HEADER_SIZE, Frame));
+    TEST_ASSERT_EQUAL_UINT32 (0, Frame.dataLength);
+} // test_ddp_truncated
+
+void test_ddp_padded (void)
+{
+    DdpFrame_t Frame;
+    size_t Length = BuildDdp (DDP_FLAGS1_VER1, 0, 300);
+    WriteBE16 (&Packet[8], 12);
+
+    // bytes past dataLen are not data
+    TEST_ASSERT_TRUE (DecodeDdp (Packet, Length, Frame));
+    TEST_ASSERT_FALSE (Frame.dataTruncated);
+    TEST_ASSERT_EQUAL_UINT32 (12, Frame.dataLength);
+} // test_ddp_padded
+
+void test_ddp_bad_version (void)
+{
+    DdpFrame_t Frame;
+    size_t Length = BuildDdp (0x00, 0, 10);
+    TEST_ASSERT_FALSE (DecodeDdp (Packet, Length, Frame));
+
+    Length = BuildDdp (0x80, 0, 10);
+    TEST_ASSERT_FALSE (DecodeDdp (Packet, Length, Frame));
+
+    Length = BuildDdp (0xc0, 0, 10);
+    TEST_ASSERT_FALSE (DecodeDdp (Packet, Length, Frame));
+} // test_ddp_bad_version
+
+//-----------------------------------------------------------------------------
+// CopySlots
+//-----------------------------------------------------------------------------
+void test_copy_slots (void)
+{
+    uint8_t Slots[16];
+    uint8_t Destination[16];
+    for (uint8_t Index = 0; Index < sizeof (Slots); ++Index)
+    {
+        Slots[Index] = uint8_t (Index + 1);
+    }
+
+    // limited by the room in the destination
+    memset (Destination, 0x00, sizeof (Destination));
+    TEST_ASSERT_EQUAL_UINT32 (4, CopySlots (Destination, Slots, 16, 2, 4));
+    TEST_ASSERT_EQUAL_UINT8 (3, Destination[0]);
+    TEST_ASSERT_EQUAL_UINT8 (6, Destination[3]);
+    TEST_ASSERT_EQUAL_UINT8 (0, Destination[4]);
+
+    // limited by the slots in the packet
+    TEST_ASSERT_EQUAL_UINT32 (6, CopySlots (Destination, Slots, 16, 10, 16));
+    TEST_ASSERT_EQUAL_UINT8 (16, Destination[5]);
+
+    // the offset is at or past the end of the packet
+    TEST_ASSERT_EQUAL_UINT32 (0, CopySlots (Destination, Slots, 16, 16, 16));
+    TEST_ASSERT_EQUAL_UINT32 (0, CopySlots (Destination, Slots, 0, 0, 16));
+    TEST_ASSERT_EQUAL_UINT32 (0, CopySlots (nullptr, Slots, 16, 0, 16));
+    TEST_ASSERT_EQUAL_UINT32 (0, CopySlots (Destination, nullptr, 16, 0, 16));
+} // test_copy_slots
+
+//-----------------------------------------------------------------------------
+int main (void)
+{
+    UNITY_BEGIN ();
+
+    RUN_TEST (test_e131_data_good);
+    RUN_TEST (test_e131_data_truncated_header);
+    RUN_TEST (test_e131_data_header_only);
+    RUN_TEST (test_e131_data_slot_count_clamped);
+    RUN_TEST (test_e131_data_zero_value_count);
+    RUN_TEST (test_e131_data_bad_identifier);
+    RUN_TEST (test_e131_data_bad_vectors);
+    RUN_TEST (test_e131_data_bad_start_code);
+    RUN_TEST (test_e131_sync);
+    RUN_TEST (test_e131_discovery);
+    RUN_TEST (test_e131_discovery_list_limit);
+
+    RUN_TEST (test_artnet_opcode);
+    RUN_TEST (test_artnet_dmx_good);
+    RUN_TEST (test_artnet_dmx_port_address);
+    RUN_TEST (test_artnet_dmx_truncated);
+    RUN_TEST (test_artnet_dmx_short_length_field);
+
+    RUN_TEST (test_ddp_good);
+    RUN_TEST (test_ddp_time_code);
+    RUN_TEST (test_ddp_truncated);
+    RUN_TEST (test_ddp_padded);
+    RUN_TEST (test_ddp_bad_version);
+
+    RUN_TEST (test_copy_slots);
+
+    return UNITY_END ();
+
+} // main
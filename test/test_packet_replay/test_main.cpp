@@ -0,0 +1,372 @@
+/*
+* test_main.cpp - Replay a packet capture through the network decoders
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   PACKET_CAPTURE=show.pcap pio test -e native -f test_packet_replay
+*
+*   Reads a libpcap file (Ethernet, Linux cooked or raw IP), picks out the
+*   IPv4 UDP datagrams sent to the E1.31, Art-Net and DDP ports and runs
+*   them through the decoders and CopySlots until at least
+*   REPLAY_MIN_DECODES have been done. Prints the decode rate for each
+*   protocol. The test is skipped when PACKET_CAPTURE is not set.
+*/
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "input/InputPacketDecode.hpp"
+
+#define REPLAY_MIN_DECODES      2000000
+#define REPLAY_MAX_PACKET       65535
+
+#define PCAP_MAGIC_US           0xa1b2c3d4
+#define PCAP_MAGIC_NS           0xa1b23c4d
+#define PCAP_LINKTYPE_ETHERNET  1
+#define PCAP_LINKTYPE_RAW       101
+#define PCAP_LINKTYPE_LINUX_SLL 113
+
+#define E131_PORT               5568
+#define ARTNET_PORT             6454
+#define DDP_PORT                4048
+#define ARTNET_OP_DMX           0x5000
+
+enum Protocol_t
+{
+    Protocol_E131 = 0,
+    Protocol_Artnet,
+    Protocol_Ddp,
+    Protocol_End,
+};
+
+static const char * ProtocolNames[Protocol_End] = { "E1.31", "Art-Net", "DDP" };
+
+typedef struct
+{
+    Protocol_t Protocol;
+    size_t     Offset;          ///< Start of the UDP payload in Capture
+    size_t     Length;
+} Datagram_t;
+
+typedef struct
+{
+    uint32_t Datagrams;
+    uint32_t Decoded;
+    uint64_t Decodes;
+    uint64_t Bytes;
+    double   Seconds;
+} ProtocolStats_t;
+
+static std::vector<uint8_t>    Capture;
+static std::vector<Datagram_t> Datagrams;
+static uint8_t                 OutputBuffer[REPLAY_MAX_PACKET];
+
+void setUp (void) {}
+void tearDown (void) {}
+
+//-----------------------------------------------------------------------------
+static uint32_t ReadU32 (const uint8_t * Data, bool Swapped)
+{
+    uint32_t Value;
+    memcpy (&Value, Data, sizeof (Value));
+    return Swapped ? __builtin_bswap32 (Value) : Value;
+} // ReadU32
+
+//-----------------------------------------------------------------------------
+static uint16_t ReadBE16 (const uint8_t * Data)
+{
+    return uint16_t ((uint16_t (Data[0]) << 8) | Data[1]);
+} // ReadBE16
+
+//-----------------------------------------------------------------------------
+/// Finds the UDP payload in one captured frame and remembers it if it is ours
+static void AddFrame (uint32_t LinkType, size_t FrameOffset, size_t FrameLength)
+{
+    const uint8_t * Frame = &Capture[FrameOffset];
+    size_t IpOffset  = 0;
+    uint16_t EtherType = 0x0800;
+
+    do // once
+    {
+        if (PCAP_LINKTYPE_ETHERNET == LinkType)
+        {
+            IpOffset = 14;
+            if (FrameLength < IpOffset)
+            {
+                break;
+            }
+            EtherType = ReadBE16 (&Frame[12]);
+            while ((0x8100 == EtherType) && (FrameLength >= (IpOffset + 4)))
+            {
+                // skip the VLAN tag
+                EtherType = ReadBE16 (&Frame[IpOffset + 2]);
+                IpOffset += 4;
+            }
+        }
+        else if (PCAP_LINKTYPE_LINUX_SLL == LinkType)
+        {
+            IpOffset = 16;
+            if (FrameLength < IpOffset)
+            {
+                break;
+            }
+            EtherType = ReadBE16 (&Frame[14]);
+        }
+        else if (PCAP_LINKTYPE_RAW != LinkType)
+        {
+            // unsupported link layer
+            break;
+        }
+
+        if ((0x0800 != EtherType) || (FrameLength < (IpOffset + 20)))
+        {
+            // not IPv4
+            break;
+        }
+
+        const uint8_t * Ip = &Frame[IpOffset];
+        size_t IpHeaderLength = size_t (Ip[0] & 0x0f) * 4;
+        size_t IpLength       = ReadBE16 (&Ip[2]);
+        if (((Ip[0] >> 4) != 4) || (IpHeaderLength < 20) || (17 != Ip[9]) || (ReadBE16 (&Ip[6]) & 0x3fff))
+        {
+            // not UDP or a fragment
+            break;
+        }
+
+        size_t UdpOffset = IpOffset + IpHeaderLength;
+        if ((IpLength > (FrameLength - IpOffset)) || (IpLength < (IpHeaderLength + 8)))
+        {
+            // cut short by the capture snap length
+            break;
+        }
+
+        const uint8_t * Udp = &Frame[UdpOffset];
+        Datagram_t Datagram;
+        switch (ReadBE16 (&Udp[2]))
+        {
+            case E131_PORT:   { Datagram.Protocol = Protocol_E131;   break; }
+            case ARTNET_PORT: { Datagram.Protocol = Protocol_Artnet; break; }
+            case DDP_PORT:    { Datagram.Protocol = Protocol_Ddp;    break; }
+            default:          { Datagram.Protocol = Protocol_End;    break; }
+        }
+
+        if (Protocol_End == Datagram.Protocol)
+        {
+            // some other port
+            break;
+        }
+
+        Datagram.Offset = FrameOffset + UdpOffset + 8;
+        Datagram.Length = IpLength - IpHeaderLength - 8;
+        Datagrams.push_back (Datagram);
+
+    } while (false);
+
+} // AddFrame
+
+//-----------------------------------------------------------------------------
+static bool LoadCapture (const char * FileName)
+{
+    bool Response = false;
+    FILE * CaptureFile = fopen (FileName, "rb");
+
+    do // once
+    {
+        if (nullptr == CaptureFile)
+        {
+            break;
+        }
+
+        fseek (CaptureFile, 0, SEEK_END);
+        long FileSize = ftell (CaptureFile);
+        fseek (CaptureFile, 0, SEEK_SET);
+        if (FileSize < 24)
+        {
+            break;
+        }
+
+        Capture.resize (size_t (FileSize));
+        if (Capture.size () != fread (Capture.data (), 1, Capture.size (), CaptureFile))
+        {
+            break;
+        }
+
+        uint32_t Magic   = ReadU32 (&Capture[0], false);
+        bool     Swapped = (__builtin_bswap32 (PCAP_MAGIC_US) == Magic) || (__builtin_bswap32 (PCAP_MAGIC_NS) == Magic);
+        if (!Swapped && (PCAP_MAGIC_US != Magic) && (PCAP_MAGIC_NS != Magic))
+        {
+            // not libpcap. pcapng files need converting with editcap -F pcap
+            break;
+        }
+
+        uint32_t LinkType = ReadU32 (&Capture[20], Swapped) & 0x0fffffff;
+        size_t   Offset   = 24;
+        while ((Offset + 16) <= Capture.size ())
+        {
+            size_t CapturedLength = ReadU32 (&Capture[Offset + 8], Swapped);
+            Offset += 16;
+            if (CapturedLength > (Capture.size () - Offset))
+            {
+                // truncated file
+                break;
+            }
+
+            AddFrame (LinkType, Offset, CapturedLength);
+            Offset += CapturedLength;
+        }
+
+        Response = true;
+
+    } while (false);
+
+    if (nullptr != CaptureFile)
+    {
+        fclose (CaptureFile);
+    }
+
+    return Response;
+
+} // LoadCapture
+
+//-----------------------------------------------------------------------------
+/// Decode one datagram the way the input driver would. Returns true if it carried slot data.
+static bool DecodeDatagram (const Datagram_t & Datagram)
+{
+    bool Response = false;
+    const uint8_t * Packet = &Capture[Datagram.Offset];
+
+    switch (Datagram.Protocol)
+    {
+        case Protocol_E131:
+        {
+            E131DataFrame_t Frame;
+            uint16_t SyncAddress;
+            E131DiscoveryFrame_t Discovery;
+            if (DecodeE131Data (Packet, Datagram.Length, Frame))
+            {
+                CopySlots (OutputBuffer, Frame.slots, Frame.numSlots, 0, sizeof (OutputBuffer));
+                Response = true;
+            }
+            else if (!DecodeE131Sync (Packet, Datagram.Length, SyncAddress))
+            {
+                DecodeE131Discovery (Packet, Datagram.Length, Discovery);
+            }
+            break;
+        }
+
+        case Protocol_Artnet:
+        {
+            ArtDmxFrame_t Frame;
+            if ((ARTNET_OP_DMX == DecodeArtnetOpCode (Packet, Datagram.Length)) &&
+                DecodeArtDmx (Packet, Datagram.Length, Frame))
+            {
+                CopySlots (OutputBuffer, Frame.slots, Frame.numSlots, 0, sizeof (OutputBuffer));
+                Response = true;
+            }
+            break;
+        }
+
+        case Protocol_Ddp:
+        {
+            DdpFrame_t Frame;
+            if (DecodeDdp (Packet, Datagram.Length, Frame) &&
+                (DDP_FLAGS1_DATA == (Frame.flags1 & DDP_FLAGS1_DATAMASK)))
+            {
+                CopySlots (OutputBuffer, Frame.data, Frame.dataLength, 0, sizeof (OutputBuffer));
+                Response = true;
+            }
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    return Response;
+
+} // DecodeDatagram
+
+//-----------------------------------------------------------------------------
+void test_replay_capture (void)
+{
+    const char * FileName = getenv ("PACKET_CAPTURE");
+    if (nullptr == FileName)
+    {
+        TEST_IGNORE_MESSAGE ("Set PACKET_CAPTURE to the path of a pcap file to run the replay benchmark");
+    }
+
+    TEST_ASSERT_TRUE_MESSAGE (LoadCapture (FileName), "Could not read the capture file");
+    if (Datagrams.empty ())
+    {
+        TEST_IGNORE_MESSAGE ("The capture has no E1.31, Art-Net or DDP datagrams");
+    }
+
+    ProtocolStats_t Stats[Protocol_End];
+    memset (Stats, 0x00, sizeof (Stats));
+
+    std::vector<Datagram_t> ByProtocol[Protocol_End];
+    for (const Datagram_t & Datagram : Datagrams)
+    {
+        ByProtocol[Datagram.Protocol].push_back (Datagram);
+        ++Stats[Datagram.Protocol].Datagrams;
+        Stats[Datagram.Protocol].Decoded += DecodeDatagram (Datagram) ? 1 : 0;
+    }
+
+    for (int Protocol = 0; Protocol < Protocol_End; ++Protocol)
+    {
+        ProtocolStats_t & CurrentStats = Stats[Protocol];
+        if (ByProtocol[Protocol].empty ())
+        {
+            continue;
+        }
+
+        auto StartTime = std::chrono::steady_clock::now ();
+        while (CurrentStats.Decodes < REPLAY_MIN_DECODES)
+        {
+            for (const Datagram_t & Datagram : ByProtocol[Protocol])
+            {
+                DecodeDatagram (Datagram);
+                CurrentStats.Bytes += Datagram.Length;
+            }
+            CurrentStats.Decodes += ByProtocol[Protocol].size ();
+        }
+        CurrentStats.Seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - StartTime).count ();
+
+        char Message[200];
+        snprintf (Message, sizeof (Message),
+                  "%-8s %6u datagrams %6u with slot data  %8.1f ns/datagram  %8.1f MB/s",
+                  ProtocolNames[Protocol], CurrentStats.Datagrams, CurrentStats.Decoded,
+                  (CurrentStats.Seconds * 1e9) / double (CurrentStats.Decodes),
+                  double (CurrentStats.Bytes) / CurrentStats.Seconds / 1e6);
+        TEST_MESSAGE (Message);
+    }
+
+} // test_replay_capture
+
+//-----------------------------------------------------------------------------
+int main (void)
+{
+    UNITY_BEGIN ();
+
+    RUN_TEST (test_replay_capture);
+
+    return UNITY_END ();
+
+} // main
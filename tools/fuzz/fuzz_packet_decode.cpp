@@ -0,0 +1,129 @@
+/*
+* fuzz_packet_decode.cpp - Fuzz driver for the E1.31, Art-Net and DDP decoders
+*
+* Project: ESPixelStick - An ESP8266 / ESP32 and E1.31 based pixel driver
+* Copyright (c) 2021 Shelby Merrick
+* http://www.forkineye.com
+*
+*  This program is provided free for you to use in any way that you wish,
+*  subject to the laws and regulations where you are using it.  Due diligence
+*  is strongly suggested before using this code.  Please give credit where due.
+*
+*  The Author makes no warranty of any kind, express or implied, with regard
+*  to this program or the documentation contained in this document.  The
+*  Author shall not be liable in any event for incidental or consequential
+*  damages in connection with, or arising out of, the furnishing, performance
+*  or use of these programs.
+*
+*   Every input is handed to every decoder as one datagram. Besides the
+*   sanitizers catching out of bounds reads, the driver checks that each
+*   decoded frame only points inside the datagram.
+*
+*   libFuzzer:
+*     clang++ -g -O1 -fsanitize=fuzzer,address,undefined -I ESPixelStick/src \
+*         tools/fuzz/fuzz_packet_decode.cpp ESPixelStick/src/input/InputPacketDecode.cpp \
+*         -o fuzz_packet_decode
+*     ./fuzz_packet_decode corpus/
+*
+*   AFL++:
+*     afl-clang-fast++ -g -fsanitize=fuzzer,address -I ESPixelStick/src \
+*         tools/fuzz/fuzz_packet_decode.cpp ESPixelStick/src/input/InputPacketDecode.cpp \
+*         -o fuzz_packet_decode
+*     afl-fuzz -i corpus -o findings -- ./fuzz_packet_decode
+*
+*   Add -DFUZZ_STANDALONE to build with any compiler and replay the files
+*   named on the command line, e.g. a crash found by either fuzzer.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "input/InputPacketDecode.hpp"
+
+static uint8_t OutputBuffer[UINT16_MAX + 1];
+
+//-----------------------------------------------------------------------------
+static void CheckSpan (const uint8_t * Packet, size_t PacketLength, const uint8_t * Start, size_t Length)
+{
+    if ((Start < Packet) || (Start > (Packet + PacketLength)) || (Length > size_t ((Packet + PacketLength) - Start)))
+    {
+        fprintf (stderr, "Decoded span [%zd, +%zu) is outside the %zu byte datagram\n", Start - Packet, Length, PacketLength);
+        abort ();
+    }
+} // CheckSpan
+
+//-----------------------------------------------------------------------------
+extern "C" int LLVMFuzzerTestOneInput (const uint8_t * Data, size_t Size)
+{
+    E131DataFrame_t E131Frame;
+    if (DecodeE131Data (Data, Size, E131Frame))
+    {
+        CheckSpan (Data, Size, E131Frame.cid, E131_CID_SIZE);
+        CheckSpan (Data, Size, E131Frame.slots, E131Frame.numSlots);
+        CopySlots (OutputBuffer, E131Frame.slots, E131Frame.numSlots, Data[0], sizeof (OutputBuffer) - Data[0]);
+    }
+
+    uint16_t SyncAddress;
+    DecodeE131Sync (Data, Size, SyncAddress);
+
+    E131DiscoveryFrame_t DiscoveryFrame;
+    if (DecodeE131Discovery (Data, Size, DiscoveryFrame))
+    {
+        CheckSpan (Data, Size, DiscoveryFrame.sourceName, E131_SOURCE_NAME_SIZE);
+        CheckSpan (Data, Size, DiscoveryFrame.universeList, DiscoveryFrame.numUniverses * 2);
+        for (uint32_t Index = 0; Index <= DiscoveryFrame.numUniverses; ++Index)
+        {
+            E131DiscoveryUniverse (DiscoveryFrame, Index);
+        }
+    }
+
+    ArtDmxFrame_t ArtDmxFrame;
+    DecodeArtnetOpCode (Data, Size);
+    if (DecodeArtDmx (Data, Size, ArtDmxFrame))
+    {
+        CheckSpan (Data, Size, ArtDmxFrame.slots, ArtDmxFrame.numSlots);
+        CopySlots (OutputBuffer, ArtDmxFrame.slots, ArtDmxFrame.numSlots, 0, sizeof (OutputBuffer));
+    }
+
+    DdpFrame_t DdpFrame;
+    if (DecodeDdp (Data, Size, DdpFrame))
+    {
+        CheckSpan (Data, Size, DdpFrame.data, DdpFrame.dataLength);
+        CopySlots (OutputBuffer, DdpFrame.data, DdpFrame.dataLength, 0, sizeof (OutputBuffer));
+    }
+
+    return 0;
+
+} // LLVMFuzzerTestOneInput
+
+#ifdef FUZZ_STANDALONE
+//-----------------------------------------------------------------------------
+int main (int argc, char ** argv)
+{
+    static uint8_t Packet[UINT16_MAX + 1];
+
+    for (int Index = 1; Index < argc; ++Index)
+    {
+        FILE * InputFile = fopen (argv[Index], "rb");
+        if (nullptr == InputFile)
+        {
+            fprintf (stderr, "Could not open '%s'\n", argv[Index]);
+            return 1;
+        }
+
+        size_t Length = fread (Packet, 1, sizeof (Packet), InputFile);
+        fclose (InputFile);
+
+        // give the sanitizers an allocation that ends where the datagram does
+        uint8_t * Datagram = (uint8_t *)malloc (Length ? Length : 1);
+        memcpy (Datagram, Packet, Length);
+        LLVMFuzzerTestOneInput (Datagram, Length);
+        free (Datagram);
+    }
+
+    return 0;
+
+} // main
+#endif // def FUZZ_STANDALONE